@@ -0,0 +1,75 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+//**************************************************************
+// Structures
+//**************************************************************
+
+/*!
+ * Heap usage recorded by the counting operator new of the benchmark binary.
+ */
+struct AllocationStats
+{
+    size_t allocations;
+    size_t bytes;
+};
+
+//**************************************************************
+// Global function prototypes
+//**************************************************************
+
+/*!
+ * Returns the number of allocations and allocated bytes since program start.
+ */
+extern AllocationStats GetAllocationStats();
+
+// Benchmarks, one per module
+extern void BenchPathTable();
+extern void BenchBuildPlan();
+extern void BenchConfigStartup();
+extern void BenchProcessRunner();
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Measures wall time and heap usage between construction and Report().
+ */
+class BenchmarkTimer
+{
+private:
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+    AllocationStats startStats;
+
+public:
+    explicit BenchmarkTimer(const std::string &name)
+        : name(name),
+          start(std::chrono::steady_clock::now()),
+          startStats(GetAllocationStats())
+    {
+    }
+
+    double Report(size_t items)
+    {
+        auto end = std::chrono::steady_clock::now();
+        AllocationStats endStats = GetAllocationStats();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "  " << name << ": " << ms << " ms";
+        if (items > 0)
+            std::cout << " (" << (static_cast<double>(items) / ms * 1000.0) << " items/s)";
+        std::cout << ", " << (endStats.allocations - startStats.allocations) << " allocations, "
+                  << (endStats.bytes - startStats.bytes) / 1024 << " KiB" << std::endl;
+        return ms;
+    }
+};
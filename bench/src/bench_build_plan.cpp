@@ -0,0 +1,125 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "Benchmark.h"
+#include "XMakefileParser.h"
+#include <filesystem>
+#include <fstream>
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static constexpr size_t NumberOfSources = 10000;
+static constexpr size_t SourcesPerDirectory = 100;
+
+static std::string CreateProject()
+{
+    std::string projectDir = std::filesystem::temp_directory_path().string() + "/xmake_bench_plan_" +
+                             std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+
+    for (size_t i = 0; i < NumberOfSources; i++)
+    {
+        std::string dir = projectDir + "/src/module_" + std::to_string(i / SourcesPerDirectory);
+        if (i % SourcesPerDirectory == 0)
+            std::filesystem::create_directories(dir);
+
+        std::ofstream source(dir + "/file_" + std::to_string(i) + ".cpp");
+        source << "int f" << i << "() { return " << i << "; }\n";
+    }
+    std::filesystem::create_directories(projectDir + "/include");
+
+    std::ofstream xmakefile(projectDir + "/xmakefile.json");
+    xmakefile << R"({
+        "configurations": [{
+            "name": "Bench",
+            "build_type": "Executable",
+            "build_dir": ".build",
+            "output_filename": "app",
+            "compiler_path": "",
+            "compiler": "g++",
+            "c_flags": "-Wall",
+            "cxx_flags": "-Wall -std=c++23",
+            "linker": "g++",
+            "linker_flags": "",
+            "archiver": "ar",
+            "archiver_flags": "rcs",
+            "defines": ["BENCH"],
+            "include_paths": ["include"],
+            "library_paths": [],
+            "libraries": [],
+            "source_paths": ["src"],
+            "exclude_paths": [],
+            "exclude_files": [],
+            "pre_build_commands": [],
+            "post_build_commands": [],
+            "pre_run_commands": [],
+            "post_run_commands": [],
+            "install_commands": [],
+            "uninstall_commands": [],
+            "clean_commands": []
+        }]
+    })";
+
+    return projectDir;
+}
+
+// Everything a no-op build does before it decides that nothing changed
+static RebuildScheme RunNoOpBuild(const std::string &projectDir)
+{
+    XMakefileParser parser;
+    parser.Parse(projectDir + "/xmakefile.json");
+    parser.LoadBuildTimes();
+    parser.CreateBuildList();
+    return parser.CheckRebuild();
+}
+
+//**************************************************************
+// Benchmarks
+//**************************************************************
+
+void BenchBuildPlan()
+{
+    std::string projectDir = CreateProject();
+
+    std::cout << "Build plan (" << NumberOfSources << " sources)" << std::endl;
+
+    // Time until the first source file can be handed to a compiler, scanning from scratch
+    {
+        BenchmarkTimer timer("cold plan, full discovery");
+        XMakefileParser parser;
+        parser.Parse(projectDir + "/xmakefile.json");
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> firstFound{};
+        parser.CreateBuildList([&start, &firstFound](const BuildStruct &)
+                               {
+            if (firstFound.count() == 0)
+                firstFound = std::chrono::steady_clock::now() - start; });
+        timer.Report(NumberOfSources);
+        std::cout << "    first build structure after " << firstFound.count() << " ms" << std::endl;
+        std::filesystem::remove_all(projectDir + "/.build");
+    }
+
+    // First run scans the directories and writes the plan cache and build times
+    {
+        BenchmarkTimer timer("cold plan");
+        XMakefileParser parser;
+        parser.Parse(projectDir + "/xmakefile.json");
+        parser.CreateBuildList();
+        parser.SaveBuildTimes();
+        timer.Report(NumberOfSources);
+    }
+
+    // Following runs load the cached plan
+    for (int i = 0; i < 3; i++)
+    {
+        BenchmarkTimer timer("no-op build (cached plan)");
+        RebuildScheme scheme = RunNoOpBuild(projectDir);
+        timer.Report(NumberOfSources);
+        if (scheme != RebuildScheme::None)
+            std::cout << "  unexpected rebuild scheme " << scheme << std::endl;
+    }
+
+    std::filesystem::remove_all(projectDir);
+}
@@ -0,0 +1,117 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "Benchmark.h"
+#include "XMakefileParser.h"
+#include <filesystem>
+#include <fstream>
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static constexpr size_t NumberOfConfigurations = 50;
+static constexpr size_t PathsPerConfiguration = 20;
+static constexpr size_t SourcesPerConfiguration = 2000;
+
+static std::string CreateXMakefile(size_t sourcesPerConfiguration)
+{
+    std::string projectDir = std::filesystem::temp_directory_path().string() + "/xmake_bench_configs_" +
+                             std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    std::filesystem::create_directories(projectDir + "/project");
+
+    std::ofstream xmakefile(projectDir + "/project/xmakefile.json");
+    xmakefile << "{ \"configurations\": [";
+    for (size_t i = 0; i < NumberOfConfigurations; i++)
+    {
+        std::string name = "Config" + std::to_string(i);
+        xmakefile << (i == 0 ? "" : ",") << "{"
+                  << "\"name\": \"" << name << "\","
+                  << "\"build_type\": \"Executable\","
+                  << "\"build_dir\": \".build\","
+                  << "\"output_filename\": \"app_" << i << "\","
+                  << "\"compiler\": \"g++\","
+                  << "\"cxx_flags\": \"-O2 -std=c++23\","
+                  << "\"linker\": \"g++\",";
+
+        // Parent directory paths go through weakly_canonical, commands through variable expansion
+        xmakefile << "\"include_paths\": [";
+        for (size_t j = 0; j < PathsPerConfiguration; j++)
+            xmakefile << (j == 0 ? "" : ",") << "\"../lib" << j << "/include\"";
+        xmakefile << "],\"source_paths\": [";
+        for (size_t j = 0; j < PathsPerConfiguration; j++)
+            xmakefile << (j == 0 ? "" : ",") << "\"src/module" << j << "\"";
+        xmakefile << "],\"post_build_commands\": [";
+        for (size_t j = 0; j < PathsPerConfiguration; j++)
+            xmakefile << (j == 0 ? "" : ",") << "\"cp ${output_file} ../deploy/" << name << "/step" << j << "\"";
+        xmakefile << "],\"sources\": [";
+        for (size_t j = 0; j < sourcesPerConfiguration; j++)
+            xmakefile << (j == 0 ? "" : ",") << "\"src/generated/file" << j << ".cpp\"";
+        xmakefile << "]}";
+    }
+    xmakefile << "]}";
+
+    return projectDir;
+}
+
+//**************************************************************
+// Benchmarks
+//**************************************************************
+
+void BenchConfigStartup()
+{
+    std::string projectDir = CreateXMakefile(0);
+    std::string xmakefilePath = projectDir + "/project/xmakefile.json";
+    std::string lastConfig = "Config" + std::to_string(NumberOfConfigurations - 1);
+
+    std::cout << "Configuration startup (" << NumberOfConfigurations << " configurations)" << std::endl;
+
+    // The first run parses the JSON and writes the xmakefile cache, the following ones load it
+    for (int i = 0; i < 4; i++)
+    {
+        BenchmarkTimer timer(i == 0 ? "parse and select one configuration (JSON)" : "parse and select one configuration (cached)");
+        XMakefileParser parser;
+        parser.Parse(xmakefilePath);
+        parser.SetConfig(lastConfig);
+        timer.Report(0);
+    }
+
+    // What every startup paid before configurations were resolved on demand
+    {
+        std::ifstream file(xmakefilePath);
+        std::string content;
+        std::string line;
+        while (std::getline(file, line))
+            content += line;
+        JsonDocument doc;
+        deserializeJson(doc, content);
+
+        BenchmarkTimer timer("resolve all configurations");
+        XMakefile xmakefile;
+        xmakefile.FromJSON(doc.as<JsonVariant>(), projectDir + "/project");
+        for (size_t i = 0; i < xmakefile.ConfigCount(); i++)
+            xmakefile.GetConfig(i);
+        timer.Report(NumberOfConfigurations);
+    }
+
+    std::filesystem::remove_all(projectDir);
+
+    // Generated xmakefiles listing their sources explicitly
+    projectDir = CreateXMakefile(SourcesPerConfiguration);
+    xmakefilePath = projectDir + "/project/xmakefile.json";
+    std::cout << "Configuration startup (" << NumberOfConfigurations << " configurations, "
+              << std::filesystem::file_size(xmakefilePath) / 1024 << " KiB xmakefile)" << std::endl;
+
+    // The first run parses the JSON and writes the xmakefile cache, the following ones load it
+    for (int i = 0; i < 4; i++)
+    {
+        BenchmarkTimer timer(i == 0 ? "parse and select one configuration (JSON)" : "parse and select one configuration (cached)");
+        XMakefileParser parser;
+        parser.Parse(xmakefilePath);
+        parser.SetConfig(lastConfig);
+        timer.Report(0);
+    }
+
+    std::filesystem::remove_all(projectDir);
+}
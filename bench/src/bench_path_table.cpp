@@ -0,0 +1,81 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "Benchmark.h"
+#include "PathTable.h"
+#include <map>
+#include <vector>
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static constexpr size_t NumberOfFiles = 100000;
+
+static std::vector<std::string> CreatePaths()
+{
+    std::vector<std::string> paths;
+    paths.reserve(NumberOfFiles);
+    for (size_t i = 0; i < NumberOfFiles; i++)
+    {
+        paths.push_back("/home/user/projects/large_project/src/module_" + std::to_string(i / 100) +
+                        "/component_" + std::to_string(i) + ".cpp");
+    }
+    return paths;
+}
+
+//**************************************************************
+// Benchmarks
+//**************************************************************
+
+void BenchPathTable()
+{
+    std::vector<std::string> paths = CreatePaths();
+
+    std::cout << "PathTable (" << NumberOfFiles << " files)" << std::endl;
+
+    // The previous layout: separate string copies for the source list,
+    // the build structures and the build time map
+    {
+        BenchmarkTimer timer("std::string copies");
+        std::vector<std::string> sourceFiles;
+        std::vector<std::string> buildSources;
+        std::map<std::string, std::string> lastModifiedTimes;
+        for (const auto &path : paths)
+        {
+            sourceFiles.push_back(path);
+        }
+        for (const auto &path : sourceFiles)
+        {
+            buildSources.push_back(path);
+            lastModifiedTimes[path] = "1700000000";
+        }
+        timer.Report(NumberOfFiles);
+    }
+
+    // The interned layout: every path is stored once, everything else uses ids
+    {
+        PathTable table;
+        BenchmarkTimer timer("PathTable intern");
+        std::vector<PathId> sourceFiles;
+        sourceFiles.reserve(NumberOfFiles);
+        for (const auto &path : paths)
+        {
+            sourceFiles.push_back(table.Intern(path));
+        }
+        std::vector<PathId> buildSources(sourceFiles);
+        timer.Report(NumberOfFiles);
+
+        BenchmarkTimer lookupTimer("PathTable lookup");
+        size_t found = 0;
+        for (const auto &path : paths)
+        {
+            found += table.Find(path) != InvalidPathId ? 1 : 0;
+        }
+        lookupTimer.Report(found);
+
+        std::cout << "  PathTable memory: " << table.MemoryUsage() / 1024 << " KiB for "
+                  << table.Size() << " paths" << std::endl;
+    }
+}
@@ -0,0 +1,102 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "Benchmark.h"
+#include "ProcessRunner.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static constexpr size_t NumberOfJobs = 2000;
+static constexpr size_t ParallelJobs = 256;
+
+// Stand-in for a compiler that does nothing, so only the cost of running jobs is measured
+static std::string CreateNoOpCompiler()
+{
+    std::string dir = std::filesystem::temp_directory_path().string() + "/xmake_bench_runner_" +
+                      std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    std::filesystem::create_directories(dir);
+
+    std::string compiler = dir + "/noopcc";
+    std::ofstream script(compiler);
+    script << "#!/bin/sh\nexit 0\n";
+    script.close();
+    std::filesystem::permissions(compiler, std::filesystem::perms::owner_all);
+    return compiler;
+}
+
+static size_t CountThreads()
+{
+    size_t threads = 0;
+    for ([[maybe_unused]] const auto &entry : std::filesystem::directory_iterator("/proc/self/task"))
+        threads++;
+    return threads;
+}
+
+//**************************************************************
+// Benchmarks
+//**************************************************************
+
+void BenchProcessRunner()
+{
+    std::string compiler = CreateNoOpCompiler();
+    std::string command = compiler + " -c file.cpp -o file.o";
+
+    std::cout << "Process runner (" << NumberOfJobs << " no-op compiles, " << ParallelJobs << " at a time)" << std::endl;
+
+    // What the build did before, one thread blocked in std::system per running job
+    {
+        BenchmarkTimer timer("thread per job with std::system");
+        size_t peakThreads = 0;
+        for (size_t started = 0; started < NumberOfJobs;)
+        {
+            std::vector<std::thread> threads;
+            for (; threads.size() < ParallelJobs && started < NumberOfJobs; started++)
+            {
+                threads.emplace_back([&command]()
+                                     { [[maybe_unused]] int result = std::system(command.c_str()); });
+            }
+            peakThreads = std::max(peakThreads, CountThreads());
+            for (auto &thread : threads)
+                thread.join();
+        }
+        timer.Report(NumberOfJobs);
+        std::cout << "    peak threads: " << peakThreads << std::endl;
+    }
+
+    // One reactor thread for all children, a new job starts as soon as one finishes
+    {
+        BenchmarkTimer timer("reactor with pidfd and epoll");
+        size_t peakThreads = 0;
+        {
+            ProcessRunner runner;
+            std::atomic<size_t> running = 0;
+            for (size_t started = 0; started < NumberOfJobs; started++)
+            {
+                while (running.load() >= ParallelJobs)
+                    running.wait(ParallelJobs);
+
+                running++;
+                runner.Start(command, [&running](ProcessResult &)
+                             {
+                    running--;
+                    running.notify_one(); });
+                if (started == ParallelJobs)
+                    peakThreads = CountThreads();
+            }
+            runner.Wait();
+        }
+        timer.Report(NumberOfJobs);
+        std::cout << "    peak threads: " << peakThreads << std::endl;
+    }
+
+    std::filesystem::remove_all(std::filesystem::path(compiler).parent_path());
+}
@@ -0,0 +1,52 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "Benchmark.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+//**************************************************************
+// Allocation counting
+//**************************************************************
+
+static std::atomic<size_t> allocationCount = 0;
+static std::atomic<size_t> allocationBytes = 0;
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    allocationBytes += size;
+    if (void *memory = std::malloc(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+AllocationStats GetAllocationStats()
+{
+    return {allocationCount.load(), allocationBytes.load()};
+}
+
+//**************************************************************
+// Main program
+//**************************************************************
+
+int main()
+{
+    BenchPathTable();
+    BenchBuildPlan();
+    BenchConfigStartup();
+    BenchProcessRunner();
+    return 0;
+}
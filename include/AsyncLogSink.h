@@ -0,0 +1,93 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <semaphore.h>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Asynchronous line sink for the Logger.
+ *
+ * Any number of threads push complete lines into a bounded lock-free ring
+ * buffer, a single writer thread drains it and writes whole batches to the
+ * output streams with one flush per batch. Lines are never split,
+ * interleaved or reordered, also across the two streams. A full ring applies
+ * back pressure on the producers instead of dropping lines.
+ */
+class AsyncLogSink
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        bool isError;
+        std::string line;
+
+        Slot() : sequence(0), isError(false), line() {}
+    };
+
+    std::ostream &out;
+    std::ostream &err;
+    std::ofstream logFile;
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    std::atomic<size_t> enqueuePosition;
+    size_t dequeuePosition; // Only touched by the writer thread
+    std::atomic<size_t> writtenPosition;
+
+    sem_t available;                 // Posted when the writer waits for a line, and by flushes; sem_post is async-signal-safe
+    std::atomic<bool> writerWaiting; // The writer is about to wait for available
+    std::atomic<bool> stopping;
+    std::thread writer;
+
+    bool IsLineReady() const;
+    bool Pop(bool &isError, std::string &line);
+    void WriterLoop();
+
+public:
+    /*!
+     * @param out Stream for regular lines.
+     * @param err Stream for warnings and errors.
+     * @param capacity Number of lines the ring holds, rounded up to a power of two.
+     * @param logFilePath Optional file that receives every line as well.
+     */
+    AsyncLogSink(std::ostream &out, std::ostream &err, size_t capacity = 4096, const std::string &logFilePath = "");
+    ~AsyncLogSink();
+
+    AsyncLogSink(const AsyncLogSink &) = delete;
+    AsyncLogSink &operator=(const AsyncLogSink &) = delete;
+
+    void Push(std::string line, bool isError);
+
+    /*!
+     * Blocks until every line pushed before the call has been written.
+     */
+    void Flush();
+
+    /*!
+     * Flush for signal handlers. Only uses atomics, sem_post and nanosleep and
+     * gives up after the timeout if a line is never completed, e.g. because
+     * the interrupted thread was in the middle of pushing it.
+     */
+    void FlushFromSignal(int timeoutMilliseconds = 1000);
+
+    /*!
+     * Writes the remaining lines and joins the writer thread.
+     */
+    void Stop();
+
+    bool HasLogFile() const { return logFile.is_open(); }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//**************************************************************
+// Global function prototypes
+//**************************************************************
+
+/*!
+ * Computes a 64 bit FNV-1a hash of the given bytes.
+ *
+ * @param data The bytes to hash.
+ * @param seed The hash to continue from, allows hashing several parts.
+ * @return The hash value.
+ */
+extern uint64_t HashBytes(std::string_view data, uint64_t seed = 14695981039346656037ull);
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Serializes integers and strings into a little endian byte buffer.
+ */
+class BinaryWriter
+{
+private:
+    std::string buffer;
+
+public:
+    BinaryWriter() : buffer() {}
+
+    void WriteU32(uint32_t value);
+    void WriteU64(uint64_t value);
+    void WriteString(std::string_view value);
+    void WriteStrings(const std::vector<std::string> &values);
+
+    const std::string &GetBuffer() const { return buffer; }
+
+    /*!
+     * Writes the buffer to a temporary file and renames it to the given path,
+     * so readers never see a partially written file.
+     */
+    bool SaveToFile(const std::string &path) const;
+};
+
+/*!
+ * Reads values written by BinaryWriter.
+ *
+ * Reading past the end does not throw but marks the reader invalid and
+ * returns zero values, so a truncated or corrupt file is detected by a
+ * single IsValid() check after reading.
+ */
+class BinaryReader
+{
+private:
+    std::string_view data;
+    size_t position;
+    bool valid;
+
+public:
+    explicit BinaryReader(std::string_view data) : data(data), position(0), valid(true) {}
+
+    uint32_t ReadU32();
+    uint64_t ReadU64();
+    std::string_view ReadString();
+    void ReadStrings(std::vector<std::string> &values);
+
+    bool IsValid() const { return valid; }
+    bool AtEnd() const { return position == data.size(); }
+};
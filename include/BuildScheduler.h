@@ -0,0 +1,274 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "CommandTrace.h"
+#include "HostJobSlots.h"
+#include "JobServer.h"
+#include "ProcessRunner.h"
+#include "SystemLoad.h"
+#include "XMakefileParser.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Runs the jobs of a build: custom commands, compile jobs, links and their
+ * pre- and post-build commands, all of them on a ProcessRunner.
+ *
+ * Every configuration added with AddTarget() is a target of its own. Their
+ * jobs share the job slots, so a target links while the next one is still
+ * compiling. A target is linked once the targets it depends on are. Its
+ * custom commands run before its source files are discovered, because they
+ * may generate some of them.
+ *
+ * The build is a pipeline: a discovery thread scans the source paths of one
+ * target after the other and checks every file it finds for staleness,
+ * stale files are queued and started on the runner as soon as a job slot is
+ * free. The runner's reactor thread hands finished jobs back to the thread
+ * calling Run().
+ */
+class BuildScheduler
+{
+private:
+    enum class CommandState
+    {
+        Waiting,
+        Running,
+        Done
+    };
+    enum class JobKind
+    {
+        Command,
+        PreBuild,
+        Compile,
+        Link,
+        PostBuild
+    };
+    enum class TargetState
+    {
+        Compiling,
+        Linking,
+        UpToDate,
+        Built,
+        Failed,
+        Cancelled
+    };
+
+    // Files that failed in the last build and files edited since their last
+    // compile go first, the newest edit first, so the diagnostics that matter
+    // show up right away and a failing build stops early. The others go
+    // longest first: a long job started last would stretch the end of the
+    // build while the other slots idle.
+    enum class JobUrgency
+    {
+        Normal,
+        Edited,
+        FailedBefore
+    };
+
+    // Wall time of a compile job and the size of its source file, which
+    // estimates the time of sources compiled for the first time
+    struct JobTime
+    {
+        uint64_t milliseconds;
+        uint64_t sourceBytes;
+        bool failed; // The last compile failed, the file goes first next time
+    };
+
+    struct StaleJob
+    {
+        size_t target;
+        size_t pool;
+        BuildStruct buildStruct;
+        JobUrgency urgency;
+        std::filesystem::file_time_type modified; // Of the source, orders edited files
+        uint64_t estimate;                        // Milliseconds, from the last build or the size of the source
+        size_t sequence;                          // Discovery order, breaks ties
+    };
+
+    struct Target
+    {
+        XMakefileParser *parser;
+        ConfigSnapshot config;
+        std::string name;
+        std::string label;                // Prefix of the messages about this target if several are built
+        std::vector<size_t> dependencies; // Targets whose artifacts this one links
+        bool diagnosticsColor;            // Compiler output is captured, so the compiler needs to be told about colors
+        size_t numberOfSources;           // Written by the discovery thread until the target is discovered
+        bool discovered;                  // Guarded by the state mutex
+        size_t queuedJobs;                // Guarded by the state mutex
+        unsigned int runningJobs;         // Jobs of this target on the runner
+        int numberOfBuilds;
+        bool preBuildDone;                // Guarded by the state mutex, stale jobs wait in preBuildJobs until then
+        size_t buildCommands;             // Pre- or post-build commands finished, they run one after the other
+        bool buildCommandRunning;
+        bool linked;                      // The post-build commands run once it is set
+        bool failed;
+        TargetState state;
+        std::unordered_map<std::string, uint64_t> artifactHashes; // Of the dependencies, stored once this target is linked
+        std::vector<std::vector<size_t>> commandInputs;           // Per custom command, the commands that create its inputs
+        std::vector<CommandState> commandStates;
+        CommandTrace commandTrace;                                // Inputs and outputs of the traced custom commands, from their last run
+        std::vector<std::pair<std::string, size_t>> poolPatterns; // Source file patterns and the pools their compile jobs run in
+        bool commandsDone;                                        // Guarded by the state mutex, discovery waits for it
+        bool commandsFailed;                                      // Guarded by the state mutex
+        bool listFailed;                                          // Guarded by the state mutex, the source files could not be listed
+        std::unordered_map<std::string, JobTime> jobTimes;        // By object file, from the last builds, read by the discovery thread
+        std::unordered_set<std::string> listedObjects;            // Object files of the sources, written by the discovery thread
+        std::vector<StaleJob> preBuildJobs;                       // Guarded by the state mutex, stale jobs waiting for the pre-build commands
+        std::unordered_map<std::string, JobTime> measuredTimes;   // Compile jobs of this build
+        double millisecondsPerByte;                               // Estimate for sources without history
+        uint64_t longestCommand;                                  // Wall times of this build in milliseconds
+        uint64_t longestCompile;
+        std::string longestCompileFile;
+        uint64_t linkTime;
+    };
+
+    struct FinishedJob
+    {
+        size_t target;
+        JobKind kind;
+        size_t pool;
+        size_t commandIndex; // Of the custom, pre- or post-build command
+        BuildStruct buildStruct;
+        std::string command;
+        uint64_t milliseconds;
+        ProcessResult result;
+    };
+
+    // Discovery holds the jobs of a target with history for this long, or until this many are held
+    static constexpr std::chrono::milliseconds JobHoldWindow{50};
+    static constexpr size_t MaxHeldJobs = 256;
+
+    bool verbose;
+    unsigned int jobLimit;     // -j
+    unsigned int failureLimit; // Failed jobs after which the build stops, 0 keeps going through all of them
+    JobServer jobServer;
+    HostJobSlots hostJobSlots;
+    SystemLoad systemLoad;
+
+    // Pools limit the jobs assigned to them on top of -j. They are shared by
+    // name across the targets, the smallest depth wins. The first pool holds
+    // the jobs of no pool and is only limited by -j.
+    std::vector<std::string> poolNames;
+    std::vector<unsigned int> poolDepths;
+    size_t linkPool;
+
+    std::vector<Target> targets;
+    std::vector<size_t> buildOrder;
+
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    std::condition_variable commandsFinished;     // Only the discovery thread waits for it
+    std::vector<std::vector<StaleJob>> staleJobs; // Guarded by the state mutex, one heap per pool with the most urgent job on top
+    std::vector<FinishedJob> finishedJobs;        // Guarded by the state mutex
+    size_t discoveredTargets;                     // Guarded by the state mutex
+
+    // Only touched by the thread calling Run()
+    unsigned int numberOfFailures;
+    unsigned int runningJobs;
+    std::vector<unsigned int> poolRunningJobs;
+    bool interruptBuild;
+    bool waitingForToken; // A job slot is taken by another process, polled for
+    bool holdingBack;     // The host is overloaded, sampled again
+    bool overloadReported;
+    std::unordered_set<std::string> createdDirectories;
+
+    ProcessRunner runner; // Declared after everything its callbacks touch, so it is destroyed first
+
+    static int CompareUrgency(const StaleJob &first, const StaleJob &second);
+    static bool IsLessUrgent(const StaleJob &first, const StaleJob &second);
+    static std::unordered_map<std::string, JobTime> LoadJobTimes(const std::string &file);
+    static void SaveJobTimes(const std::string &file, const std::unordered_map<std::string, JobTime> &times);
+
+    void DiscoverTargets();
+    void QueueStaleJob(StaleJob job);
+    bool StartJob(size_t index, JobKind kind, size_t pool, size_t commandIndex, const BuildStruct &buildStruct, const std::string &command);
+    bool HasFreeSlot(size_t pool) const;
+    bool ReserveJobSlot(size_t startingJobs);
+    void ReleaseUnusedSlots();
+    void CountFailure();
+    void StartReadyCommands();
+    void StartBuildCommands();
+    void LinkCompiledTargets();
+    void FinishCommand(FinishedJob &job);
+    void FinishBuildCommand(FinishedJob &job);
+    void FinishLink(FinishedJob &job);
+    void FinishCompile(FinishedJob &job);
+    void StartStaleJobs();
+    bool IsDone() const;
+    void SaveJobHistory();
+    void ReportCriticalPath() const;
+    void PrintSummary() const;
+
+public:
+    explicit BuildScheduler(bool verbose);
+
+    BuildScheduler(const BuildScheduler &) = delete;
+    BuildScheduler &operator=(const BuildScheduler &) = delete;
+
+    /*!
+     * Limits the jobs running at the same time, -j.
+     */
+    void SetJobLimit(unsigned int jobs) { jobLimit = jobs; }
+
+    /*!
+     * Stops the build after the given number of failed jobs, 0 keeps going
+     * through all of them, -k.
+     */
+    void SetFailureLimit(unsigned int failures) { failureLimit = failures; }
+
+    /*!
+     * New jobs wait while the host is overloaded, one job always runs so the
+     * build goes on.
+     */
+    void SetLoadLimits(const SystemLoadLimits &limits) { systemLoad = SystemLoad(limits); }
+
+    /*!
+     * A job exceeding the memory limit fails instead of pushing the host into
+     * swap, see ProcessRunner::SetMemoryLimit().
+     */
+    void SetJobMemoryLimit(uint64_t bytes) { runner.SetMemoryLimit(bytes); }
+
+    /*!
+     * With a jobserver every job but the first needs a token as well. Connect
+     * to the one of make or create one before Run().
+     */
+    JobServer &GetJobServer() { return jobServer; }
+
+    /*!
+     * With a host-wide limit every job needs a host slot. Open it before Run().
+     */
+    HostJobSlots &GetHostJobSlots() { return hostJobSlots; }
+
+    /*!
+     * Adds the current configuration of a parser as a target.
+     *
+     * @param name Shown in the summary.
+     * @param label Prefix of the messages about the target, empty if only one target is built.
+     * @param dependencies Indices of the targets whose artifacts this one links, in the order they are added.
+     */
+    void AddTarget(XMakefileParser *parser, const std::string &name, const std::string &label, const std::vector<size_t> &dependencies);
+
+    /*!
+     * Builds the targets and prints a summary if there are several.
+     *
+     * @param order Indices of the targets, each one after its dependencies.
+     *              Discovery and links follow it.
+     * @return True if no target failed or was cancelled.
+     */
+    bool Run(const std::vector<size_t> &order);
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Dependencies of custom commands recorded by the file access tracer.
+ *
+ * A traced command runs with libxmaketrace.so preloaded, which logs every
+ * file the command and its child processes open, probe, write or remove.
+ * After a successful run the log is reduced to the files the command read
+ * (inputs), the files it left behind (outputs), and the paths it looked for
+ * without finding them (absent paths). The command is stale once its command
+ * line changed, an input changed or disappeared after the run started, an
+ * output is missing, or an absent path was created.
+ *
+ * The records of one configuration are stored in one file in its output
+ * directory.
+ */
+class CommandTrace
+{
+private:
+    struct Record
+    {
+        uint64_t commandHash;
+        int64_t startTime; // file_time_type ticks, inputs written later make the command stale
+        std::vector<std::string> inputs;
+        std::vector<std::string> outputs;
+        std::vector<std::string> absentPaths;
+
+        Record() : commandHash(0), startTime(0), inputs(), outputs(), absentPaths() {}
+    };
+
+    static constexpr std::string_view Magic = "xmake-command-trace";
+    static constexpr uint32_t Version = 1;
+
+    std::string file;
+    std::map<std::string, Record> records;       // By command name
+    std::map<std::string, int64_t> runningSince; // Commands started with Begin()
+
+    std::string GetLogFile(const std::string &name) const;
+
+public:
+    CommandTrace() : file(), records(), runningSince() {}
+
+    /*!
+     * Locates libxmaketrace.so: $XMAKE_TRACE_LIBRARY, next to the xmake
+     * executable, or in ../lib/xmake relative to it.
+     *
+     * @return The absolute path, empty if the library is not available.
+     */
+    static const std::string &GetTracerLibrary();
+
+    /*!
+     * Reads the records stored in the given file. A missing or outdated
+     * file leaves no records, so every traced command runs once.
+     */
+    void Load(const std::string &path);
+    bool Save() const;
+
+    bool IsStale(const std::string &name, const std::string &command) const;
+
+    const std::vector<std::string> &GetInputs(const std::string &name) const;
+    const std::vector<std::string> &GetOutputs(const std::string &name) const;
+
+    /*!
+     * Prepares a traced run of the command.
+     *
+     * @return The command line that runs the command with the tracer preloaded.
+     */
+    std::string Begin(const std::string &name, const std::string &command);
+
+    /*!
+     * Reduces the log of a run started with Begin() to the record of the
+     * command. The record of a failed or cancelled run is dropped, so the
+     * command runs again.
+     */
+    void Finish(const std::string &name, const std::string &command, bool succeeded);
+};
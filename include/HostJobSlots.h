@@ -0,0 +1,74 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <string>
+#include <utility>
+#include <vector>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Job slots shared by all xmake processes of a host.
+ *
+ * Every slot is a file in a lock directory, and a process owns the slots
+ * it holds an flock() on. The kernel drops the locks of a process that
+ * exits or is killed, so a crashed build can not leak slots the way it
+ * would leak the count of a named semaphore.
+ *
+ * Besides a host slot, each job takes a slot of the share of its user, so
+ * the builds of one user can not take the whole host.
+ */
+class HostJobSlots
+{
+private:
+    std::string directory;
+    unsigned int hostSlots;
+    unsigned int userSlots; // 0 for no per-user limit
+    std::vector<std::pair<int, int>> heldSlots; // Locked host and user slot files
+
+    int LockSlot(const std::string &prefix, unsigned int count) const;
+
+public:
+    HostJobSlots() : directory(), hostSlots(0), userSlots(0), heldSlots() {}
+    ~HostJobSlots();
+
+    HostJobSlots(const HostJobSlots &) = delete;
+    HostJobSlots &operator=(const HostJobSlots &) = delete;
+
+    /*!
+     * The lock directory used if none is given: /run/xmake if it exists or
+     * can be created, the temporary directory otherwise.
+     */
+    static std::string GetDefaultDirectory();
+
+    /*!
+     * Joins the host-wide budget kept in the given directory, which is
+     * created if needed.
+     *
+     * @param slots Jobs of all xmake processes of the host.
+     * @param slotsPerUser Jobs of the xmake processes of the current user, 0 for no limit.
+     * @return False if the directory can not be used.
+     */
+    bool Open(const std::string &lockDirectory, unsigned int slots, unsigned int slotsPerUser);
+
+    bool IsActive() const { return hostSlots > 0; }
+
+    /*!
+     * Takes a free slot without waiting.
+     *
+     * @return True if a slot was taken.
+     */
+    bool TryAcquire();
+
+    /*!
+     * Gives back the slot taken last.
+     */
+    void Release();
+
+    unsigned int GetHeldSlots() const { return static_cast<unsigned int>(heldSlots.size()); }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <string>
+#include <vector>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * GNU make jobserver, see "POSIX Jobserver Interaction" in the make manual.
+ *
+ * The jobserver is a pipe or a named fifo holding one byte per job slot
+ * beyond the first. Every process of a build owns one implicit slot and
+ * reads a token before it starts each further job, and writes the token
+ * back once that job is done. So make, xmake and every make or compiler
+ * started by them share the slots of the top-level -j.
+ *
+ * As a client xmake joins the jobserver named in MAKEFLAGS. As a server it
+ * creates one and exports it through MAKEFLAGS to the commands it starts.
+ * Tokens are read through a non-blocking file description of our own, the
+ * one shared with other processes is left blocking as make expects it.
+ */
+class JobServer
+{
+public:
+    enum class Style
+    {
+        Fifo, // --jobserver-auth=fifo:PATH, GNU make 4.4 and later
+        Pipe  // --jobserver-auth=R,W, inherited file descriptors, understood by older versions as well
+    };
+
+private:
+    int readFd;  // Non-blocking, private to this process
+    int writeFd;
+    int pipeFds[2];     // Served pipe, inherited by the child processes
+    std::string fifoPath; // Served fifo, removed by the destructor
+    std::string auth;     // Value of --jobserver-auth
+    std::vector<char> heldTokens;
+
+    void Close();
+
+public:
+    JobServer() : readFd(-1), writeFd(-1), pipeFds{-1, -1}, fifoPath(), auth(), heldTokens() {}
+    ~JobServer();
+
+    JobServer(const JobServer &) = delete;
+    JobServer &operator=(const JobServer &) = delete;
+
+    /*!
+     * Extracts the jobserver of MAKEFLAGS, the last --jobserver-auth or
+     * --jobserver-fds option wins.
+     *
+     * @return The value of the option, empty if MAKEFLAGS names no jobserver.
+     */
+    static std::string FindAuth(const std::string &makeFlags);
+
+    /*!
+     * Joins the jobserver of a parent make.
+     *
+     * @param auth Value of --jobserver-auth as returned by FindAuth().
+     * @return False if the jobserver can not be opened, e.g. because the
+     *         parent did not pass its file descriptors on.
+     */
+    bool Connect(const std::string &auth);
+
+    /*!
+     * Creates a jobserver for the given number of jobs.
+     */
+    bool Create(unsigned int jobs, Style style);
+
+    bool IsActive() const { return readFd >= 0; }
+
+    /*!
+     * Takes a token without waiting.
+     *
+     * @return True if a token was taken.
+     */
+    bool TryAcquire();
+
+    /*!
+     * Gives back the token taken last.
+     */
+    void Release();
+
+    unsigned int GetHeldTokens() const { return static_cast<unsigned int>(heldTokens.size()); }
+
+    /*!
+     * Flags that tell child processes about the jobserver, appended to MAKEFLAGS.
+     */
+    std::string GetMakeFlags(unsigned int jobs) const;
+};
@@ -1,12 +1,41 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <version>
+
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+/*!
+ * Lowest level that is compiled into the binary, 0 = VERBOSE, 1 = INFO,
+ * 2 = WARNING, 3 = ERROR. Calls below it are discarded at compile time,
+ * builds defining NDEBUG drop Verbose() and LogVerbose() output.
+ */
+#ifndef XMAKE_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define XMAKE_LOG_MIN_LEVEL 1
+#else
+#define XMAKE_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+class AsyncLogSink;
 
 class Logger
 {
 private:
     static bool verboseMode;
+    static std::atomic<AsyncLogSink *> asyncSink;
+
+    static void FlushOnSignal(int signal);
+    static void Write(std::string line, bool isError);
 
 public:
     enum class LogLevel
@@ -17,10 +46,131 @@ public:
         ERROR
     };
 
+    static constexpr LogLevel MinLogLevel = static_cast<LogLevel>(XMAKE_LOG_MIN_LEVEL);
+
+#if defined(__cpp_lib_format)
+    template <typename... Args>
+    using FormatString = std::format_string<Args...>;
+#else
+    template <typename... Args>
+    using FormatString = std::type_identity_t<std::string_view>;
+#endif
+
     static void SetVerbose(bool verbose);
+    static bool IsVerbose() { return MinLogLevel <= LogLevel::VERBOSE && verboseMode; }
+
+    /*!
+     * Routes all output through an AsyncLogSink drained by a writer thread and
+     * installs handlers that flush it on SIGINT, SIGTERM and SIGHUP. It is also
+     * flushed at exit. Until then lines are written synchronously.
+     *
+     * @param logFile Optional file that receives a copy of every line.
+     * @return False if the log file could not be opened.
+     */
+    static bool StartAsync(const std::string &logFile = "");
+
+    /*!
+     * Writes the remaining lines and returns to synchronous output. Must not
+     * race with threads that are still logging.
+     */
+    static void StopAsync();
+
+    /*!
+     * Blocks until every line logged so far has been written.
+     */
+    static void Flush();
+
     static void Log(LogLevel level, const std::string &message);
     static void LogVerbose(const std::string &message);
     static void LogInfo(const std::string &message);
     static void LogWarning(const std::string &message);
     static void LogError(const std::string &message);
+
+    /*!
+     * Writes the captured output of a command to stderr as one block without
+     * a level prefix. Lines of other threads never end up inside it.
+     */
+    static void LogOutput(std::string output);
+
+    /*!
+     * std::format style logging. The message is only formatted if the level
+     * is enabled, e.g. Logger::Verbose("Skipping: {} (up to date)", file).
+     */
+    template <typename... Args>
+    static void Verbose([[maybe_unused]] FormatString<Args...> format, [[maybe_unused]] Args &&...args)
+    {
+        if constexpr (MinLogLevel <= LogLevel::VERBOSE)
+        {
+            if (verboseMode)
+                Log(LogLevel::VERBOSE, Format(format, std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename... Args>
+    static void Info([[maybe_unused]] FormatString<Args...> format, [[maybe_unused]] Args &&...args)
+    {
+        if constexpr (MinLogLevel <= LogLevel::INFO)
+            Log(LogLevel::INFO, Format(format, std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    static void Warning([[maybe_unused]] FormatString<Args...> format, [[maybe_unused]] Args &&...args)
+    {
+        if constexpr (MinLogLevel <= LogLevel::WARNING)
+            Log(LogLevel::WARNING, Format(format, std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    static void Error(FormatString<Args...> format, Args &&...args)
+    {
+        Log(LogLevel::ERROR, Format(format, std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    static std::string Format(FormatString<Args...> format, Args &&...args)
+    {
+#if defined(__cpp_lib_format)
+        return std::format(format, std::forward<Args>(args)...);
+#else
+        // Minimal fallback for standard libraries without <format>, supports {} and escaped braces
+        std::string message;
+        std::string_view remaining = format;
+        (AppendArgument(message, remaining, args), ...);
+        AppendLiteral(message, remaining, remaining.size());
+        return message;
+#endif
+    }
+
+private:
+#if !defined(__cpp_lib_format)
+    static void AppendLiteral(std::string &message, std::string_view &remaining, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            message += remaining[i];
+            if ((remaining[i] == '{' || remaining[i] == '}') && i + 1 < length && remaining[i + 1] == remaining[i])
+                i++;
+        }
+        remaining.remove_prefix(length);
+    }
+
+    template <typename T>
+    static void AppendArgument(std::string &message, std::string_view &remaining, const T &value)
+    {
+        // Find the next replacement field, skipping escaped braces
+        size_t position = 0;
+        while ((position = remaining.find('{', position)) != std::string_view::npos &&
+               position + 1 < remaining.size() && remaining[position + 1] == '{')
+            position += 2;
+        if (position == std::string_view::npos || position + 1 >= remaining.size())
+            return;
+
+        AppendLiteral(message, remaining, position);
+        remaining.remove_prefix(remaining.find('}') + 1);
+
+        std::ostringstream stream;
+        stream << value;
+        message += stream.str();
+    }
+#endif
 };
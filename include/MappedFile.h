@@ -0,0 +1,43 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Read-only memory mapping of a whole file. The mapping is released when the
+ * object is destroyed or Close() is called, views into it become invalid then.
+ */
+class MappedFile
+{
+private:
+    const char *data;
+    size_t size;
+
+public:
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /*!
+     * Maps the file at path. An empty file opens successfully with an empty view.
+     *
+     * @param path The file to map.
+     * @return True if the file could be opened.
+     */
+    bool Open(const std::string &path);
+    void Close();
+
+    std::string_view View() const { return std::string_view(data, size); }
+    size_t Size() const { return size; }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "StringArena.h"
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//**************************************************************
+// Types
+//**************************************************************
+
+using PathId = uint32_t;
+
+constexpr PathId InvalidPathId = UINT32_MAX;
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Process-wide table of interned paths.
+ *
+ * Every distinct path is stored exactly once in a StringArena and
+ * identified by a 32 bit id. The views returned by Get() stay valid for
+ * the lifetime of the process, so discovery, the build plan and the
+ * persisted build state can all refer to the same storage.
+ */
+class PathTable
+{
+private:
+    StringArena arena;                                // Holds the path characters
+    std::vector<std::string_view> paths;              // Id to path
+    std::unordered_map<std::string_view, PathId> ids; // Path to id
+
+    mutable std::shared_mutex mutex;
+
+public:
+    PathTable();
+
+    PathTable(const PathTable &) = delete;
+    PathTable &operator=(const PathTable &) = delete;
+
+    static PathTable &Instance();
+
+    PathId Intern(std::string_view path);
+    PathId Find(std::string_view path) const;
+    std::string_view Get(PathId id) const;
+
+    size_t Size() const;
+    size_t MemoryUsage() const;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Result of a command run through ProcessRunner.
+ */
+struct ProcessResult
+{
+    bool started;       // False if the shell could not be spawned
+    bool cancelled;     // True if CancelAll() stopped the command or kept it from starting
+    int exitCode;       // Exit status, 128 + signal number if the command was killed
+    std::string output; // stdout and stderr in the order they arrived
+
+    ProcessResult() : started(false), cancelled(false), exitCode(-1), output() {}
+};
+
+/*!
+ * Runs shell commands with their output captured instead of written to the
+ * terminal, so the output of parallel jobs can be printed in one piece once
+ * a job has finished.
+ *
+ * Each runner owns one reactor thread that waits for all of its children at
+ * once: their output pipes and a pidfd per child are registered with one
+ * epoll instance, so hundreds of commands can run without a thread each.
+ */
+class ProcessRunner
+{
+public:
+    /*!
+     * Called on the reactor thread once a command has exited and its pipes
+     * are drained, or right away if it could not be started. Output of
+     * processes the command left running in the background is not waited for.
+     */
+    using Callback = std::function<void(ProcessResult &result)>;
+
+private:
+    struct Child
+    {
+        pid_t pid;
+        int pidFd;  // -1 if the kernel has no pidfd_open, the child is reaped once its pipes are closed
+        int outFd;  // -1 once closed
+        int errFd;  // -1 once closed
+        int openPipes;
+        bool exited;
+        bool terminated;
+        std::chrono::steady_clock::time_point killDeadline;
+        ProcessResult result;
+        Callback onExit;
+
+        Child() : pid(-1), pidFd(-1), outFd(-1), errFd(-1), openPipes(0), exited(false), terminated(false), killDeadline(), result(), onExit() {}
+    };
+
+    static std::atomic<bool> cancelled;
+
+    int epollFd;
+    int wakeFd; // eventfd that hands new children to the reactor
+    std::string limits; // Shell commands run before every command, see SetMemoryLimit()
+    bool watchingCancellation;
+
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::vector<std::unique_ptr<Child>> pending; // Spawned, not yet adopted by the reactor
+    size_t running;                              // Started and not yet reported
+    bool stopping;
+
+    // Only touched by the reactor thread
+    std::unordered_map<int, Child *> fdOwners;
+    std::unordered_map<Child *, std::unique_ptr<Child>> children;
+
+    std::thread reactor;
+
+    void ReactorLoop();
+    void Adopt(std::unique_ptr<Child> child);
+    void WatchCancellation(bool watch);
+    void Terminate(Child &child);
+    void ReadPipe(Child &child, int fd);
+    void DrainPipes(Child &child);
+    void DropPipe(Child &child, int fd);
+    void FinishIfDone(Child &child);
+    int NextTimeout() const;
+
+public:
+    ProcessRunner();
+
+    /*!
+     * Waits for the running commands and stops the reactor thread.
+     */
+    ~ProcessRunner();
+
+    ProcessRunner(const ProcessRunner &) = delete;
+    ProcessRunner &operator=(const ProcessRunner &) = delete;
+
+    /*!
+     * Starts the command through /bin/sh -c in its own process group and
+     * returns without waiting for it. stdout and stderr are captured, stdin
+     * is /dev/null. onExit is called exactly once, also if the command could
+     * not be started.
+     *
+     * @param command The command line to run.
+     * @param onExit Receives the exit code and the captured output.
+     */
+    void Start(const std::string &command, Callback onExit);
+
+    /*!
+     * Limits the address space of the commands started from now on, so a
+     * command needing more memory fails instead of pushing the host into
+     * swap. The limit is set by the shell with ulimit -v and applies to each
+     * process of a command on its own.
+     *
+     * @param bytes The limit, 0 for none.
+     */
+    void SetMemoryLimit(uint64_t bytes);
+
+    /*!
+     * Blocks until every started command has been reported.
+     */
+    void Wait();
+
+    /*!
+     * Sends SIGTERM to the process groups of all running commands, SIGKILL if
+     * they are still alive two seconds later, and makes further commands
+     * return without starting anything. Async-signal-safe.
+     */
+    static void CancelAll();
+
+    /*!
+     * Allows commands to run again after CancelAll().
+     */
+    static void ResetCancellation();
+
+    static bool IsCancelled() { return cancelled.load(std::memory_order_acquire); }
+};
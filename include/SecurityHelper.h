@@ -4,6 +4,7 @@
 // Includes
 //**************************************************************
 
+#include "ProcessRunner.h"
 #include <string>
 
 //**************************************************************
@@ -19,4 +20,15 @@
  * @param command The command to be executed.
  * @return true if the command was executed successfully, false otherwise.
  */
-extern bool ExecuteCommand(const std::string &command);
\ No newline at end of file
+extern bool ExecuteCommand(const std::string &command);
+
+/*!
+ * Validates a command and starts it on the given runner without waiting for
+ * it, see ProcessRunner::Start().
+ *
+ * @param runner The runner that owns the command while it runs.
+ * @param command The command to be executed.
+ * @param onExit Called with the result once the command is done, not called if the validation failed.
+ * @return false if the validation failed.
+ */
+extern bool StartCommandCaptured(ProcessRunner &runner, const std::string &command, ProcessRunner::Callback onExit);
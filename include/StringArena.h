@@ -0,0 +1,47 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Append-only storage for many small strings.
+ *
+ * Strings are copied into large blocks and returned as views which stay
+ * valid until Clear() is called or the arena is destroyed. Every stored
+ * string is null terminated, so the views can be passed to C APIs through
+ * data(). The arena itself is not thread safe.
+ */
+class StringArena
+{
+private:
+    static constexpr size_t BlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks; // Blocks holding the characters
+    size_t blockUsed;                            // Bytes used in the current block
+    size_t arenaSize;                            // Total bytes allocated
+
+    char *Allocate(size_t size);
+
+public:
+    StringArena();
+
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+
+    std::string_view Store(std::string_view text);
+    std::string_view Concat(std::initializer_list<std::string_view> parts);
+
+    void Clear();
+    size_t MemoryUsage() const { return arenaSize; }
+};
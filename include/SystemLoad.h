@@ -0,0 +1,75 @@
+#pragma once
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+/*!
+ * Limits of SystemLoad, 0 disables a limit.
+ */
+struct SystemLoadLimits
+{
+    double MaxLoad;              // 1-minute load average of /proc/loadavg
+    double MaxCpuPressure;       // "some avg10" of /proc/pressure/cpu in percent
+    double MaxMemoryPressure;    // "some avg10" of /proc/pressure/memory in percent
+    double MaxIoPressure;        // "some avg10" of /proc/pressure/io in percent
+    uint64_t MinAvailableMemory; // MemAvailable of /proc/meminfo in bytes
+
+    SystemLoadLimits() : MaxLoad(0), MaxCpuPressure(0), MaxMemoryPressure(0), MaxIoPressure(0), MinAvailableMemory(0) {}
+};
+
+/*!
+ * Tells whether the host is too busy to start another job, based on the
+ * load average, the pressure stall information (PSI) of the kernel and the
+ * memory available. Values the kernel does not provide, e.g. PSI before
+ * Linux 4.20, are not checked.
+ */
+class SystemLoad
+{
+private:
+    static constexpr std::chrono::milliseconds SampleInterval{250};
+
+    std::string procDir;
+    SystemLoadLimits limits;
+    std::chrono::steady_clock::time_point nextSample;
+    std::string overload; // Limit exceeded at the last sample, empty if none
+
+public:
+    explicit SystemLoad(const SystemLoadLimits &loadLimits, const std::string &procDirectory = "/proc")
+        : procDir(procDirectory), limits(loadLimits), nextSample(), overload() {}
+
+    /*!
+     * Parses --max-pressure: a percentage for cpu, memory and io, or
+     * resource=percentage pairs separated by commas, e.g. "memory=10,io=40".
+     *
+     * @return False if the value is invalid, limits are unchanged then.
+     */
+    static bool ParsePressureLimits(const std::string &value, SystemLoadLimits &loadLimits);
+
+    bool IsActive() const;
+
+    /*!
+     * Reads the current values and compares them with the limits.
+     *
+     * @return True if a limit is exceeded.
+     */
+    bool Sample();
+
+    /*!
+     * Like Sample(), but reads the values at most every SampleInterval.
+     */
+    bool IsOverloaded();
+
+    /*!
+     * Describes the limit exceeded at the last sample, e.g. "memory pressure 12.5% > 10%".
+     */
+    const std::string &GetReason() const { return overload; }
+};
@@ -10,22 +10,50 @@
 // Classes
 //**************************************************************
 
+/*!
+ * Holds the configurations of an xmakefile. FromJSON only extracts the raw
+ * values; a configuration is resolved (paths made absolute, variables
+ * expanded, commands split) the first time it is requested, so selecting
+ * one of many configurations does not pay for all of them.
+ */
 class XMakefile
 {
-public:
-    std::vector<XMakefileConfig> configs;
+private:
+    struct ConfigEntry
+    {
+        XMakefileConfig raw;                       // Values as written in the xmakefile
+        std::string basePath;                      // Directory the paths are relative to
+        ConfigSnapshot resolved;                   // Created on first access
+    };
+
+    std::vector<ConfigEntry> configs;
 
+public:
     XMakefile() : configs() {}
 
-    void FromJSON(const JsonVariant &doc, const std::string &basePath)
-    {
-        // Extract configurations
-        JsonArray configsArray = doc["configurations"].as<JsonArray>();
-        for (JsonVariant config : configsArray)
-        {
-            XMakefileConfig cfg;
-            cfg.FromJSON(config, basePath);
-            configs.push_back(cfg);
-        }
-    }
+    void FromJSON(const JsonVariant &doc, const std::string &basePath);
+    void Clear() { configs.clear(); }
+
+    size_t ConfigCount() const { return configs.size(); }
+    bool Empty() const { return configs.empty(); }
+    const std::string &GetConfigName(size_t index) const { return configs.at(index).raw.Name; }
+
+    const XMakefileConfig &GetConfig(size_t index) { return *GetSnapshot(index); }
+    ConfigSnapshot GetSnapshot(size_t index);
+    ConfigSnapshot FindConfig(const std::string &name);
+
+    size_t ResolvedConfigCount() const;
+
+    /*!
+     * Returns the process environment variables the resolved configurations
+     * looked up, nullopt for variables that were not set.
+     */
+    std::map<std::string, std::optional<std::string>> GetReferencedEnvironment() const;
+
+    /*!
+     * Writes the raw configurations and those resolved so far, Deserialize
+     * restores them without touching the JSON document.
+     */
+    void Serialize(BinaryWriter &writer) const;
+    bool Deserialize(BinaryReader &reader);
 };
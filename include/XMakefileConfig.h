@@ -8,6 +8,55 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <optional>
+
+class BinaryWriter;
+class BinaryReader;
+
+//**************************************************************
+// Structures
+//**************************************************************
+
+/*!
+ * Configuration of another xmakefile that is built before the dependent
+ * configuration is linked.
+ */
+struct XMakefileDependency
+{
+    std::string XMakefile; // Resolved against the directory of the dependent xmakefile
+    std::string Config;    // Empty selects the configuration with the same name, or the first one
+};
+
+/*!
+ * Command that creates files, e.g. a code generator. It runs before the
+ * source files of its configuration are compiled, and only if an output is
+ * missing or older than one of the inputs.
+ */
+struct XMakefileCustomCommand
+{
+    std::string Name;
+    std::string Command;
+    std::vector<std::string> Inputs;
+    std::vector<std::string> Outputs; // Generated source files are compiled with the other sources
+    bool Trace;                       // Files the command accesses are recorded as further inputs and outputs
+
+    XMakefileCustomCommand() : Name(), Command(), Inputs(), Outputs(), Trace(false) {}
+};
+
+/*!
+ * Named limit on the number of jobs that run at once, on top of -j, for jobs
+ * that need a lot of memory. Pools with the same name are shared by all
+ * configurations of a build.
+ */
+struct XMakefilePool
+{
+    std::string Name;
+    unsigned int Depth;             // At least one
+    std::vector<std::string> Files; // Patterns of the source files compiled in the pool, the pool "link" also takes the link jobs
+
+    XMakefilePool() : Name(), Depth(1), Files() {}
+};
 
 //**************************************************************
 // Classes
@@ -17,10 +66,12 @@ class XMakefileConfig
 {
 private:
     std::map<std::string, std::string> envVars;
+    std::map<std::string, std::optional<std::string>> referencedEnvironment; // Process environment looked up during resolution, nullopt if unset
 
-    static std::string ResolveEnvironmentVariables(const std::string &path, const std::map<std::string, std::string> &envVars);
+    std::string ResolveEnvironmentVariables(const std::string &path);
     static std::string ResolveCommand(const std::string &command, const std::string &basePath);
-    static std::string Resolve(const std::string &command, const std::string &basePath, const std::map<std::string, std::string> &envVars);
+    std::string Resolve(const std::string &command, const std::string &basePath);
+    static void ExtractList(const JsonArray &values, std::vector<std::string> &output);
 
 public:
     std::string Name;
@@ -44,6 +95,8 @@ public:
     std::vector<std::string> LibraryPaths;
     std::vector<std::string> Libraries;
     std::vector<std::string> SourcePaths;
+    std::vector<std::string> Sources;
+    std::string SourceListFile;
     std::vector<std::string> ExcludePaths;
     std::vector<std::string> ExcludeFiles;
     std::vector<std::string> PreBuildCommands;
@@ -53,6 +106,9 @@ public:
     std::vector<std::string> InstallCommands;
     std::vector<std::string> UninstallCommands;
     std::vector<std::string> CleanCommands;
+    std::vector<XMakefileDependency> Dependencies;
+    std::vector<XMakefileCustomCommand> CustomCommands;
+    std::vector<XMakefilePool> Pools;
 
     XMakefileConfig();
 
@@ -61,7 +117,30 @@ public:
     static std::string ResolvePath(const std::string &path, const std::string &basePath);
     static std::string ResolveLibraryPath(const std::string &path, const std::string &basePath);
 
-    void PrintEnvironmentVariables();
+    void PrintEnvironmentVariables() const;
 
     void FromJSON(const JsonVariant &doc, const std::string &basePath);
+
+    /*!
+     * Copies the raw values of a configuration out of the JSON document
+     * without touching the file system or the environment.
+     */
+    void Extract(const JsonVariant &doc);
+
+    /*!
+     * Resolves the extracted paths and commands relative to basePath and
+     * expands the ${...} variables. Must be called exactly once after Extract.
+     */
+    void ResolvePaths(const std::string &basePath);
+
+    const std::map<std::string, std::optional<std::string>> &GetReferencedEnvironment() const { return referencedEnvironment; }
+
+    void Serialize(BinaryWriter &writer) const;
+    bool Deserialize(BinaryReader &reader);
 };
+
+/*!
+ * A resolved configuration is never modified, consumers share it by
+ * reference count instead of copying its strings and vectors.
+ */
+using ConfigSnapshot = std::shared_ptr<const XMakefileConfig>;
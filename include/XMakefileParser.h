@@ -5,12 +5,22 @@
 //**************************************************************
 
 #include "XMakefile.h"
+#include "PathTable.h"
+#include "StringArena.h"
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/types.h>
 
 //**************************************************************
 // Structures
@@ -18,11 +28,13 @@
 
 struct BuildStruct
 {
-    std::string buildString;
-    std::string objectFile;
-    std::string sourceFile;
+    std::string_view buildString; // Stored in the command arena of the parser
+    std::string_view objectFile;  // Interned in the PathTable
+    std::string_view sourceFile;  // Interned in the PathTable
+    PathId objectId;
+    PathId sourceId;
 
-    BuildStruct() : buildString(), objectFile(), sourceFile() {}
+    BuildStruct() : buildString(), objectFile(), sourceFile(), objectId(InvalidPathId), sourceId(InvalidPathId) {}
 
     bool empty() const
     {
@@ -30,6 +42,61 @@ struct BuildStruct
     }
 };
 
+/*!
+ * Receives every build structure as soon as it is created, see
+ * XMakefileParser::CreateBuildList().
+ */
+using BuildStructCallback = std::function<void(const BuildStruct &buildStruct)>;
+
+/*!
+ * File lists found while scanning directories, shared by the parsers of
+ * several configurations so the paths they have in common are scanned once.
+ */
+class DiscoveryCache
+{
+private:
+    struct Entry
+    {
+        std::vector<PathId> files;
+        std::vector<PathId> scannedPaths; // Directories that make up the snapshot fingerprint
+
+        Entry() : files(), scannedPaths() {}
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+
+public:
+    DiscoveryCache() : mutex(), entries() {}
+
+    bool Find(const std::string &key, std::vector<PathId> &files, std::vector<PathId> &scannedPaths);
+    void Store(const std::string &key, const std::vector<PathId> &files, const std::vector<PathId> &scannedPaths);
+};
+
+/*!
+ * Identifies a file system object independent of the path used to reach it.
+ * Two paths with the same device and inode refer to the same file, which
+ * catches overlapping source paths as well as symlinks into the same tree.
+ */
+struct FileId
+{
+    dev_t device;
+    ino_t inode;
+
+    bool operator==(const FileId &other) const
+    {
+        return device == other.device && inode == other.inode;
+    }
+};
+
+struct FileIdHash
+{
+    size_t operator()(const FileId &id) const
+    {
+        return std::hash<dev_t>()(id.device) ^ (std::hash<ino_t>()(id.inode) << 1);
+    }
+};
+
 //**************************************************************
 // Enums
 //**************************************************************
@@ -49,57 +116,143 @@ enum RebuildScheme
 class XMakefileParser
 {
 private:
+    enum class SourceLanguage
+    {
+        C,
+        CXX,
+        Unknown
+    };
+
     bool verbose = false; // Verbose mode flag
 
     std::string xmakefilePath;
-    std::string xmakefileContent;
+    uint64_t xmakefileHash; // Hash of the xmakefile content, key of the build plan cache
     std::string xmakefileName;
     std::string xmakefileDir;
 
     std::atomic<size_t> buildStructureIndex = 0; // Atomic index for build strings to ensure thread safety
-    std::vector<std::string> sourceFiles;        // List of source files to be compiled
-    std::vector<std::string> headerFiles;        // List of header files to check date
-    std::vector<std::string> libraryFiles;       // Storage for library files
+    std::vector<PathId> sourceFiles;             // List of source files to be compiled
+    std::vector<PathId> headerFiles;             // List of header files to check date
+    std::vector<PathId> libraryFiles;            // Storage for library files
     std::vector<BuildStruct> buildStructures;
     std::string linkString;
 
+    std::array<std::string, 2> compileTemplates;        // Compiler, flags, includes and defines per language
+    std::string canonicalOutputDir;                     // Cached weakly canonical output directory
+    std::unordered_map<PathId, PathId> objectFileCache; // Source file to object file
+    StringArena commandArena;                           // Storage for the build strings
+
+    std::unordered_set<FileId, FileIdHash> discoveredFiles;       // Files already reported by FindFiles
+    std::unordered_set<FileId, FileIdHash> discoveredDirectories; // Directories already scanned by FindFiles
+    std::shared_ptr<DiscoveryCache> discoveryCache;               // Optional, shared with the parsers of other configurations
+
+    static constexpr std::string_view BuildPlanMagic = "xmake-build-plan";
+    static constexpr uint32_t BuildPlanVersion = 4;
+
+    std::vector<PathId> snapshotPaths; // Directories and files whose modification times make up the snapshot fingerprint
+    bool planCacheable;                // False if the file lists can not be tracked by the snapshot
+
     // storage for last modified times
-    std::map<std::string, std::string> lastModifiedTimes;
+    std::unordered_map<PathId, std::string> lastModifiedTimes;
+
+    static constexpr std::string_view XMakefileCacheMagic = "xmake-xmakefile-cache";
+    static constexpr uint32_t XMakefileCacheVersion = 5;
+
+    XMakefile xmakefile;                  // Parsed xmakefile structure
+    size_t cachedResolvedConfigs;         // Resolved configurations contained in the xmakefile cache
+    ConfigSnapshot currentConfig;         // Current configuration, shared with xmakefile and consumers
+
+    static const ConfigSnapshot &EmptyConfig();
 
-    JsonDocument jsonDoc; // JSON document to hold the parsed content
+    static size_t FindErrorOffset(std::string_view content);
+    static std::string DescribeLocation(std::string_view content, size_t offset);
 
-    XMakefile xmakefile;           // Parsed xmakefile structure
-    XMakefileConfig currentConfig; // Current configuration being parsed
+    using FileFoundCallback = std::function<void(PathId file)>;
 
-    void UpdateFileLists();
-    void UpdateLists(const std::vector<std::string> &paths, const std::vector<std::string> &extensions, std::vector<std::string> &outputFiles);
-    void FindFiles(const std::string &path, const std::vector<std::string> &extensions, std::vector<std::string> &outputFiles);
+    bool UpdateFileLists(const FileFoundCallback &onSourceFound);
+    void UpdateLists(const std::vector<std::string> &paths, const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound = {});
+    void FindFiles(const std::string &path, const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound);
+    void AddGeneratedFiles(const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound);
+    bool UpdateListsFromManifest(const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound);
+    void AddBuildStruct(PathId sourceId, const BuildStructCallback &onBuildStruct);
 
-    bool CheckFileModifications(const std::vector<std::string> &files, const std::string &fileType);
+    bool IsExcludedPath(const std::string &path) const;
+    bool IsExcludedFile(const std::filesystem::path &path) const;
+
+    static bool GetFileId(const std::string &path, FileId &fileId);
+
+    void PrepareCompileTemplates();
+    static SourceLanguage GetSourceLanguage(std::string_view sourceFile);
+    PathId GetObjectFile(PathId sourceId);
+
+    bool CheckFileModifications(const std::vector<PathId> &files, const std::string &fileType);
+    void UpdateBuildTimes(const std::vector<PathId> &files);
+
+    static std::vector<PathId> InternPaths(const std::vector<std::string> &paths);
+
+    std::string GetXMakefileCacheFile() const;
+    bool LoadXMakefileCache();
+    void SaveXMakefileCache();
+
+    std::string GetBuildPlanFile() const;
+    static uint64_t ComputeSnapshotFingerprint(const std::vector<PathId> &paths);
+    bool LoadBuildPlan();
+    void SaveBuildPlan();
 
     std::string FileTimestampToString(const std::filesystem::file_time_type &fileTime);
     std::filesystem::file_time_type StringToFileTimestamp(const std::string &timestamp);
 
 public:
     XMakefileParser();
+    XMakefileParser(const XMakefileParser &) = delete;
+    XMakefileParser &operator=(const XMakefileParser &) = delete;
 
     void SetVerbose(bool verbose) { this->verbose = verbose; }
     std::string GetXMakefileName() const { return xmakefileName; }
     std::string GetXMakefileDir() const { return xmakefileDir; }
-    std::string GetXMakefileContent() const { return xmakefileContent; }
-    std::string GetOutputFilename() const { return currentConfig.OutputFilename; }
-    XMakefileConfig GetCurrentConfig() const { return currentConfig; }
+    std::string GetXMakefileContent() const;
+    std::string GetOutputFilename() const { return currentConfig->OutputFilename; }
+    ConfigSnapshot GetCurrentConfig() const { return currentConfig; }
     const std::string &GetLinkerString() const { return linkString; }
     const std::vector<BuildStruct> &GetBuildStructures() { return buildStructures; }
 
     bool Parse(const std::string &path);
+
+    /*!
+     * Takes over the xmakefile another parser has already parsed, including
+     * the configurations it resolved, instead of reading it again.
+     */
+    void ParseFrom(const XMakefileParser &other);
+
+    std::vector<std::string> GetConfigNames() const;
     bool SetConfig(const std::string &configName);
 
-    void CreateBuildList();
+    /*!
+     * Creates the build structures and the link command of the current
+     * configuration. Header files are found first, source files are handed
+     * to onBuildStruct while the source paths are still being scanned, so
+     * the caller can start compiling before discovery is complete.
+     *
+     * @param onBuildStruct Optional callback, called on the calling thread.
+     * @return False if the source list file of the configuration can not be read.
+     */
+    bool CreateBuildList(const BuildStructCallback &onBuildStruct = {});
     void ResetBuildIndex();
 
+    /*!
+     * Lets directory scans be reused by other parsers using the same cache.
+     */
+    void SetDiscoveryCache(std::shared_ptr<DiscoveryCache> cache) { discoveryCache = std::move(cache); }
+
     RebuildScheme CheckRebuild();
 
+    /*!
+     * True if a header changed since the last build or there is no last
+     * build, every source has to be compiled then. Header files are known
+     * once CreateBuildList() reported the first build structure.
+     */
+    bool HeadersChanged();
+
     void LoadBuildTimes();
     void SaveBuildTimes();
 };
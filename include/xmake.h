@@ -9,7 +9,9 @@
 #include <atomic>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 //**************************************************************
@@ -19,23 +21,37 @@
 class XMake
 {
 private:
-    XMakefileParser parser;
+    XMakefileParser parser;                                     // First selected configuration
+    std::vector<std::unique_ptr<XMakefileParser>> extraParsers;      // Further configurations built along with the first one
+    std::vector<std::unique_ptr<XMakefileParser>> dependencyParsers; // Configurations the selected ones depend on
+    std::vector<std::vector<size_t>> targetDependencies;             // Per entry of GetParsers(), the entries linked first
+    std::vector<size_t> buildOrder;                                  // Entries of GetParsers(), each one after its dependencies
     const CmdLineParser &cmdLineParser;
-    std::string selectedConfig;
+    std::vector<std::string> selectedConfigs;
     bool verbose = false;
 
-    void SaveBuildTimes();
+    std::vector<XMakefileParser *> GetParsers();
+    bool AddDependencies(size_t index, std::unordered_map<std::string, size_t> &targetIndices, std::vector<int> &visitStates);
 
 public:
     XMake(const CmdLineParser &cmdLineParser);
 
+    /*!
+     * Parses the xmakefile and selects the configurations given with -c,
+     * a comma separated list, or all of them with --all-configs.
+     */
     bool Init(const std::string &makefileName);
 
     void PrintEnvironmentVariables()
     {
-        parser.GetCurrentConfig().PrintEnvironmentVariables();
+        parser.GetCurrentConfig()->PrintEnvironmentVariables();
     }
 
+    /*!
+     * Builds the selected configurations. Their compile and link jobs share
+     * one pool of -j slots, so one configuration links while the next one
+     * is still compiling.
+     */
     bool Build();
     void Clean();
     void Run();
@@ -0,0 +1,220 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "AsyncLogSink.h"
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+
+// Upper bound of a single write, the rest of the ring is drained in the next round
+static constexpr size_t MaxBatchSize = 64 * 1024;
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+AsyncLogSink::AsyncLogSink(std::ostream &out, std::ostream &err, size_t capacity, const std::string &logFilePath)
+    : out(out),
+      err(err),
+      logFile(),
+      slots(),
+      mask(0),
+      enqueuePosition(0),
+      dequeuePosition(0),
+      writtenPosition(0),
+      available(),
+      writerWaiting(false),
+      stopping(false),
+      writer()
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+
+    slots = std::make_unique<Slot[]>(size);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    if (!logFilePath.empty())
+    {
+        logFile.open(logFilePath, std::ios::out | std::ios::trunc);
+    }
+
+    sem_init(&available, 0, 0);
+    writer = std::thread(&AsyncLogSink::WriterLoop, this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+    Stop();
+    sem_destroy(&available);
+}
+
+void AsyncLogSink::Push(std::string line, bool isError)
+{
+    // Bounded multi producer queue: claim a slot by advancing the enqueue position,
+    // publish it by bumping the slot sequence
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true)
+    {
+        slot = &slots[position & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+        if (difference == 0)
+        {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // Ring is full, wake the writer and wait for it to make room
+            sem_post(&available);
+            std::this_thread::yield();
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->line = std::move(line);
+    slot->isError = isError;
+    slot->sequence.store(position + 1, std::memory_order_seq_cst);
+
+    // Only a waiting writer needs a wake-up, a busy one finds the line on its own
+    if (writerWaiting.exchange(false, std::memory_order_seq_cst))
+        sem_post(&available);
+}
+
+void AsyncLogSink::Flush()
+{
+    size_t target = enqueuePosition.load(std::memory_order_acquire);
+    sem_post(&available);
+
+    size_t written = writtenPosition.load(std::memory_order_acquire);
+    while (written < target)
+    {
+        writtenPosition.wait(written, std::memory_order_acquire);
+        written = writtenPosition.load(std::memory_order_acquire);
+    }
+}
+
+void AsyncLogSink::FlushFromSignal(int timeoutMilliseconds)
+{
+    size_t target = enqueuePosition.load(std::memory_order_acquire);
+    sem_post(&available);
+
+    timespec delay{0, 1000000};
+    for (int i = 0; i < timeoutMilliseconds && writtenPosition.load(std::memory_order_acquire) < target; i++)
+    {
+        nanosleep(&delay, nullptr);
+    }
+}
+
+void AsyncLogSink::Stop()
+{
+    if (!writer.joinable())
+        return;
+
+    stopping.store(true, std::memory_order_release);
+    sem_post(&available);
+    writer.join();
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+bool AsyncLogSink::IsLineReady() const
+{
+    return slots[dequeuePosition & mask].sequence.load(std::memory_order_seq_cst) == dequeuePosition + 1;
+}
+
+bool AsyncLogSink::Pop(bool &isError, std::string &line)
+{
+    Slot &slot = slots[dequeuePosition & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+        return false;
+
+    line = std::move(slot.line);
+    slot.line.clear();
+    isError = slot.isError;
+    slot.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+    dequeuePosition++;
+    return true;
+}
+
+void AsyncLogSink::WriterLoop()
+{
+    // Signal handlers flush through this thread, so they must never run on it
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::string batch;
+    bool batchIsError = false;
+    std::string fileBatch;
+    std::string line;
+    bool isError = false;
+
+    // Lines of one stream are written together, the batch is flushed when the stream changes,
+    // so lines keep their order also where both streams go to the same terminal
+    auto writeBatch = [&]()
+    {
+        std::ostream &stream = batchIsError ? err : out;
+        stream.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        stream.flush();
+        batch.clear();
+    };
+
+    while (true)
+    {
+        // Producers only post while the writer waits, so it announces that and looks once more
+        writerWaiting.store(true, std::memory_order_seq_cst);
+        if (!IsLineReady())
+        {
+            while (sem_wait(&available) != 0 && errno == EINTR)
+            {
+            }
+        }
+        writerWaiting.store(false, std::memory_order_seq_cst);
+
+        // Drain what is published
+        while (batch.size() < MaxBatchSize && Pop(isError, line))
+        {
+            if (!batch.empty() && isError != batchIsError)
+                writeBatch();
+            batchIsError = isError;
+            batch += line;
+            batch += '\n';
+            if (logFile.is_open())
+            {
+                fileBatch += line;
+                fileBatch += '\n';
+            }
+        }
+
+        if (!batch.empty())
+            writeBatch();
+        if (!fileBatch.empty())
+        {
+            logFile.write(fileBatch.data(), static_cast<std::streamsize>(fileBatch.size()));
+            logFile.flush();
+            fileBatch.clear();
+        }
+
+        writtenPosition.store(dequeuePosition, std::memory_order_release);
+        writtenPosition.notify_all();
+
+        if (stopping.load(std::memory_order_acquire) && dequeuePosition == enqueuePosition.load(std::memory_order_acquire))
+            break;
+    }
+}
@@ -0,0 +1,141 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "BinaryStream.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+//**************************************************************
+// Global functions
+//**************************************************************
+
+uint64_t HashBytes(std::string_view data, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//**************************************************************
+// BinaryWriter
+//**************************************************************
+
+void BinaryWriter::WriteU32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void BinaryWriter::WriteU64(uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void BinaryWriter::WriteString(std::string_view value)
+{
+    WriteU32(static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+void BinaryWriter::WriteStrings(const std::vector<std::string> &values)
+{
+    WriteU32(static_cast<uint32_t>(values.size()));
+    for (const auto &value : values)
+    {
+        WriteString(value);
+    }
+}
+
+bool BinaryWriter::SaveToFile(const std::string &path) const
+{
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+//**************************************************************
+// BinaryReader
+//**************************************************************
+
+uint32_t BinaryReader::ReadU32()
+{
+    if (!valid || data.size() - position < 4)
+    {
+        valid = false;
+        return 0;
+    }
+
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[position++])) << (i * 8);
+    }
+    return value;
+}
+
+uint64_t BinaryReader::ReadU64()
+{
+    if (!valid || data.size() - position < 8)
+    {
+        valid = false;
+        return 0;
+    }
+
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[position++])) << (i * 8);
+    }
+    return value;
+}
+
+std::string_view BinaryReader::ReadString()
+{
+    uint32_t size = ReadU32();
+    if (!valid || data.size() - position < size)
+    {
+        valid = false;
+        return std::string_view();
+    }
+
+    std::string_view value = data.substr(position, size);
+    position += size;
+    return value;
+}
+
+void BinaryReader::ReadStrings(std::vector<std::string> &values)
+{
+    values.clear();
+    uint32_t count = ReadU32();
+    for (uint32_t i = 0; i < count && valid; i++)
+    {
+        values.emplace_back(ReadString());
+    }
+}
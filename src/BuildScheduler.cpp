@@ -0,0 +1,1225 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "BuildScheduler.h"
+#include "BinaryStream.h"
+#include "MappedFile.h"
+#include "SecurityHelper.h"
+#include <Logger.h>
+#include <algorithm>
+#include <chrono>
+#include <fnmatch.h>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <unistd.h>
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static bool UseDiagnosticsColor(const std::string &compiler);
+static void WriteCommandLog(const std::string &logFile, const std::string &output);
+static uint64_t HashArtifact(const std::string &path);
+static bool IsCommandStale(const XMakefileCustomCommand &command);
+static bool IsTraced(const XMakefileCustomCommand &command);
+static bool IsSamePath(const std::string &first, const std::string &second);
+static bool MatchesPoolPattern(const std::string &pattern, std::string_view sourceFile);
+static std::unordered_map<std::string, uint64_t> LoadArtifactHashes(const std::string &file);
+static void SaveArtifactHashes(const std::string &file, const std::unordered_map<std::string, uint64_t> &hashes);
+static std::string FormatSeconds(uint64_t milliseconds);
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+BuildScheduler::BuildScheduler(bool verbose)
+    : verbose(verbose),
+      jobLimit(1),
+      failureLimit(1),
+      jobServer(),
+      hostJobSlots(),
+      systemLoad(SystemLoadLimits()),
+      poolNames{""},
+      poolDepths{std::numeric_limits<unsigned int>::max()},
+      linkPool(0),
+      targets(),
+      buildOrder(),
+      stateMutex(),
+      stateChanged(),
+      commandsFinished(),
+      staleJobs(),
+      finishedJobs(),
+      discoveredTargets(0),
+      numberOfFailures(0),
+      runningJobs(0),
+      poolRunningJobs(),
+      interruptBuild(false),
+      waitingForToken(false),
+      holdingBack(false),
+      overloadReported(false),
+      createdDirectories(),
+      runner()
+{
+}
+
+void BuildScheduler::AddTarget(XMakefileParser *parser, const std::string &name, const std::string &label, const std::vector<size_t> &dependencies)
+{
+    ConfigSnapshot targetConfig = parser->GetCurrentConfig();
+
+    Target target{};
+    target.parser = parser;
+    target.config = targetConfig;
+    target.name = name;
+    target.label = label;
+    target.dependencies = dependencies;
+    target.diagnosticsColor = UseDiagnosticsColor(targetConfig->Compiler);
+    target.state = TargetState::Compiling;
+    target.preBuildDone = targetConfig->PreBuildCommands.empty();
+
+    // Sources without history are estimated at the average speed of the others
+    target.jobTimes = LoadJobTimes(targetConfig->OutputDir + "/job_times.txt");
+    uint64_t knownMilliseconds = 0;
+    uint64_t knownBytes = 0;
+    for (const auto &[objectFile, time] : target.jobTimes)
+    {
+        knownMilliseconds += time.milliseconds;
+        knownBytes += time.sourceBytes;
+    }
+    target.millisecondsPerByte = knownBytes > 0 ? static_cast<double>(knownMilliseconds) / static_cast<double>(knownBytes) : 0.01;
+
+    for (const auto &pool : targetConfig->Pools)
+    {
+        size_t poolIndex = static_cast<size_t>(std::find(poolNames.begin(), poolNames.end(), pool.Name) - poolNames.begin());
+        if (poolIndex == poolNames.size())
+        {
+            poolNames.push_back(pool.Name);
+            poolDepths.push_back(pool.Depth);
+        }
+        poolDepths[poolIndex] = std::min(poolDepths[poolIndex], pool.Depth);
+        for (const auto &file : pool.Files)
+            target.poolPatterns.push_back({file, poolIndex});
+    }
+
+    const auto &commands = targetConfig->CustomCommands;
+    if (std::any_of(commands.begin(), commands.end(), [](const XMakefileCustomCommand &command)
+                    { return command.Trace; }))
+    {
+        if (CommandTrace::GetTracerLibrary().empty())
+            Logger::Warning("{}libxmaketrace.so not found, traced custom commands only use their declared inputs and outputs.", target.label);
+        target.commandTrace.Load(targetConfig->OutputDir + "/custom_commands.trace");
+    }
+
+    // A custom command waits for the commands whose outputs it reads, declared or traced in the last run
+    target.commandInputs.resize(commands.size());
+    target.commandStates.assign(commands.size(), CommandState::Waiting);
+    target.commandsDone = commands.empty();
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        std::vector<std::string> inputs = commands[i].Inputs;
+        const auto &tracedInputs = target.commandTrace.GetInputs(commands[i].Name);
+        inputs.insert(inputs.end(), tracedInputs.begin(), tracedInputs.end());
+
+        for (size_t j = 0; j < commands.size(); j++)
+        {
+            std::vector<std::string> outputs = commands[j].Outputs;
+            const auto &tracedOutputs = target.commandTrace.GetOutputs(commands[j].Name);
+            outputs.insert(outputs.end(), tracedOutputs.begin(), tracedOutputs.end());
+
+            bool readsOutput = std::any_of(inputs.begin(), inputs.end(), [&outputs](const std::string &input)
+                                           { return std::any_of(outputs.begin(), outputs.end(), [&input](const std::string &output)
+                                                                { return IsSamePath(input, output); }); });
+            if (i != j && readsOutput)
+                target.commandInputs[i].push_back(j);
+        }
+    }
+    targets.push_back(std::move(target));
+}
+
+bool BuildScheduler::Run(const std::vector<size_t> &order)
+{
+    buildOrder = order;
+    staleJobs.assign(poolNames.size(), {});
+    poolRunningJobs.assign(poolNames.size(), 0);
+    linkPool = static_cast<size_t>(std::find(poolNames.begin(), poolNames.end(), "link") - poolNames.begin());
+    if (linkPool == poolNames.size())
+        linkPool = 0;
+
+    std::thread discovery(&BuildScheduler::DiscoverTargets, this);
+
+    StartReadyCommands();
+
+    size_t seenDiscoveredTargets = 0;
+    while (true)
+    {
+        std::vector<FinishedJob> finished;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            auto canContinue = [&]()
+            {
+                if (!finishedJobs.empty() || discoveredTargets != seenDiscoveredTargets)
+                    return true;
+                for (size_t pool = 0; pool < staleJobs.size(); pool++)
+                {
+                    if (!staleJobs[pool].empty() && (interruptBuild || (HasFreeSlot(pool) && !waitingForToken && !holdingBack)))
+                        return true;
+                }
+                // Jobs of a target waiting for its pre-build commands are stale jobs as well
+                return std::any_of(targets.begin(), targets.end(), [](const Target &target)
+                                   { return !target.preBuildDone && !target.preBuildJobs.empty() && !target.buildCommandRunning; }) &&
+                       (interruptBuild || (HasFreeSlot(0) && !waitingForToken && !holdingBack));
+            };
+
+            // Tokens and slots given back by other processes wake nobody, so they are polled for,
+            // and the load is sampled again
+            if (waitingForToken)
+                stateChanged.wait_for(lock, std::chrono::milliseconds(10), canContinue);
+            else if (holdingBack)
+                stateChanged.wait_for(lock, std::chrono::milliseconds(250), canContinue);
+            else
+                stateChanged.wait(lock, canContinue);
+
+            waitingForToken = false;
+            holdingBack = false;
+            seenDiscoveredTargets = discoveredTargets;
+            finished.swap(finishedJobs);
+        }
+
+        for (FinishedJob &job : finished)
+        {
+            Target &target = targets[job.target];
+            runningJobs--;
+            poolRunningJobs[job.pool]--;
+            target.runningJobs--;
+
+            if (job.kind == JobKind::Command)
+                FinishCommand(job);
+            else if (job.kind == JobKind::PreBuild || job.kind == JobKind::PostBuild)
+                FinishBuildCommand(job);
+            else if (job.kind == JobKind::Link)
+                FinishLink(job);
+            else
+                FinishCompile(job);
+        }
+
+        // Custom, pre- and post-build commands and links go first, they are what the other jobs of a target wait for
+        StartReadyCommands();
+        StartBuildCommands();
+        LinkCompiledTargets();
+
+        StartStaleJobs();
+
+        // Targets whose last jobs were just dropped are done as well
+        LinkCompiledTargets();
+
+        ReleaseUnusedSlots();
+
+        if (IsDone())
+            break;
+    }
+
+    discovery.join();
+
+    PrintSummary();
+    SaveJobHistory();
+    ReportCriticalPath();
+
+    size_t failedTargets = 0;
+    size_t cancelledTargets = 0;
+    for (const Target &target : targets)
+    {
+        failedTargets += target.state == TargetState::Failed;
+        cancelledTargets += target.state == TargetState::Cancelled;
+    }
+
+    if (numberOfFailures > 0 && failureLimit != 1)
+    {
+        Logger::Error("{} job(s) failed.", numberOfFailures);
+    }
+    if (cancelledTargets > 0 && failedTargets == 0)
+    {
+        Logger::Error("Build cancelled.");
+    }
+
+    return failedTargets == 0 && cancelledTargets == 0;
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+int BuildScheduler::CompareUrgency(const StaleJob &first, const StaleJob &second)
+{
+    if (first.urgency != second.urgency)
+        return first.urgency < second.urgency ? -1 : 1;
+    if (first.urgency == JobUrgency::Edited && first.modified != second.modified)
+        return first.modified < second.modified ? -1 : 1;
+    if (first.estimate != second.estimate)
+        return first.estimate < second.estimate ? -1 : 1;
+    return 0;
+}
+
+bool BuildScheduler::IsLessUrgent(const StaleJob &first, const StaleJob &second)
+{
+    int order = CompareUrgency(first, second);
+    return order != 0 ? order < 0 : first.sequence > second.sequence;
+}
+
+void BuildScheduler::DiscoverTargets()
+{
+    // Dependencies are discovered first, their links are the ones other targets wait for.
+    // Targets whose custom commands still run are passed over until they are done.
+    std::vector<size_t> remaining = buildOrder;
+    size_t sequence = 0;
+    while (!remaining.empty())
+    {
+        size_t index = 0;
+        bool skipDiscovery = false;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            auto next = remaining.end();
+            commandsFinished.wait(lock, [&]()
+                                  {
+                next = std::find_if(remaining.begin(), remaining.end(), [this](size_t candidate)
+                                    { return targets[candidate].commandsDone; });
+                return next != remaining.end(); });
+            index = *next;
+            skipDiscovery = targets[index].commandsFailed;
+            remaining.erase(next);
+        }
+
+        Target &target = targets[index];
+        bool checkedHeaders = false;
+        bool rebuildAll = false;
+
+        // With the times of the last build, files without urgency are held for
+        // a short window, so the first of them start longest first instead of
+        // in directory order. Failed and edited files never wait, and without
+        // history there is no order worth waiting for.
+        bool holdJobs = !target.jobTimes.empty();
+        auto holdUntil = std::chrono::steady_clock::now() + JobHoldWindow;
+        std::vector<StaleJob> heldJobs;
+
+        bool listed = skipDiscovery || target.parser->CreateBuildList([&](const BuildStruct &buildStruct)
+                                                                      {
+            // All headers are known before the first source file is reported
+            if (!checkedHeaders)
+            {
+                rebuildAll = target.parser->HeadersChanged();
+                checkedHeaders = true;
+            }
+            target.numberOfSources++;
+            target.listedObjects.insert(std::string(buildStruct.objectFile));
+
+            if (ProcessRunner::IsCancelled())
+                return;
+
+            // Compare the source file with its object file, a missing object file is stale
+            std::error_code sourceError;
+            std::error_code objectError;
+            auto sourceTime = std::filesystem::last_write_time(buildStruct.sourceFile, sourceError);
+            auto objectTime = std::filesystem::last_write_time(buildStruct.objectFile, objectError);
+            bool edited = !sourceError && !objectError && sourceTime > objectTime;
+            if (!rebuildAll && !sourceError && !objectError && !edited)
+            {
+                Logger::Verbose("Skipping: {} (up to date)", buildStruct.sourceFile);
+                return;
+            }
+
+            size_t pool = 0;
+            for (const auto &[pattern, poolIndex] : target.poolPatterns)
+            {
+                if (MatchesPoolPattern(pattern, buildStruct.sourceFile))
+                {
+                    pool = poolIndex;
+                    break;
+                }
+            }
+
+            JobUrgency urgency = edited ? JobUrgency::Edited : JobUrgency::Normal;
+            uint64_t estimate = 0;
+            auto history = target.jobTimes.find(std::string(buildStruct.objectFile));
+            if (history != target.jobTimes.end())
+            {
+                estimate = history->second.milliseconds;
+                if (history->second.failed)
+                    urgency = JobUrgency::FailedBefore;
+            }
+            else
+            {
+                std::error_code error;
+                uint64_t size = std::filesystem::file_size(buildStruct.sourceFile, error);
+                estimate = error ? 0 : static_cast<uint64_t>(static_cast<double>(size) * target.millisecondsPerByte);
+            }
+
+            StaleJob job{index, pool, buildStruct, urgency, sourceTime, estimate, sequence++};
+            bool held = holdJobs && urgency == JobUrgency::Normal;
+            if (held)
+            {
+                heldJobs.push_back(std::move(job));
+                if (heldJobs.size() < MaxHeldJobs && std::chrono::steady_clock::now() < holdUntil)
+                    return;
+                holdJobs = false; // The window is over, the rest goes right away
+            }
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (held)
+            {
+                for (StaleJob &heldJob : heldJobs)
+                    QueueStaleJob(std::move(heldJob));
+                target.queuedJobs += heldJobs.size();
+                heldJobs.clear();
+            }
+            else
+            {
+                QueueStaleJob(std::move(job));
+                target.queuedJobs++;
+            }
+            stateChanged.notify_one(); });
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        for (StaleJob &job : heldJobs)
+            QueueStaleJob(std::move(job));
+        target.queuedJobs += heldJobs.size();
+        target.listFailed = !listed;
+        target.discovered = true;
+        discoveredTargets++;
+        stateChanged.notify_one();
+    }
+}
+
+void BuildScheduler::QueueStaleJob(StaleJob job)
+{
+    // Called with the state mutex held. Until the pre-build commands of the
+    // target are done its jobs are kept aside, not to block the pool heaps.
+    Target &target = targets[job.target];
+    if (!target.preBuildDone)
+    {
+        target.preBuildJobs.push_back(std::move(job));
+        return;
+    }
+
+    size_t pool = job.pool;
+    staleJobs[pool].push_back(std::move(job));
+    std::push_heap(staleJobs[pool].begin(), staleJobs[pool].end(), IsLessUrgent);
+}
+
+bool BuildScheduler::StartJob(size_t index, JobKind kind, size_t pool, size_t commandIndex, const BuildStruct &buildStruct, const std::string &command)
+{
+    auto started = std::chrono::steady_clock::now();
+    auto onExit = [this, index, kind, pool, commandIndex, buildStruct, command, started](ProcessResult &result)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        finishedJobs.push_back({index, kind, pool, commandIndex, buildStruct, command, static_cast<uint64_t>(elapsed.count()), std::move(result)});
+        stateChanged.notify_one();
+    };
+
+    if (!StartCommandCaptured(runner, command, std::move(onExit)))
+        return false;
+
+    runningJobs++;
+    poolRunningJobs[pool]++;
+    targets[index].runningJobs++;
+    return true;
+}
+
+bool BuildScheduler::HasFreeSlot(size_t pool) const
+{
+    // A job of a pool starts if both the pool and -j have a free slot
+    return runningJobs < jobLimit && poolRunningJobs[pool] < poolDepths[pool];
+}
+
+bool BuildScheduler::ReserveJobSlot(size_t startingJobs)
+{
+    size_t jobs = runningJobs + startingJobs;
+    if (jobs > 0 && systemLoad.IsOverloaded())
+    {
+        if (!overloadReported)
+            Logger::Info("Holding back new jobs: {}", systemLoad.GetReason());
+        overloadReported = true;
+        holdingBack = true;
+        return false;
+    }
+    overloadReported = overloadReported && jobs == 0;
+
+    bool reserved = (!hostJobSlots.IsActive() || hostJobSlots.GetHeldSlots() > jobs || hostJobSlots.TryAcquire()) &&
+                    (!jobServer.IsActive() || jobs == 0 || jobServer.GetHeldTokens() >= jobs || jobServer.TryAcquire());
+
+    waitingForToken = waitingForToken || !reserved;
+    return reserved;
+}
+
+void BuildScheduler::ReleaseUnusedSlots()
+{
+    // The implicit slot of xmake covers one running job, the others hold a token each
+    while (jobServer.GetHeldTokens() > (runningJobs > 0 ? runningJobs - 1 : 0))
+        jobServer.Release();
+    while (hostJobSlots.GetHeldSlots() > runningJobs)
+        hostJobSlots.Release();
+}
+
+void BuildScheduler::CountFailure()
+{
+    // Fail fast once the limit is reached instead of waiting for the running jobs
+    if (++numberOfFailures == failureLimit)
+    {
+        interruptBuild = true;
+        ProcessRunner::CancelAll();
+    }
+}
+
+void BuildScheduler::StartReadyCommands()
+{
+    // Custom commands run on the runner as well, each one once the commands creating its inputs are done
+    for (size_t index : buildOrder)
+    {
+        Target &target = targets[index];
+        const auto &commands = target.config->CustomCommands;
+        bool changed = true;
+        bool blocked = false; // Ready, but no job slot is free
+        while (changed)
+        {
+            changed = false;
+            for (size_t i = 0; i < commands.size(); i++)
+            {
+                if (target.commandStates[i] != CommandState::Waiting)
+                    continue;
+
+                // Once the target failed or the build was interrupted nothing is started
+                if (target.failed || interruptBuild || ProcessRunner::IsCancelled())
+                {
+                    target.commandStates[i] = CommandState::Done;
+                    continue;
+                }
+
+                bool ready = std::all_of(target.commandInputs[i].begin(), target.commandInputs[i].end(), [&target](size_t input)
+                                         { return target.commandStates[input] == CommandState::Done; });
+                if (!ready)
+                    continue;
+
+                // A traced command is stale by its recorded accesses, and by the declared ones if it has outputs
+                bool stale = IsTraced(commands[i]) ? target.commandTrace.IsStale(commands[i].Name, commands[i].Command) ||
+                                                         (!commands[i].Outputs.empty() && IsCommandStale(commands[i]))
+                                                   : IsCommandStale(commands[i]);
+                if (!stale)
+                {
+                    Logger::Verbose("{}Skipping: {} (up to date)", target.label, commands[i].Name);
+                    target.commandStates[i] = CommandState::Done;
+                    changed = true;
+                    continue;
+                }
+
+                if (runningJobs >= jobLimit || !ReserveJobSlot(0))
+                {
+                    blocked = true;
+                    continue;
+                }
+
+                for (const auto &output : commands[i].Outputs)
+                {
+                    std::error_code error;
+                    std::filesystem::create_directories(std::filesystem::path(output).parent_path(), error);
+                }
+
+                Logger::Info("{}Generating: {}", target.label, verbose ? commands[i].Command : commands[i].Name);
+                std::string commandLine = IsTraced(commands[i]) ? target.commandTrace.Begin(commands[i].Name, commands[i].Command) : commands[i].Command;
+                if (StartJob(index, JobKind::Command, 0, i, BuildStruct(), commandLine))
+                {
+                    target.commandStates[i] = CommandState::Running;
+                }
+                else
+                {
+                    Logger::Error("{}Custom command failed: {}", target.label, commands[i].Name);
+                    target.commandStates[i] = CommandState::Done;
+                    target.failed = true;
+                    CountFailure();
+                }
+                changed = true;
+            }
+        }
+
+        bool waiting = std::find(target.commandStates.begin(), target.commandStates.end(), CommandState::Waiting) != target.commandStates.end();
+        bool running = std::find(target.commandStates.begin(), target.commandStates.end(), CommandState::Running) != target.commandStates.end();
+        if (waiting && !running && !blocked)
+        {
+            // Nothing runs and nothing can start, the commands wait for each other
+            Logger::Error("{}Custom commands depend on each other in a cycle.", target.label);
+            std::fill(target.commandStates.begin(), target.commandStates.end(), CommandState::Done);
+            target.failed = true;
+            CountFailure();
+            waiting = false;
+        }
+
+        if (!waiting && !running)
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (!target.commandsDone)
+            {
+                target.commandsDone = true;
+                target.commandsFailed = target.failed;
+                commandsFinished.notify_one();
+            }
+        }
+    }
+}
+
+void BuildScheduler::StartBuildCommands()
+{
+    // Pre-build commands run once a job of the target is stale, and not at
+    // all if nothing is, post-build commands once it is linked. They run on
+    // the runner one after the other, each in the order of the configuration.
+    for (size_t index : buildOrder)
+    {
+        Target &target = targets[index];
+        if (target.buildCommandRunning)
+            continue;
+
+        bool preBuild = false;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            preBuild = !target.preBuildDone && !target.preBuildJobs.empty();
+        }
+        if (!preBuild && !(target.linked && target.state == TargetState::Linking))
+            continue;
+
+        const std::vector<std::string> &commands = preBuild ? target.config->PreBuildCommands : target.config->PostBuildCommands;
+        if (target.buildCommands == commands.size())
+        {
+            target.buildCommands = 0;
+            if (preBuild)
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                target.preBuildDone = true;
+                for (StaleJob &job : target.preBuildJobs)
+                    QueueStaleJob(std::move(job));
+                target.preBuildJobs.clear();
+                continue;
+            }
+
+            target.state = TargetState::Built;
+            Logger::Info("{}Finished building target: {}", target.label, target.parser->GetOutputFilename());
+            target.parser->SaveBuildTimes();
+            if (!target.artifactHashes.empty())
+                SaveArtifactHashes(target.config->OutputDir + "/dependencies.txt", target.artifactHashes);
+            continue;
+        }
+
+        // A pre-build command waiting for an interrupted build is dropped along with the jobs of the target
+        if (!preBuild && (interruptBuild || ProcessRunner::IsCancelled()))
+        {
+            target.state = TargetState::Cancelled;
+            continue;
+        }
+        if (runningJobs >= jobLimit || !ReserveJobSlot(0))
+            continue;
+
+        const std::string &command = commands[target.buildCommands];
+        Logger::Verbose("{}{}-build command: {}", target.label, preBuild ? "Pre" : "Post", command);
+        if (StartJob(index, preBuild ? JobKind::PreBuild : JobKind::PostBuild, 0, target.buildCommands, BuildStruct(), command))
+        {
+            target.buildCommandRunning = true;
+        }
+        else
+        {
+            // A rejected command fails like one that ran
+            FinishedJob job{index, preBuild ? JobKind::PreBuild : JobKind::PostBuild, 0, target.buildCommands, BuildStruct(), command, 0, ProcessResult()};
+            FinishBuildCommand(job);
+        }
+    }
+}
+
+void BuildScheduler::LinkCompiledTargets()
+{
+    // A target whose source files are all compiled is linked on the runner like any other job
+    std::vector<size_t> compiledTargets;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        for (size_t index : buildOrder)
+        {
+            if (targets[index].discovered && targets[index].state == TargetState::Compiling && targets[index].queuedJobs == 0 && targets[index].runningJobs == 0)
+                compiledTargets.push_back(index);
+        }
+    }
+
+    for (size_t index : compiledTargets)
+    {
+        Target &target = targets[index];
+
+        // Wait for the dependencies, the build order makes sure those that are done are handled first
+        bool dependenciesPending = false;
+        TargetState dependencyFailure = TargetState::Compiling;
+        for (size_t dependency : target.dependencies)
+        {
+            TargetState state = targets[dependency].state;
+            if (state == TargetState::Compiling || state == TargetState::Linking)
+                dependenciesPending = true;
+            else if (state == TargetState::Failed || state == TargetState::Cancelled)
+                dependencyFailure = state;
+        }
+        if (dependenciesPending && !target.failed && !interruptBuild && !ProcessRunner::IsCancelled())
+            continue;
+
+        // Relinking is only needed if the artifact of a dependency changed, not if it was merely rebuilt
+        bool artifactsChanged = false;
+        std::vector<std::string> dependencyArtifacts;
+        if (!target.dependencies.empty() && !dependenciesPending && dependencyFailure == TargetState::Compiling)
+        {
+            std::unordered_map<std::string, uint64_t> linkedHashes = LoadArtifactHashes(target.config->OutputDir + "/dependencies.txt");
+            for (size_t dependency : target.dependencies)
+            {
+                const ConfigSnapshot &dependencyConfig = targets[dependency].config;
+                std::string artifact = dependencyConfig->OutputDir + "/" + dependencyConfig->OutputFilename;
+                uint64_t hash = HashArtifact(artifact);
+                auto linked = linkedHashes.find(artifact);
+                if (linked == linkedHashes.end() || linked->second != hash)
+                {
+                    Logger::Verbose("{}Dependency changed: {}", target.label, artifact);
+                    artifactsChanged = true;
+                }
+                target.artifactHashes[artifact] = hash;
+
+                if (dependencyConfig->BuildType == "StaticLibrary" || dependencyConfig->BuildType == "SharedLibrary")
+                    dependencyArtifacts.push_back(artifact);
+            }
+        }
+
+        if (target.failed || target.listFailed)
+        {
+            target.state = TargetState::Failed;
+        }
+        else if (dependencyFailure == TargetState::Failed)
+        {
+            Logger::Error("{}Not linked, a dependency failed.", target.label);
+            target.state = TargetState::Failed;
+        }
+        else if (target.numberOfSources == 0)
+        {
+            Logger::Error("{}No build structures found.", target.label);
+            target.state = TargetState::Failed;
+        }
+        else if (interruptBuild || ProcessRunner::IsCancelled() || dependencyFailure == TargetState::Cancelled)
+        {
+            target.state = TargetState::Cancelled;
+        }
+        else if (target.numberOfBuilds == 0 && !artifactsChanged)
+        {
+            Logger::Info("{}No changes in files.", target.label);
+            target.state = TargetState::UpToDate;
+        }
+        else if (HasFreeSlot(linkPool) && ReserveJobSlot(0))
+        {
+            // Libraries built as dependencies are linked even if they are not listed in the configuration
+            std::string linkString = target.parser->GetLinkerString();
+            for (const auto &artifact : dependencyArtifacts)
+            {
+                if (target.config->BuildType != "StaticLibrary" && linkString.find(artifact) == std::string::npos)
+                    linkString += " " + artifact;
+            }
+            Logger::Info("{}Linking: {}", target.label, verbose ? linkString : target.parser->GetOutputFilename());
+
+            if (StartJob(index, JobKind::Link, linkPool, 0, BuildStruct(), linkString))
+            {
+                target.state = TargetState::Linking;
+            }
+            else
+            {
+                Logger::Error("{}Linking failed.", target.label);
+                target.state = TargetState::Failed;
+                CountFailure();
+            }
+        }
+    }
+}
+
+void BuildScheduler::FinishCommand(FinishedJob &job)
+{
+    Target &target = targets[job.target];
+    const XMakefileCustomCommand &command = target.config->CustomCommands[job.commandIndex];
+    target.commandStates[job.commandIndex] = CommandState::Done;
+    target.longestCommand = std::max(target.longestCommand, job.milliseconds);
+    if (!job.result.cancelled)
+        Logger::LogOutput(std::move(job.result.output));
+
+    if (IsTraced(command))
+    {
+        target.commandTrace.Finish(command.Name, command.Command, !job.result.cancelled && job.result.exitCode == 0);
+        target.commandTrace.Save();
+    }
+
+    if (job.result.cancelled || job.result.exitCode != 0)
+    {
+        // Outputs written halfway must not look up to date next time
+        for (const auto &output : command.Outputs)
+        {
+            std::error_code error;
+            std::filesystem::remove(output, error);
+        }
+        if (!job.result.cancelled)
+        {
+            Logger::Error("{}Custom command failed: {}", target.label, command.Name);
+            target.failed = true;
+            CountFailure();
+        }
+    }
+}
+
+void BuildScheduler::FinishBuildCommand(FinishedJob &job)
+{
+    Target &target = targets[job.target];
+    bool preBuild = job.kind == JobKind::PreBuild;
+    target.buildCommandRunning = false;
+    if (job.result.cancelled)
+    {
+        if (!preBuild)
+            target.state = TargetState::Cancelled;
+        return;
+    }
+
+    Logger::LogOutput(std::move(job.result.output));
+    if (job.result.exitCode == 0)
+    {
+        target.buildCommands++;
+        return;
+    }
+
+    if (preBuild)
+    {
+        // Nothing of the target may build without its pre-build commands
+        Logger::Error("{}Pre-build command failed.", target.label);
+        target.failed = true;
+        interruptBuild = true;
+        ProcessRunner::CancelAll();
+    }
+    else
+    {
+        Logger::Error("{}Post-build command failed.", target.label);
+        target.state = TargetState::Failed;
+    }
+}
+
+void BuildScheduler::FinishLink(FinishedJob &job)
+{
+    Target &target = targets[job.target];
+    std::string outputFile = target.config->OutputDir + "/" + target.config->OutputFilename;
+    if (job.result.cancelled)
+    {
+        std::error_code error;
+        std::filesystem::remove(outputFile, error);
+        target.state = TargetState::Cancelled;
+        return;
+    }
+
+    WriteCommandLog(target.config->BuildDir + "/" + target.config->OutputFilename + ".link.log", job.result.output);
+    Logger::LogOutput(std::move(job.result.output));
+    target.linkTime = job.milliseconds;
+
+    if (job.result.exitCode != 0)
+    {
+        Logger::Error("{}Linking failed.", target.label);
+        target.state = TargetState::Failed;
+        CountFailure();
+        return;
+    }
+
+    // The target stays linking until its post-build commands are done
+    target.linked = true;
+}
+
+void BuildScheduler::FinishCompile(FinishedJob &job)
+{
+    Target &target = targets[job.target];
+    std::string objectFile(job.buildStruct.objectFile);
+
+    if (job.result.cancelled)
+    {
+        // Killed halfway, whatever it wrote is garbage and its output is noise
+        std::error_code error;
+        std::filesystem::remove(objectFile, error);
+        return;
+    }
+
+    // The output of a job is printed in one piece when it is done
+    WriteCommandLog(objectFile + ".log", job.result.output);
+    Logger::LogOutput(std::move(job.result.output));
+
+    if (job.result.exitCode != 0)
+    {
+        // Remembered with the time it would take to compile, for the next build
+        auto history = target.jobTimes.find(objectFile);
+        JobTime time = history != target.jobTimes.end() ? history->second : JobTime{job.milliseconds, 0, false};
+        time.failed = true;
+        target.measuredTimes[objectFile] = time;
+
+        std::error_code error;
+        std::filesystem::remove(objectFile, error);
+        Logger::Error("{} failed.", job.command);
+        target.failed = true;
+        CountFailure();
+        return;
+    }
+
+    target.numberOfBuilds++;
+
+    std::error_code error;
+    uint64_t sourceBytes = std::filesystem::file_size(job.buildStruct.sourceFile, error);
+    target.measuredTimes[objectFile] = {job.milliseconds, error ? 0 : sourceBytes, false};
+    if (job.milliseconds >= target.longestCompile)
+    {
+        target.longestCompile = job.milliseconds;
+        target.longestCompileFile = job.buildStruct.sourceFile;
+    }
+}
+
+void BuildScheduler::StartStaleJobs()
+{
+    std::vector<StaleJob> toStart;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (interruptBuild || ProcessRunner::IsCancelled())
+        {
+            // Nothing new is started once the build is interrupted
+            for (auto &queue : staleJobs)
+            {
+                for (const StaleJob &job : queue)
+                    targets[job.target].queuedJobs--;
+                queue.clear();
+            }
+            for (Target &target : targets)
+            {
+                target.queuedJobs -= target.preBuildJobs.size();
+                target.preBuildJobs.clear();
+            }
+        }
+
+        // Every slot goes to the most urgent job on top of a pool that is not
+        // full. Between equally urgent jobs the named pools go first, they are
+        // the expensive ones and would otherwise only start once every other
+        // job was started.
+        std::vector<unsigned int> starting(staleJobs.size(), 0);
+        while (runningJobs + toStart.size() < jobLimit)
+        {
+            size_t best = staleJobs.size();
+            for (size_t i = 0; i < staleJobs.size(); i++)
+            {
+                size_t pool = (i + 1) % staleJobs.size();
+                if (staleJobs[pool].empty() || poolRunningJobs[pool] + starting[pool] >= poolDepths[pool])
+                    continue;
+                if (best == staleJobs.size() || CompareUrgency(staleJobs[best].front(), staleJobs[pool].front()) < 0)
+                    best = pool;
+            }
+            if (best == staleJobs.size() || !ReserveJobSlot(toStart.size()))
+                break;
+
+            std::pop_heap(staleJobs[best].begin(), staleJobs[best].end(), IsLessUrgent);
+            toStart.push_back(std::move(staleJobs[best].back()));
+            targets[toStart.back().target].queuedJobs--;
+            staleJobs[best].pop_back();
+            starting[best]++;
+        }
+    }
+
+    for (const StaleJob &job : toStart)
+    {
+        Target &target = targets[job.target];
+        const BuildStruct &buildStruct = job.buildStruct;
+
+        if (interruptBuild)
+            continue;
+
+        // Object directories are created while discovery goes on, each one once
+        std::string objectDir = std::filesystem::path(buildStruct.objectFile).parent_path().string();
+        if (!objectDir.empty() && createdDirectories.insert(objectDir).second)
+        {
+            std::error_code error;
+            std::filesystem::create_directories(objectDir, error);
+        }
+
+        Logger::Info("Building: {}", verbose ? buildStruct.buildString : buildStruct.objectFile);
+
+        std::string buildString(buildStruct.buildString);
+        if (target.diagnosticsColor && buildString.find("diagnostics-color") == std::string::npos)
+            buildString += " -fdiagnostics-color=always";
+
+        if (!StartJob(job.target, JobKind::Compile, job.pool, 0, buildStruct, buildString))
+        {
+            Logger::Error("{} failed.", buildString);
+            target.failed = true;
+            CountFailure();
+        }
+    }
+}
+
+bool BuildScheduler::IsDone() const
+{
+    return runningJobs == 0 && std::all_of(targets.begin(), targets.end(), [](const Target &target)
+                                           { return target.state != TargetState::Compiling && target.state != TargetState::Linking; });
+}
+
+void BuildScheduler::SaveJobHistory()
+{
+    // Wall times and failures of the compiled files order the jobs of the next
+    // build. Files no longer in the source list, e.g. removed sources, are
+    // dropped, failed or not.
+    for (Target &target : targets)
+    {
+        if (target.measuredTimes.empty())
+            continue;
+
+        for (auto &[objectFile, time] : target.measuredTimes)
+            target.jobTimes[objectFile] = time;
+        if (!target.listFailed)
+            std::erase_if(target.jobTimes, [&target](const auto &entry)
+                          { return !target.listedObjects.contains(entry.first); });
+        SaveJobTimes(target.config->OutputDir + "/job_times.txt", target.jobTimes);
+    }
+}
+
+void BuildScheduler::ReportCriticalPath() const
+{
+    // The critical path is the chain of jobs that had to run one after the
+    // other: the custom commands and the longest compile of a target, or the
+    // path of a target it links if that one is longer, followed by its link.
+    // No scheduling makes the build shorter than that.
+    std::vector<uint64_t> pathLengths(targets.size(), 0);
+    std::vector<std::string> pathSteps(targets.size());
+    size_t criticalTarget = 0;
+    for (size_t index : buildOrder)
+    {
+        const Target &target = targets[index];
+        uint64_t length = target.longestCommand + target.longestCompile;
+        std::string steps;
+        if (target.longestCommand > 0)
+            steps = target.label + "custom commands " + FormatSeconds(target.longestCommand);
+        if (target.longestCompile > 0)
+            steps += (steps.empty() ? "" : ", ") + target.longestCompileFile + " " + FormatSeconds(target.longestCompile);
+
+        for (size_t dependency : target.dependencies)
+        {
+            if (pathLengths[dependency] > length)
+            {
+                length = pathLengths[dependency];
+                steps = pathSteps[dependency];
+            }
+        }
+        if (target.linkTime > 0)
+            steps += (steps.empty() ? "" : ", ") + target.label + "link " + FormatSeconds(target.linkTime);
+
+        pathLengths[index] = length + target.linkTime;
+        pathSteps[index] = steps;
+        if (pathLengths[index] > pathLengths[criticalTarget])
+            criticalTarget = index;
+    }
+    if (!pathLengths.empty() && pathLengths[criticalTarget] > 0)
+    {
+        Logger::Info("Critical path: {} ({})", FormatSeconds(pathLengths[criticalTarget]), pathSteps[criticalTarget]);
+    }
+}
+
+void BuildScheduler::PrintSummary() const
+{
+    // One summary for all targets
+    if (targets.size() <= 1)
+        return;
+
+    Logger::Info("Summary:");
+    for (const Target &target : targets)
+    {
+        switch (target.state)
+        {
+        case TargetState::UpToDate:
+            Logger::Info("  {}: up to date", target.name);
+            break;
+        case TargetState::Built:
+            Logger::Info("  {}: {} file(s) compiled, {} linked", target.name, target.numberOfBuilds, target.parser->GetOutputFilename());
+            break;
+        case TargetState::Cancelled:
+            Logger::Info("  {}: cancelled", target.name);
+            break;
+        default:
+            Logger::Info("  {}: failed", target.name);
+            break;
+        }
+    }
+}
+
+std::unordered_map<std::string, BuildScheduler::JobTime> BuildScheduler::LoadJobTimes(const std::string &file)
+{
+    // One object file per line: path|milliseconds|source bytes|failed
+    std::unordered_map<std::string, JobTime> times;
+    std::ifstream stream(file);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        // Split from the end, the path may contain the separator
+        size_t separators[3];
+        size_t end = line.size();
+        bool valid = true;
+        for (size_t &separator : separators)
+        {
+            separator = end == 0 ? std::string::npos : line.rfind('|', end - 1);
+            valid = valid && separator != std::string::npos;
+            end = valid ? separator : 0;
+        }
+        if (!valid)
+            continue;
+        try
+        {
+            times[line.substr(0, separators[2])] = {std::stoull(line.substr(separators[2] + 1, separators[1] - separators[2] - 1)),
+                                                    std::stoull(line.substr(separators[1] + 1, separators[0] - separators[1] - 1)),
+                                                    line.substr(separators[0] + 1) == "1"};
+        }
+        catch (const std::exception &)
+        {
+            // A broken line only costs the estimate of one file
+        }
+    }
+    return times;
+}
+
+void BuildScheduler::SaveJobTimes(const std::string &file, const std::unordered_map<std::string, JobTime> &times)
+{
+    std::ofstream stream(file, std::ios::out | std::ios::trunc);
+    for (const auto &[objectFile, time] : times)
+    {
+        stream << objectFile << "|" << time.milliseconds << "|" << time.sourceBytes << "|" << (time.failed ? 1 : 0) << "\n";
+    }
+}
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static bool UseDiagnosticsColor(const std::string &compiler)
+{
+    // Only compilers known to understand -fdiagnostics-color, and only when a person is watching
+    if (!isatty(STDERR_FILENO) || std::getenv("NO_COLOR") != nullptr)
+        return false;
+
+    std::string name = std::filesystem::path(compiler).filename().string();
+    return name.find("gcc") != std::string::npos || name.find("g++") != std::string::npos ||
+           name.find("clang") != std::string::npos;
+}
+
+static void WriteCommandLog(const std::string &logFile, const std::string &output)
+{
+    // A log only exists while the last run of the command said something
+    if (output.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove(logFile, error);
+        return;
+    }
+
+    // Color codes are left out, the log is meant to be read with any viewer
+    std::string text;
+    text.reserve(output.size());
+    for (size_t i = 0; i < output.size(); i++)
+    {
+        if (output[i] == '\x1b' && i + 1 < output.size() && output[i + 1] == '[')
+        {
+            i += 2;
+            while (i < output.size() && !(output[i] >= '@' && output[i] <= '~'))
+                i++;
+            continue;
+        }
+        text += output[i];
+    }
+
+    std::ofstream file(logFile, std::ios::out | std::ios::trunc);
+    file << text;
+}
+
+static uint64_t HashArtifact(const std::string &path)
+{
+    // A missing artifact hashes to zero, which never matches a linked one
+    MappedFile file;
+    if (!file.Open(path))
+        return 0;
+    return HashBytes(file.View());
+}
+
+static std::unordered_map<std::string, uint64_t> LoadArtifactHashes(const std::string &file)
+{
+    // One artifact per line: path|hash
+    std::unordered_map<std::string, uint64_t> hashes;
+    std::ifstream stream(file);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        size_t separator = line.rfind('|');
+        if (separator == std::string::npos)
+            continue;
+        try
+        {
+            hashes[line.substr(0, separator)] = std::stoull(line.substr(separator + 1));
+        }
+        catch (const std::exception &)
+        {
+            // A broken line only costs a relink
+        }
+    }
+    return hashes;
+}
+
+static void SaveArtifactHashes(const std::string &file, const std::unordered_map<std::string, uint64_t> &hashes)
+{
+    std::ofstream stream(file, std::ios::out | std::ios::trunc);
+    for (const auto &[artifact, hash] : hashes)
+    {
+        stream << artifact << "|" << hash << "\n";
+    }
+}
+
+static std::string FormatSeconds(uint64_t milliseconds)
+{
+    return std::to_string(milliseconds / 1000) + "." + std::to_string(milliseconds % 1000 / 100) + " s";
+}
+
+static bool IsCommandStale(const XMakefileCustomCommand &command)
+{
+    // Stale if an output is missing or older than any input, a missing input makes the command report it
+    std::filesystem::file_time_type oldestOutput = std::filesystem::file_time_type::max();
+    for (const auto &output : command.Outputs)
+    {
+        std::error_code error;
+        auto outputTime = std::filesystem::last_write_time(output, error);
+        if (error)
+            return true;
+        oldestOutput = std::min(oldestOutput, outputTime);
+    }
+    if (command.Outputs.empty())
+        return true;
+
+    for (const auto &input : command.Inputs)
+    {
+        std::error_code error;
+        auto inputTime = std::filesystem::last_write_time(input, error);
+        if (error || inputTime > oldestOutput)
+            return true;
+    }
+    return false;
+}
+
+static bool IsTraced(const XMakefileCustomCommand &command)
+{
+    return command.Trace && !CommandTrace::GetTracerLibrary().empty();
+}
+
+static bool IsSamePath(const std::string &first, const std::string &second)
+{
+    if (first == second)
+        return true;
+
+    std::error_code error;
+    return std::filesystem::absolute(first, error).lexically_normal() == std::filesystem::absolute(second, error).lexically_normal();
+}
+
+static bool MatchesPoolPattern(const std::string &pattern, std::string_view sourceFile)
+{
+    // Patterns without a directory match the file name, like exclude_files
+    std::filesystem::path path(sourceFile);
+    std::string subject = pattern.find('/') == std::string::npos ? path.filename().string() : path.lexically_normal().string();
+    return fnmatch(pattern.c_str(), subject.c_str(), 0) == 0;
+}
@@ -0,0 +1,262 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "CommandTrace.h"
+#include "BinaryStream.h"
+#include "MappedFile.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static std::string QuoteArgument(const std::string &argument);
+static bool IsPseudoFile(const std::string &path);
+static int64_t FileTimeTicks(std::filesystem::file_time_type time);
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+const std::string &CommandTrace::GetTracerLibrary()
+{
+    static const std::string library = []() -> std::string
+    {
+        std::error_code error;
+        const char *configured = std::getenv("XMAKE_TRACE_LIBRARY");
+        if (configured != nullptr && configured[0] != '\0')
+            return std::filesystem::exists(configured, error) ? std::filesystem::absolute(configured, error).string() : "";
+
+        std::filesystem::path executableDir = std::filesystem::read_symlink("/proc/self/exe", error).parent_path();
+        if (error)
+            return "";
+
+        for (const auto &candidate : {executableDir / "libxmaketrace.so", executableDir / "../lib/xmake/libxmaketrace.so"})
+        {
+            if (std::filesystem::exists(candidate, error))
+                return candidate.lexically_normal().string();
+        }
+        return "";
+    }();
+    return library;
+}
+
+void CommandTrace::Load(const std::string &path)
+{
+    file = path;
+    records.clear();
+
+    MappedFile mappedFile;
+    if (!mappedFile.Open(path))
+        return;
+
+    BinaryReader reader(mappedFile.View());
+    if (reader.ReadString() != Magic || reader.ReadU32() != Version)
+        return;
+
+    std::map<std::string, Record> loaded;
+    uint32_t count = reader.ReadU32();
+    for (uint32_t i = 0; i < count && reader.IsValid(); i++)
+    {
+        std::string name(reader.ReadString());
+        Record record;
+        record.commandHash = reader.ReadU64();
+        record.startTime = static_cast<int64_t>(reader.ReadU64());
+        reader.ReadStrings(record.inputs);
+        reader.ReadStrings(record.outputs);
+        reader.ReadStrings(record.absentPaths);
+        loaded[name] = std::move(record);
+    }
+
+    if (reader.IsValid() && reader.AtEnd())
+        records = std::move(loaded);
+}
+
+bool CommandTrace::Save() const
+{
+    BinaryWriter writer;
+    writer.WriteString(Magic);
+    writer.WriteU32(Version);
+    writer.WriteU32(static_cast<uint32_t>(records.size()));
+    for (const auto &[name, record] : records)
+    {
+        writer.WriteString(name);
+        writer.WriteU64(record.commandHash);
+        writer.WriteU64(static_cast<uint64_t>(record.startTime));
+        writer.WriteStrings(record.inputs);
+        writer.WriteStrings(record.outputs);
+        writer.WriteStrings(record.absentPaths);
+    }
+    return writer.SaveToFile(file);
+}
+
+bool CommandTrace::IsStale(const std::string &name, const std::string &command) const
+{
+    auto it = records.find(name);
+    if (it == records.end() || it->second.commandHash != HashBytes(command))
+        return true;
+
+    const Record &record = it->second;
+    std::error_code error;
+    for (const auto &output : record.outputs)
+    {
+        if (!std::filesystem::exists(output, error))
+            return true;
+    }
+    for (const auto &input : record.inputs)
+    {
+        auto inputTime = std::filesystem::last_write_time(input, error);
+        if (error || FileTimeTicks(inputTime) > record.startTime)
+            return true;
+    }
+    for (const auto &path : record.absentPaths)
+    {
+        if (std::filesystem::exists(path, error))
+            return true;
+    }
+    return false;
+}
+
+const std::vector<std::string> &CommandTrace::GetInputs(const std::string &name) const
+{
+    static const std::vector<std::string> none;
+    auto it = records.find(name);
+    return it != records.end() ? it->second.inputs : none;
+}
+
+const std::vector<std::string> &CommandTrace::GetOutputs(const std::string &name) const
+{
+    static const std::vector<std::string> none;
+    auto it = records.find(name);
+    return it != records.end() ? it->second.outputs : none;
+}
+
+std::string CommandTrace::Begin(const std::string &name, const std::string &command)
+{
+    std::string logFile = GetLogFile(name);
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(logFile).parent_path(), error);
+    std::filesystem::remove(logFile, error);
+    runningSince[name] = FileTimeTicks(std::filesystem::file_time_type::clock::now());
+
+    // Preloads already set for xmake are kept for the command
+    std::string preload = GetTracerLibrary();
+    const char *inherited = std::getenv("LD_PRELOAD");
+    if (inherited != nullptr && inherited[0] != '\0')
+        preload += std::string(":") + inherited;
+
+    return "LD_PRELOAD=" + QuoteArgument(preload) + " XMAKE_TRACE_FILE=" + QuoteArgument(logFile) + " " + command;
+}
+
+void CommandTrace::Finish(const std::string &name, const std::string &command, bool succeeded)
+{
+    std::string logFile = GetLogFile(name);
+    auto running = runningSince.find(name);
+    if (!succeeded || running == runningSince.end())
+    {
+        records.erase(name);
+        std::error_code error;
+        std::filesystem::remove(logFile, error);
+        return;
+    }
+
+    // Combine the accesses per path, the log names a path once per access
+    constexpr int Read = 1;
+    constexpr int Written = 2;
+    constexpr int Removed = 4;
+    std::map<std::string, int> accesses;
+    std::string normalizedLogFile = std::filesystem::absolute(logFile).lexically_normal().string();
+    std::string normalizedStore = std::filesystem::absolute(file).lexically_normal().string();
+    {
+        std::ifstream log(logFile);
+        std::string line;
+        while (std::getline(log, line))
+        {
+            if (line.size() < 3 || line[1] != ' ')
+                continue;
+
+            std::string path = std::filesystem::path(line.substr(2)).lexically_normal().string();
+            if (path.size() > 1 && path.back() == '/')
+                path.pop_back();
+            if (IsPseudoFile(path) || path == normalizedLogFile || path == normalizedStore)
+                continue;
+
+            accesses[path] |= line[0] == 'W' ? Written : line[0] == 'D' ? Removed : Read;
+        }
+    }
+
+    Record record;
+    record.commandHash = HashBytes(command);
+    record.startTime = running->second;
+    for (const auto &[path, access] : accesses)
+    {
+        std::error_code error;
+        auto status = std::filesystem::status(path, error);
+        bool exists = std::filesystem::exists(status);
+
+        // Directories change with every file created in them, listing one is not tracked
+        if (exists && std::filesystem::is_directory(status))
+            continue;
+
+        if ((access & (Written | Removed)) != 0)
+        {
+            // Files read back after writing them are outputs, temporary files are gone
+            if (exists && (access & Written) != 0)
+                record.outputs.push_back(path);
+        }
+        else if (exists)
+        {
+            record.inputs.push_back(path);
+        }
+        else
+        {
+            record.absentPaths.push_back(path);
+        }
+    }
+
+    records[name] = std::move(record);
+    runningSince.erase(running);
+    std::error_code error;
+    std::filesystem::remove(logFile, error);
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+std::string CommandTrace::GetLogFile(const std::string &name) const
+{
+    // Named by hash, command names may contain any character
+    return std::filesystem::path(file).parent_path().string() + "/.trace_" + std::to_string(HashBytes(name)) + ".log";
+}
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static std::string QuoteArgument(const std::string &argument)
+{
+    std::string quoted = "'";
+    for (char c : argument)
+    {
+        if (c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+    return quoted + "'";
+}
+
+static bool IsPseudoFile(const std::string &path)
+{
+    return path.starts_with("/proc/") || path.starts_with("/sys/") || path.starts_with("/dev/") ||
+           path == "/proc" || path == "/sys" || path == "/dev";
+}
+
+static int64_t FileTimeTicks(std::filesystem::file_time_type time)
+{
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
@@ -0,0 +1,114 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "HostJobSlots.h"
+#include <cerrno>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+HostJobSlots::~HostJobSlots()
+{
+    while (!heldSlots.empty())
+        Release();
+}
+
+std::string HostJobSlots::GetDefaultDirectory()
+{
+    std::error_code error;
+    if (std::filesystem::is_directory("/run/xmake", error) || access("/run", W_OK) == 0)
+        return "/run/xmake";
+    return std::filesystem::temp_directory_path(error).string() + "/xmake-host-jobs";
+}
+
+bool HostJobSlots::Open(const std::string &lockDirectory, unsigned int slots, unsigned int slotsPerUser)
+{
+    while (!heldSlots.empty())
+        Release();
+    hostSlots = 0;
+
+    // Sticky and writable for everybody like /tmp, the builds of all users share it
+    std::error_code error;
+    if (std::filesystem::create_directories(lockDirectory, error))
+        chmod(lockDirectory.c_str(), 01777);
+    if (slots == 0 || access(lockDirectory.c_str(), W_OK | X_OK) != 0)
+        return false;
+
+    directory = lockDirectory;
+    hostSlots = slots;
+    userSlots = slotsPerUser;
+    return true;
+}
+
+bool HostJobSlots::TryAcquire()
+{
+    if (!IsActive())
+        return false;
+
+    int userFd = -1;
+    if (userSlots > 0)
+    {
+        userFd = LockSlot("user" + std::to_string(getuid()) + ".", userSlots);
+        if (userFd < 0)
+            return false;
+    }
+
+    int hostFd = LockSlot("host.", hostSlots);
+    if (hostFd < 0)
+    {
+        if (userFd >= 0)
+            close(userFd);
+        return false;
+    }
+
+    heldSlots.emplace_back(hostFd, userFd);
+    return true;
+}
+
+void HostJobSlots::Release()
+{
+    if (heldSlots.empty())
+        return;
+
+    // Closing the only descriptor of a slot file drops its lock
+    auto [hostFd, userFd] = heldSlots.back();
+    heldSlots.pop_back();
+    close(hostFd);
+    if (userFd >= 0)
+        close(userFd);
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+int HostJobSlots::LockSlot(const std::string &prefix, unsigned int count) const
+{
+    // Start at a different slot in every process, so they do not all probe the same files first
+    unsigned int first = static_cast<unsigned int>(getpid()) % count;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        std::string path = directory + "/" + prefix + std::to_string((first + i) % count);
+
+        // Read access is enough for flock(), so slot files created by other users work as well.
+        // Those are opened without O_CREAT, which fs.protected_regular denies in sticky directories.
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0 && errno == ENOENT)
+            fd = open(path.c_str(), O_RDONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0 && errno == EEXIST)
+            fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+            return fd;
+        close(fd);
+    }
+    return -1;
+}
@@ -0,0 +1,206 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "JobServer.h"
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static int OpenPrivateReadEnd(int fd);
+static bool WriteTokens(int fd, char token, unsigned int count);
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+JobServer::~JobServer()
+{
+    // Tokens must go back, other processes of the build wait for them
+    while (!heldTokens.empty())
+        Release();
+    Close();
+}
+
+std::string JobServer::FindAuth(const std::string &makeFlags)
+{
+    std::string auth;
+    std::istringstream words(makeFlags);
+    std::string word;
+    while (words >> word)
+    {
+        // Variable assignments of the command line follow a lone "--"
+        if (word == "--")
+            break;
+
+        for (std::string_view option : {"--jobserver-auth=", "--jobserver-fds="})
+        {
+            if (word.starts_with(option))
+                auth = word.substr(option.size());
+        }
+    }
+    return auth;
+}
+
+bool JobServer::Connect(const std::string &jobServerAuth)
+{
+    Close();
+
+    if (jobServerAuth.starts_with("fifo:"))
+    {
+        std::string path = jobServerAuth.substr(5);
+        readFd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (readFd >= 0)
+            writeFd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    }
+    else
+    {
+        // Inherited pipe, make closes it for commands it does not consider recursive
+        int fds[2] = {-1, -1};
+        char separator = 0;
+        std::istringstream stream(jobServerAuth);
+        if (stream >> fds[0] >> separator >> fds[1] && separator == ',' && fcntl(fds[0], F_GETFD) != -1 && fcntl(fds[1], F_GETFD) != -1)
+        {
+            readFd = OpenPrivateReadEnd(fds[0]);
+            if (readFd >= 0)
+                writeFd = fcntl(fds[1], F_DUPFD_CLOEXEC, 0);
+        }
+    }
+
+    if (readFd < 0 || writeFd < 0)
+    {
+        Close();
+        return false;
+    }
+    auth = jobServerAuth;
+    return true;
+}
+
+bool JobServer::Create(unsigned int jobs, Style style)
+{
+    Close();
+
+    if (style == Style::Fifo)
+    {
+        static std::atomic<unsigned int> counter{0};
+        std::string path = std::filesystem::temp_directory_path().string() + "/xmake_jobserver_" +
+                           std::to_string(getpid()) + "_" + std::to_string(counter++);
+        if (mkfifo(path.c_str(), 0600) != 0)
+            return false;
+
+        fifoPath = path;
+        readFd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (readFd >= 0)
+            writeFd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        auth = "fifo:" + path;
+    }
+    else
+    {
+        // Without O_CLOEXEC, the child processes inherit the pipe
+        if (pipe(pipeFds) != 0)
+            return false;
+
+        readFd = OpenPrivateReadEnd(pipeFds[0]);
+        writeFd = fcntl(pipeFds[1], F_DUPFD_CLOEXEC, 0);
+        auth = std::to_string(pipeFds[0]) + "," + std::to_string(pipeFds[1]);
+    }
+
+    if (readFd < 0 || writeFd < 0 || !WriteTokens(writeFd, '+', jobs > 0 ? jobs - 1 : 0))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool JobServer::TryAcquire()
+{
+    if (readFd < 0)
+        return false;
+
+    char token = 0;
+    ssize_t count;
+    do
+    {
+        count = read(readFd, &token, 1);
+    } while (count < 0 && errno == EINTR);
+
+    if (count != 1)
+        return false;
+
+    heldTokens.push_back(token);
+    return true;
+}
+
+void JobServer::Release()
+{
+    if (heldTokens.empty())
+        return;
+
+    // The token is given back as it was read, make tells failures apart by it
+    WriteTokens(writeFd, heldTokens.back(), 1);
+    heldTokens.pop_back();
+}
+
+std::string JobServer::GetMakeFlags(unsigned int jobs) const
+{
+    return "-j" + std::to_string(jobs) + " --jobserver-auth=" + auth;
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+void JobServer::Close()
+{
+    for (int *fd : {&readFd, &writeFd, &pipeFds[0], &pipeFds[1]})
+    {
+        if (*fd >= 0)
+            close(*fd);
+        *fd = -1;
+    }
+    if (!fifoPath.empty())
+    {
+        unlink(fifoPath.c_str());
+        fifoPath.clear();
+    }
+    auth.clear();
+    heldTokens.clear();
+}
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static int OpenPrivateReadEnd(int fd)
+{
+    // Opening the pipe again gives a file description of its own, so it can be
+    // non-blocking without changing the inherited one that make and its other
+    // children read from
+    std::string path = "/proc/self/fd/" + std::to_string(fd);
+    return open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+static bool WriteTokens(int fd, char token, unsigned int count)
+{
+    std::string tokens(count, token);
+    size_t written = 0;
+    while (written < tokens.size())
+    {
+        ssize_t result = write(fd, tokens.data() + written, tokens.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
@@ -1,34 +1,151 @@
 #include "Logger.h"
+#include "AsyncLogSink.h"
+#include <csignal>
+#include <cstdlib>
+#include <mutex>
 
 bool Logger::verboseMode = false;
+std::atomic<AsyncLogSink *> Logger::asyncSink = nullptr;
+
+static std::mutex syncOutputMutex;
+
+// Signals that flush the asynchronous sink before the process goes down
+static constexpr int FlushSignals[] = {SIGINT, SIGTERM, SIGHUP};
+static struct sigaction previousActions[std::size(FlushSignals)];
+
+void Logger::FlushOnSignal(int signal)
+{
+    if (AsyncLogSink *sink = asyncSink.load())
+        sink->FlushFromSignal();
+
+    // Hand the signal on to whoever handled it before
+    for (size_t i = 0; i < std::size(FlushSignals); i++)
+    {
+        if (FlushSignals[i] != signal)
+            continue;
+
+        if (previousActions[i].sa_handler != SIG_DFL && previousActions[i].sa_handler != SIG_IGN &&
+            !(previousActions[i].sa_flags & SA_SIGINFO))
+        {
+            previousActions[i].sa_handler(signal);
+        }
+        else if (previousActions[i].sa_handler == SIG_DFL)
+        {
+            ::signal(signal, SIG_DFL);
+            raise(signal);
+        }
+    }
+}
 
 void Logger::SetVerbose(bool verbose)
 {
     verboseMode = verbose;
 }
 
+bool Logger::StartAsync(const std::string &logFile)
+{
+    if (asyncSink.load() != nullptr)
+        return true;
+
+    auto *sink = new AsyncLogSink(std::cout, std::cerr, 4096, logFile);
+    if (!logFile.empty() && !sink->HasLogFile())
+    {
+        delete sink;
+        LogError("Could not open log file: " + logFile);
+        return false;
+    }
+    asyncSink.store(sink);
+
+    static bool atexitRegistered = false;
+    if (!atexitRegistered)
+    {
+        std::atexit(StopAsync);
+        atexitRegistered = true;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = FlushOnSignal;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < std::size(FlushSignals); i++)
+    {
+        sigaction(FlushSignals[i], &action, &previousActions[i]);
+    }
+    return true;
+}
+
+void Logger::StopAsync()
+{
+    AsyncLogSink *sink = asyncSink.exchange(nullptr);
+    if (sink == nullptr)
+        return;
+
+    for (size_t i = 0; i < std::size(FlushSignals); i++)
+    {
+        sigaction(FlushSignals[i], &previousActions[i], nullptr);
+    }
+
+    sink->Stop();
+    delete sink;
+}
+
+void Logger::Flush()
+{
+    if (AsyncLogSink *sink = asyncSink.load())
+        sink->Flush();
+}
+
 void Logger::Log(LogLevel level, const std::string &message)
 {
+    bool isError = level == LogLevel::WARNING || level == LogLevel::ERROR;
+
+    std::string line;
     switch (level)
     {
     case LogLevel::VERBOSE:
-        std::cout << message << std::endl;
-        break;
     case LogLevel::INFO:
-        std::cout << message << std::endl;
+        line = message;
         break;
     case LogLevel::WARNING:
-        std::cerr << "[WARNING] " << message << std::endl;
+        line = "[WARNING] " + message;
         break;
     case LogLevel::ERROR:
-        std::cerr << "[ERROR] " << message << std::endl;
+        line = "[ERROR] " + message;
         break;
     }
+
+    Write(std::move(line), isError);
+}
+
+void Logger::LogOutput(std::string output)
+{
+    if (output.empty())
+        return;
+
+    // The sink terminates every entry with a newline itself
+    if (output.back() == '\n')
+        output.pop_back();
+
+    Write(std::move(output), true);
+}
+
+void Logger::Write(std::string line, bool isError)
+{
+    if (AsyncLogSink *sink = asyncSink.load())
+    {
+        sink->Push(std::move(line), isError);
+        return;
+    }
+
+    // Synchronous output, the lock keeps lines of concurrent threads apart
+    std::lock_guard<std::mutex> lock(syncOutputMutex);
+    std::ostream &stream = isError ? std::cerr : std::cout;
+    stream << line << '\n';
+    stream.flush();
 }
 
 void Logger::LogVerbose(const std::string &message)
 {
-    if (verboseMode)
+    if (IsVerbose())
         Log(LogLevel::VERBOSE, message);
 }
 
@@ -0,0 +1,59 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+bool MappedFile::Open(const std::string &path)
+{
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    // mmap rejects a length of zero, an empty file simply has an empty view
+    if (st.st_size > 0)
+    {
+        void *mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+        size = static_cast<size_t>(st.st_size);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != nullptr)
+    {
+        munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
@@ -0,0 +1,69 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "PathTable.h"
+#include <mutex>
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+PathTable::PathTable()
+    : arena(),
+      paths(),
+      ids(),
+      mutex()
+{
+}
+
+PathTable &PathTable::Instance()
+{
+    static PathTable instance;
+    return instance;
+}
+
+PathId PathTable::Intern(std::string_view path)
+{
+    std::unique_lock lock(mutex);
+
+    auto it = ids.find(path);
+    if (it != ids.end())
+        return it->second;
+
+    std::string_view stored = arena.Store(path);
+    PathId id = static_cast<PathId>(paths.size());
+    paths.push_back(stored);
+    ids.emplace(stored, id);
+    return id;
+}
+
+PathId PathTable::Find(std::string_view path) const
+{
+    std::shared_lock lock(mutex);
+    auto it = ids.find(path);
+    return it != ids.end() ? it->second : InvalidPathId;
+}
+
+std::string_view PathTable::Get(PathId id) const
+{
+    std::shared_lock lock(mutex);
+    return id < paths.size() ? paths[id] : std::string_view();
+}
+
+size_t PathTable::Size() const
+{
+    std::shared_lock lock(mutex);
+    return paths.size();
+}
+
+size_t PathTable::MemoryUsage() const
+{
+    std::shared_lock lock(mutex);
+
+    // Arena plus index vector plus an estimate for the hash map nodes and buckets
+    return arena.MemoryUsage() +
+           paths.capacity() * sizeof(std::string_view) +
+           ids.size() * (sizeof(std::string_view) + sizeof(PathId) + 2 * sizeof(void *)) +
+           ids.bucket_count() * sizeof(void *);
+}
@@ -0,0 +1,467 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "ProcessRunner.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Size of a single read from one of the pipes
+static constexpr size_t ReadChunkSize = 64 * 1024;
+
+// Number of events handled per epoll_wait
+static constexpr int MaxEvents = 64;
+
+// Time a cancelled command gets to exit after SIGTERM before it is killed
+static constexpr auto TerminateTimeout = std::chrono::seconds(2);
+
+// Readable while cancelled, every reactor watches it next to the pipes of its children.
+// Created up front, so CancelAll() only has to write to it
+static int cancelEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+std::atomic<bool> ProcessRunner::cancelled = false;
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static bool SpawnShell(const std::string &command, pid_t &pid, int &outFd, int &errFd);
+static int OpenPidFd(pid_t pid);
+static int WaitForExit(pid_t pid);
+static void WriteEvent(int fd);
+static void ClosePipe(int fds[2]);
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+ProcessRunner::ProcessRunner()
+    : epollFd(epoll_create1(EPOLL_CLOEXEC)),
+      wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      limits(),
+      watchingCancellation(false),
+      mutex(),
+      idle(),
+      pending(),
+      running(0),
+      stopping(false),
+      fdOwners(),
+      children(),
+      reactor()
+{
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    reactor = std::thread(&ProcessRunner::ReactorLoop, this);
+}
+
+ProcessRunner::~ProcessRunner()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    WriteEvent(wakeFd);
+    reactor.join();
+
+    close(wakeFd);
+    close(epollFd);
+}
+
+void ProcessRunner::Start(const std::string &command, Callback onExit)
+{
+    auto child = std::make_unique<Child>();
+    child->onExit = std::move(onExit);
+
+    if (IsCancelled())
+    {
+        child->result.cancelled = true;
+    }
+    else if (SpawnShell(limits + command, child->pid, child->outFd, child->errFd))
+    {
+        child->result.started = true;
+        child->pidFd = OpenPidFd(child->pid);
+        child->openPipes = 2;
+    }
+
+    // Spawning happens here, on the calling thread, the reactor only takes over the descriptors
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running++;
+        pending.push_back(std::move(child));
+    }
+    WriteEvent(wakeFd);
+}
+
+void ProcessRunner::SetMemoryLimit(uint64_t bytes)
+{
+    // Added after the command was checked for shell metacharacters, only the number comes from outside
+    limits = bytes > 0 ? "ulimit -v " + std::to_string((bytes + 1023) / 1024) + " 2>/dev/null; " : "";
+}
+
+void ProcessRunner::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]()
+              { return running == 0; });
+}
+
+void ProcessRunner::CancelAll()
+{
+    cancelled.store(true, std::memory_order_release);
+    WriteEvent(cancelEventFd);
+}
+
+void ProcessRunner::ResetCancellation()
+{
+    uint64_t count = 0;
+    if (cancelEventFd >= 0 && read(cancelEventFd, &count, sizeof(count)) < 0)
+    {
+        // EAGAIN, nothing was cancelled
+    }
+
+    cancelled.store(false, std::memory_order_release);
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+void ProcessRunner::ReactorLoop()
+{
+    // Signals are handled by the threads that started the commands, never here
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    epoll_event events[MaxEvents];
+    while (true)
+    {
+        int ready = epoll_wait(epollFd, events, MaxEvents, NextTimeout());
+        if (ready < 0 && errno != EINTR)
+            break;
+
+        for (int i = 0; i < ready; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd)
+            {
+                uint64_t count = 0;
+                if (read(wakeFd, &count, sizeof(count)) < 0)
+                {
+                    // EAGAIN, another event already drained it
+                }
+
+                std::vector<std::unique_ptr<Child>> adopted;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    adopted.swap(pending);
+                }
+                for (auto &child : adopted)
+                {
+                    Adopt(std::move(child));
+                }
+            }
+            else if (fd == cancelEventFd)
+            {
+                // Level triggered, so it is dropped until the cancellation is reset
+                WatchCancellation(false);
+                for (auto &[pointer, child] : children)
+                {
+                    Terminate(*child);
+                }
+            }
+            else if (auto owner = fdOwners.find(fd); owner != fdOwners.end())
+            {
+                Child &child = *owner->second;
+                if (fd == child.pidFd)
+                {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                    fdOwners.erase(owner);
+                    child.exited = true;
+                    DrainPipes(child);
+                    FinishIfDone(child);
+                }
+                else
+                {
+                    ReadPipe(child, fd);
+                }
+            }
+        }
+
+        // Commands that ignored SIGTERM for too long
+        auto now = std::chrono::steady_clock::now();
+        for (auto &[pointer, child] : children)
+        {
+            if (child->terminated && now >= child->killDeadline)
+            {
+                kill(-child->pid, SIGKILL);
+                child->killDeadline = std::chrono::steady_clock::time_point::max();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping && children.empty() && pending.empty())
+            break;
+    }
+}
+
+void ProcessRunner::Adopt(std::unique_ptr<Child> child)
+{
+    if (!child->result.started)
+    {
+        child->onExit(child->result);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0)
+            idle.notify_all();
+        return;
+    }
+
+    for (int fd : {child->outFd, child->errFd, child->pidFd})
+    {
+        if (fd < 0)
+            continue;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        fdOwners[fd] = child.get();
+    }
+
+    // A cancellation between spawning and adopting is caught here, a later one by the watch
+    if (IsCancelled())
+        Terminate(*child);
+    else if (!watchingCancellation)
+        WatchCancellation(true);
+
+    Child *pointer = child.get();
+    children.emplace(pointer, std::move(child));
+}
+
+void ProcessRunner::WatchCancellation(bool watch)
+{
+    if (cancelEventFd < 0 || watch == watchingCancellation)
+        return;
+
+    if (watch)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = cancelEventFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, cancelEventFd, &event);
+    }
+    else
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, cancelEventFd, nullptr);
+    }
+    watchingCancellation = watch;
+}
+
+void ProcessRunner::Terminate(Child &child)
+{
+    if (child.terminated)
+        return;
+
+    // The child is not reaped before its callback, so its process group still exists
+    kill(-child.pid, SIGTERM);
+    child.terminated = true;
+    child.result.cancelled = true;
+    child.killDeadline = std::chrono::steady_clock::now() + TerminateTimeout;
+}
+
+void ProcessRunner::ReadPipe(Child &child, int fd)
+{
+    char buffer[ReadChunkSize];
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if (count > 0)
+    {
+        child.result.output.append(buffer, static_cast<size_t>(count));
+        return;
+    }
+    if (count < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+
+    // EOF or an error, the pipe is done either way
+    DropPipe(child, fd);
+    FinishIfDone(child);
+}
+
+void ProcessRunner::DrainPipes(Child &child)
+{
+    // A background process of the command, e.g. "server &", may hold the pipes
+    // open for good. Whatever the shell and its foreground processes wrote is
+    // buffered once the shell has exited, so that is read and the pipes are
+    // closed instead of waiting for their EOF.
+    char buffer[ReadChunkSize];
+    for (int fd : {child.outFd, child.errFd})
+    {
+        if (fd < 0)
+            continue;
+
+        ssize_t count = 0;
+        while ((count = read(fd, buffer, sizeof(buffer))) > 0 || (count < 0 && errno == EINTR))
+        {
+            if (count > 0)
+                child.result.output.append(buffer, static_cast<size_t>(count));
+        }
+        DropPipe(child, fd);
+    }
+}
+
+void ProcessRunner::DropPipe(Child &child, int fd)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    fdOwners.erase(fd);
+    close(fd);
+    (fd == child.outFd ? child.outFd : child.errFd) = -1;
+    child.openPipes--;
+}
+
+void ProcessRunner::FinishIfDone(Child &child)
+{
+    // Without a pidfd the closed pipes are the only sign, the wait then blocks at most briefly
+    if (child.openPipes > 0 || (child.pidFd >= 0 && !child.exited))
+        return;
+
+    child.result.exitCode = WaitForExit(child.pid);
+    if (child.pidFd >= 0)
+        close(child.pidFd);
+
+    auto owned = children.find(&child);
+    std::unique_ptr<Child> finished = std::move(owned->second);
+    children.erase(owned);
+
+    finished->onExit(finished->result);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--running == 0)
+        idle.notify_all();
+}
+
+int ProcessRunner::NextTimeout() const
+{
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    for (const auto &[pointer, child] : children)
+    {
+        if (child->terminated)
+            deadline = std::min(deadline, child->killDeadline);
+    }
+    if (deadline == std::chrono::steady_clock::time_point::max())
+        return -1;
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count() + 1, 0));
+}
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static bool SpawnShell(const std::string &command, pid_t &pid, int &outFd, int &errFd)
+{
+    int outPipe[2] = {-1, -1};
+    int errPipe[2] = {-1, -1};
+    if (pipe2(outPipe, O_CLOEXEC) != 0 || pipe2(errPipe, O_CLOEXEC) != 0)
+    {
+        ClosePipe(outPipe);
+        ClosePipe(errPipe);
+        return false;
+    }
+
+    // The child gets the write ends as stdout and stderr, dup2 clears O_CLOEXEC on them
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+
+    // A process group of its own lets cancellation reach the compiler behind the shell as well
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    const char *argv[] = {"sh", "-c", command.c_str(), nullptr};
+    int spawnError = posix_spawn(&pid, "/bin/sh", &actions, &attributes, const_cast<char *const *>(argv), environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(outPipe[1]);
+    close(errPipe[1]);
+
+    if (spawnError != 0)
+    {
+        close(outPipe[0]);
+        close(errPipe[0]);
+        return false;
+    }
+
+    // Only the reading side is non-blocking, the command writes as usual
+    fcntl(outPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(errPipe[0], F_SETFL, O_NONBLOCK);
+    outFd = outPipe[0];
+    errFd = errPipe[0];
+    return true;
+}
+
+static int OpenPidFd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+static int WaitForExit(pid_t pid)
+{
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return -1;
+}
+
+static void WriteEvent(int fd)
+{
+    uint64_t one = 1;
+    if (fd >= 0 && write(fd, &one, sizeof(one)) < 0)
+    {
+        // Only fails if the counter overflows, it is readable either way
+    }
+}
+
+static void ClosePipe(int fds[2])
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+}
@@ -22,30 +22,42 @@ bool ExecuteCommand(const std::string &command)
     if (!IsValidCommand(command))
         return false;
 
+    // The command writes to the terminal directly, so queued log lines go first
+    Logger::Flush();
+
     try
     {
         int result = std::system(command.c_str());
         if (result != 0)
         {
-            Logger::LogError("Command execution failed with code: " + std::to_string(result));
+            Logger::Error("Command execution failed with code: {}", result);
             return false;
         }
     }
     catch (const std::exception &e)
     {
         // Handle any exceptions that may occur during command execution
-        Logger::LogError("Exception during command execution: " + std::string(e.what()));
+        Logger::Error("Exception during command execution: {}", e.what());
         return false;
     }
     catch (...)
     {
-        Logger::LogError("Unknown error occurred during command execution.");
+        Logger::Error("Unknown error occurred during command execution.");
         return false;
     }
 
     return true;
 }
 
+bool StartCommandCaptured(ProcessRunner &runner, const std::string &command, ProcessRunner::Callback onExit)
+{
+    if (!IsValidCommand(command))
+        return false;
+
+    runner.Start(command, std::move(onExit));
+    return true;
+}
+
 //**************************************************************
 // Local functions
 //**************************************************************
@@ -61,10 +73,8 @@ static bool IsValidCommand(const std::string &input)
         if (std::regex_search(input, match, dangerousPatternRegex))
         {
             // Print the first invalid character and its position
-            Logger::LogError("Invalid character '" + match.str(0) +
-                            "' found at position " + std::to_string(match.position(0)) +
-                            " in input: " + input);
-            Logger::LogError("The following symbols are not allowed for security reasons. \"[;&|><`]\"");
+            Logger::Error("Invalid character '{}' found at position {} in input: {}", match.str(0), match.position(0), input);
+            Logger::Error("The following symbols are not allowed for security reasons. \"[;&|><`]\"");
         }
         else
         {
@@ -73,11 +83,11 @@ static bool IsValidCommand(const std::string &input)
     }
     catch (const std::exception &e)
     {
-        Logger::LogError(std::string("Exception during input validation: ") + e.what());
+        Logger::Error("Exception during input validation: {}", e.what());
     }
     catch (...)
     {
-        Logger::LogError("Unknown error occurred during input validation.");
+        Logger::Error("Unknown error occurred during input validation.");
     }
     return false;
 }
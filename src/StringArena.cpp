@@ -0,0 +1,83 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "StringArena.h"
+#include <cstring>
+#include <utility>
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+StringArena::StringArena()
+    : blocks(),
+      blockUsed(BlockSize),
+      arenaSize(0)
+{
+}
+
+std::string_view StringArena::Store(std::string_view text)
+{
+    return Concat({text});
+}
+
+std::string_view StringArena::Concat(std::initializer_list<std::string_view> parts)
+{
+    size_t size = 0;
+    for (const auto &part : parts)
+    {
+        size += part.size();
+    }
+
+    char *destination = Allocate(size + 1);
+    char *position = destination;
+    for (const auto &part : parts)
+    {
+        std::memcpy(position, part.data(), part.size());
+        position += part.size();
+    }
+    *position = '\0';
+
+    return std::string_view(destination, size);
+}
+
+void StringArena::Clear()
+{
+    blocks.clear();
+    blockUsed = BlockSize;
+    arenaSize = 0;
+}
+
+//**************************************************************
+// Private functions
+//**************************************************************
+
+char *StringArena::Allocate(size_t size)
+{
+    // Allocations larger than a block get their own block
+    if (size > BlockSize)
+    {
+        blocks.push_back(std::make_unique<char[]>(size));
+        arenaSize += size;
+        char *memory = blocks.back().get();
+
+        // Keep filling the previous block by moving the large block in front of it
+        if (blocks.size() > 1)
+            std::swap(blocks[blocks.size() - 1], blocks[blocks.size() - 2]);
+        else
+            blockUsed = BlockSize;
+        return memory;
+    }
+
+    if (blockUsed + size > BlockSize)
+    {
+        blocks.push_back(std::make_unique<char[]>(BlockSize));
+        arenaSize += BlockSize;
+        blockUsed = 0;
+    }
+
+    char *memory = blocks.back().get() + blockUsed;
+    blockUsed += size;
+    return memory;
+}
@@ -0,0 +1,163 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include "SystemLoad.h"
+#include <fstream>
+#include <sstream>
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static bool ReadPressure(const std::string &file, double &percent);
+static bool ReadLoadAverage(const std::string &file, double &load);
+static bool ReadAvailableMemory(const std::string &file, uint64_t &bytes);
+static bool ParsePercent(const std::string &value, double &percent);
+static std::string Describe(const std::string &name, double value, double limit, const char *unit);
+
+//**************************************************************
+// Public functions
+//**************************************************************
+
+bool SystemLoad::ParsePressureLimits(const std::string &value, SystemLoadLimits &loadLimits)
+{
+    SystemLoadLimits parsed = loadLimits;
+    if (value.find('=') == std::string::npos)
+    {
+        double percent = 0;
+        if (!ParsePercent(value, percent))
+            return false;
+        parsed.MaxCpuPressure = parsed.MaxMemoryPressure = parsed.MaxIoPressure = percent;
+    }
+    else
+    {
+        std::istringstream pairs(value);
+        std::string pair;
+        while (std::getline(pairs, pair, ','))
+        {
+            size_t separator = pair.find('=');
+            double percent = 0;
+            if (separator == std::string::npos || !ParsePercent(pair.substr(separator + 1), percent))
+                return false;
+
+            std::string resource = pair.substr(0, separator);
+            if (resource == "cpu")
+                parsed.MaxCpuPressure = percent;
+            else if (resource == "memory")
+                parsed.MaxMemoryPressure = percent;
+            else if (resource == "io")
+                parsed.MaxIoPressure = percent;
+            else
+                return false;
+        }
+    }
+
+    loadLimits = parsed;
+    return true;
+}
+
+bool SystemLoad::IsActive() const
+{
+    return limits.MaxLoad > 0 || limits.MaxCpuPressure > 0 || limits.MaxMemoryPressure > 0 || limits.MaxIoPressure > 0 ||
+           limits.MinAvailableMemory > 0;
+}
+
+bool SystemLoad::Sample()
+{
+    overload.clear();
+
+    // Memory first, swapping is what hurts the most
+    uint64_t available = 0;
+    if (limits.MinAvailableMemory > 0 && ReadAvailableMemory(procDir + "/meminfo", available) && available < limits.MinAvailableMemory)
+        overload = "available memory " + std::to_string(available >> 20) + " MiB < " + std::to_string(limits.MinAvailableMemory >> 20) + " MiB";
+
+    const struct
+    {
+        const char *name;
+        double limit;
+    } pressures[] = {{"memory", limits.MaxMemoryPressure}, {"io", limits.MaxIoPressure}, {"cpu", limits.MaxCpuPressure}};
+    for (const auto &pressure : pressures)
+    {
+        double percent = 0;
+        if (overload.empty() && pressure.limit > 0 && ReadPressure(procDir + "/pressure/" + pressure.name, percent) && percent > pressure.limit)
+            overload = Describe(std::string(pressure.name) + " pressure", percent, pressure.limit, "%");
+    }
+
+    double load = 0;
+    if (overload.empty() && limits.MaxLoad > 0 && ReadLoadAverage(procDir + "/loadavg", load) && load > limits.MaxLoad)
+        overload = Describe("load average", load, limits.MaxLoad, "");
+
+    nextSample = std::chrono::steady_clock::now() + SampleInterval;
+    return !overload.empty();
+}
+
+bool SystemLoad::IsOverloaded()
+{
+    if (!IsActive())
+        return false;
+    if (std::chrono::steady_clock::now() >= nextSample)
+        Sample();
+    return !overload.empty();
+}
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static bool ReadPressure(const std::string &file, double &percent)
+{
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+    std::ifstream stream(file);
+    std::string kind;
+    std::string average;
+    if (!(stream >> kind >> average) || kind != "some" || !average.starts_with("avg10="))
+        return false;
+    return ParsePercent(average.substr(6), percent);
+}
+
+static bool ReadLoadAverage(const std::string &file, double &load)
+{
+    std::ifstream stream(file);
+    return static_cast<bool>(stream >> load);
+}
+
+static bool ReadAvailableMemory(const std::string &file, uint64_t &bytes)
+{
+    std::ifstream stream(file);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (!line.starts_with("MemAvailable:"))
+            continue;
+
+        std::istringstream value(line.substr(13));
+        uint64_t kilobytes = 0;
+        if (!(value >> kilobytes))
+            return false;
+        bytes = kilobytes * 1024;
+        return true;
+    }
+    return false;
+}
+
+static bool ParsePercent(const std::string &value, double &percent)
+{
+    try
+    {
+        size_t end = 0;
+        percent = std::stod(value, &end);
+        return end == value.size() && percent >= 0;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+static std::string Describe(const std::string &name, double value, double limit, const char *unit)
+{
+    std::ostringstream description;
+    description << name << " " << value << unit << " > " << limit << unit;
+    return description.str();
+}
@@ -0,0 +1,113 @@
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <XMakefile.h>
+#include "BinaryStream.h"
+
+//**************************************************************
+// Classes
+//**************************************************************
+
+void XMakefile::FromJSON(const JsonVariant &doc, const std::string &basePath)
+{
+    // Extract configurations, resolution is deferred until one is requested
+    JsonArray configsArray = doc["configurations"].as<JsonArray>();
+    for (JsonVariant config : configsArray)
+    {
+        ConfigEntry entry{XMakefileConfig(), basePath, nullptr};
+        entry.raw.Extract(config);
+        configs.push_back(std::move(entry));
+    }
+}
+
+ConfigSnapshot XMakefile::GetSnapshot(size_t index)
+{
+    ConfigEntry &entry = configs.at(index);
+    if (!entry.resolved)
+    {
+        auto config = std::make_shared<XMakefileConfig>(entry.raw);
+        config->ResolvePaths(entry.basePath);
+        entry.resolved = std::move(config);
+    }
+    return entry.resolved;
+}
+
+ConfigSnapshot XMakefile::FindConfig(const std::string &name)
+{
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        if (configs[i].raw.Name == name)
+        {
+            return GetSnapshot(i);
+        }
+    }
+    return nullptr;
+}
+
+size_t XMakefile::ResolvedConfigCount() const
+{
+    size_t count = 0;
+    for (const auto &entry : configs)
+    {
+        if (entry.resolved)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::map<std::string, std::optional<std::string>> XMakefile::GetReferencedEnvironment() const
+{
+    std::map<std::string, std::optional<std::string>> environment;
+    for (const auto &entry : configs)
+    {
+        if (entry.resolved)
+        {
+            const auto &referenced = entry.resolved->GetReferencedEnvironment();
+            environment.insert(referenced.begin(), referenced.end());
+        }
+    }
+    return environment;
+}
+
+void XMakefile::Serialize(BinaryWriter &writer) const
+{
+    writer.WriteU32(static_cast<uint32_t>(configs.size()));
+    for (const auto &entry : configs)
+    {
+        writer.WriteString(entry.basePath);
+        entry.raw.Serialize(writer);
+        writer.WriteU32(entry.resolved ? 1 : 0);
+        if (entry.resolved)
+        {
+            entry.resolved->Serialize(writer);
+        }
+    }
+}
+
+bool XMakefile::Deserialize(BinaryReader &reader)
+{
+    configs.clear();
+    uint32_t count = reader.ReadU32();
+    for (uint32_t i = 0; i < count && reader.IsValid(); i++)
+    {
+        ConfigEntry entry{XMakefileConfig(), std::string(reader.ReadString()), nullptr};
+        entry.raw.Deserialize(reader);
+        if (reader.ReadU32() != 0)
+        {
+            auto config = std::make_shared<XMakefileConfig>();
+            config->Deserialize(reader);
+            entry.resolved = std::move(config);
+        }
+        configs.push_back(std::move(entry));
+    }
+
+    if (!reader.IsValid())
+    {
+        configs.clear();
+        return false;
+    }
+    return true;
+}
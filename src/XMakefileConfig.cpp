@@ -3,6 +3,9 @@
 //**************************************************************
 
 #include <XMakefileConfig.h>
+#include "BinaryStream.h"
+#include "Logger.h"
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 
@@ -12,6 +15,7 @@
 
 XMakefileConfig::XMakefileConfig()
     : envVars(),
+      referencedEnvironment(),
       Name(),
       BuildType(),
       BuildDir(),
@@ -30,6 +34,8 @@ XMakefileConfig::XMakefileConfig()
       LibraryPaths(),
       Libraries(),
       SourcePaths(),
+      Sources(),
+      SourceListFile(),
       ExcludePaths(),
       ExcludeFiles(),
       PreBuildCommands(),
@@ -38,7 +44,10 @@ XMakefileConfig::XMakefileConfig()
       PostRunCommands(),
       InstallCommands(),
       UninstallCommands(),
-      CleanCommands()
+      CleanCommands(),
+      Dependencies(),
+      CustomCommands(),
+      Pools()
 {
 }
 
@@ -98,6 +107,12 @@ std::string XMakefileConfig::ResolveLibraryPath(const std::string &path, const s
 }
 
 void XMakefileConfig::FromJSON(const JsonVariant &doc, const std::string &basePath)
+{
+    Extract(doc);
+    ResolvePaths(basePath);
+}
+
+void XMakefileConfig::Extract(const JsonVariant &doc)
 {
     Name = doc["name"].as<std::string>();
     BuildType = doc["build_type"].as<std::string>();
@@ -112,6 +127,58 @@ void XMakefileConfig::FromJSON(const JsonVariant &doc, const std::string &basePa
     Archiver = doc["archiver"].as<std::string>();
     ArchiverFlags = doc["archiver_flags"].as<std::string>();
 
+    ExtractList(doc["defines"].as<JsonArray>(), Defines);
+    ExtractList(doc["include_paths"].as<JsonArray>(), IncludePaths);
+    ExtractList(doc["library_paths"].as<JsonArray>(), LibraryPaths);
+    ExtractList(doc["libraries"].as<JsonArray>(), Libraries);
+    ExtractList(doc["pre_build_commands"].as<JsonArray>(), PreBuildCommands);
+    ExtractList(doc["post_build_commands"].as<JsonArray>(), PostBuildCommands);
+    ExtractList(doc["pre_run_commands"].as<JsonArray>(), PreRunCommands);
+    ExtractList(doc["post_run_commands"].as<JsonArray>(), PostRunCommands);
+    ExtractList(doc["source_paths"].as<JsonArray>(), SourcePaths);
+    ExtractList(doc["sources"].as<JsonArray>(), Sources);
+    if (doc["source_list_file"].is<std::string>())
+    {
+        SourceListFile = doc["source_list_file"].as<std::string>();
+    }
+    ExtractList(doc["exclude_paths"].as<JsonArray>(), ExcludePaths);
+    ExtractList(doc["exclude_files"].as<JsonArray>(), ExcludeFiles);
+    ExtractList(doc["install_commands"].as<JsonArray>(), InstallCommands);
+    ExtractList(doc["uninstall_commands"].as<JsonArray>(), UninstallCommands);
+    ExtractList(doc["clean_commands"].as<JsonArray>(), CleanCommands);
+
+    // A dependency is either the path of an xmakefile or an object with the path and a configuration
+    for (JsonVariant value : doc["dependencies"].as<JsonArray>())
+    {
+        if (value.is<std::string>())
+            Dependencies.push_back({value.as<std::string>(), ""});
+        else
+            Dependencies.push_back({value["xmakefile"].as<std::string>(), value["config"].is<std::string>() ? value["config"].as<std::string>() : ""});
+    }
+
+    for (JsonVariant value : doc["custom_commands"].as<JsonArray>())
+    {
+        XMakefileCustomCommand command;
+        command.Command = value["command"].as<std::string>();
+        command.Name = value["name"].is<std::string>() ? value["name"].as<std::string>() : command.Command;
+        ExtractList(value["inputs"].as<JsonArray>(), command.Inputs);
+        ExtractList(value["outputs"].as<JsonArray>(), command.Outputs);
+        command.Trace = value["trace"].as<bool>();
+        CustomCommands.push_back(std::move(command));
+    }
+
+    for (JsonVariant value : doc["pools"].as<JsonArray>())
+    {
+        XMakefilePool pool;
+        pool.Name = value["name"].as<std::string>();
+        pool.Depth = std::max(1u, value["depth"].as<unsigned int>());
+        ExtractList(value["files"].as<JsonArray>(), pool.Files);
+        Pools.push_back(std::move(pool));
+    }
+}
+
+void XMakefileConfig::ResolvePaths(const std::string &basePath)
+{
     std::string tmpPath = basePath.empty() ? "" : basePath + "/";
 
     OutputDir = tmpPath;
@@ -131,108 +198,242 @@ void XMakefileConfig::FromJSON(const JsonVariant &doc, const std::string &basePa
     envVars["output_filename"] = ResolvePath(OutputFilename, tmpPath);
     envVars["output_file"] = OutputDir + "/" + OutputFilename;
 
-    // Extract defines
-    JsonArray defines = doc["defines"].as<JsonArray>();
-    for (JsonVariant define : defines)
-    {
-        Defines.push_back(define.as<std::string>());
-    }
+    for (auto &path : IncludePaths)
+        path = ResolvePath(path, tmpPath);
+    for (auto &path : LibraryPaths)
+        path = ResolvePath(path, tmpPath);
+    for (auto &lib : Libraries)
+        lib = ResolveLibraryPath(lib, tmpPath);
+
+    for (auto &command : PreBuildCommands)
+        command = Resolve(command, tmpPath);
+    for (auto &command : PostBuildCommands)
+        command = Resolve(command, tmpPath);
+    for (auto &command : PreRunCommands)
+        command = Resolve(command, tmpPath);
+    for (auto &command : PostRunCommands)
+        command = Resolve(command, tmpPath);
+
+    // An explicit source manifest replaces scanning of the source paths
+    for (auto &path : SourcePaths)
+        path = ResolvePath(path, tmpPath);
+    for (auto &source : Sources)
+        source = ResolvePath(source, tmpPath);
+    if (!SourceListFile.empty())
+        SourceListFile = ResolvePath(SourceListFile, tmpPath);
 
-    // Extract include paths
-    JsonArray includePaths = doc["include_paths"].as<JsonArray>();
-    for (JsonVariant path : includePaths)
+    for (auto &path : ExcludePaths)
+        path = ResolvePath(path, tmpPath);
+    for (auto &file : ExcludeFiles)
+        file = ResolvePath(file, tmpPath);
+
+    for (auto &command : InstallCommands)
+        command = Resolve(command, tmpPath);
+    for (auto &command : UninstallCommands)
+        command = Resolve(command, tmpPath);
+    for (auto &command : CleanCommands)
+        command = Resolve(command, tmpPath);
+
+    for (auto &dependency : Dependencies)
+        dependency.XMakefile = ResolvePath(dependency.XMakefile, tmpPath);
+
+    for (auto &command : CustomCommands)
     {
-        IncludePaths.push_back(ResolvePath(path.as<std::string>(), tmpPath));
+        command.Command = Resolve(command.Command, tmpPath);
+        for (auto &input : command.Inputs)
+            input = ResolvePath(input, tmpPath);
+        for (auto &output : command.Outputs)
+            output = ResolvePath(output, tmpPath);
     }
 
-    // Extract library paths
-    JsonArray libraryPaths = doc["library_paths"].as<JsonArray>();
-    for (JsonVariant path : libraryPaths)
+    // Patterns without a directory match file names anywhere
+    for (auto &pool : Pools)
     {
-        LibraryPaths.push_back(ResolvePath(path.as<std::string>(), tmpPath));
+        for (auto &file : pool.Files)
+        {
+            if (file.find('/') != std::string::npos)
+                file = ResolvePath(file, tmpPath);
+        }
     }
+}
 
-    // Extract libraries
-    JsonArray libraries = doc["libraries"].as<JsonArray>();
-    for (JsonVariant lib : libraries)
+void XMakefileConfig::ExtractList(const JsonArray &values, std::vector<std::string> &output)
+{
+    for (JsonVariant value : values)
     {
-        Libraries.push_back(ResolveLibraryPath(lib.as<std::string>(), tmpPath));
+        output.push_back(value.as<std::string>());
     }
+}
+
+void XMakefileConfig::Serialize(BinaryWriter &writer) const
+{
+    writer.WriteString(Name);
+    writer.WriteString(BuildType);
+    writer.WriteString(BuildDir);
+    writer.WriteString(OutputDir);
+    writer.WriteString(OutputFilename);
+    writer.WriteString(CompilerPath);
+    writer.WriteString(Compiler);
+    writer.WriteString(CCompilerFlags);
+    writer.WriteString(CXXCompilerFlags);
+    writer.WriteString(Linker);
+    writer.WriteString(LinkerFlags);
+    writer.WriteString(Archiver);
+    writer.WriteString(ArchiverFlags);
+    writer.WriteString(SourceListFile);
+
+    writer.WriteStrings(Defines);
+    writer.WriteStrings(IncludePaths);
+    writer.WriteStrings(LibraryPaths);
+    writer.WriteStrings(Libraries);
+    writer.WriteStrings(SourcePaths);
+    writer.WriteStrings(Sources);
+    writer.WriteStrings(ExcludePaths);
+    writer.WriteStrings(ExcludeFiles);
+    writer.WriteStrings(PreBuildCommands);
+    writer.WriteStrings(PostBuildCommands);
+    writer.WriteStrings(PreRunCommands);
+    writer.WriteStrings(PostRunCommands);
+    writer.WriteStrings(InstallCommands);
+    writer.WriteStrings(UninstallCommands);
+    writer.WriteStrings(CleanCommands);
 
-    // Extract pre_build_commands
-    JsonArray preBuildCommands = doc["pre_build_commands"].as<JsonArray>();
-    for (JsonVariant command : preBuildCommands)
+    writer.WriteU32(static_cast<uint32_t>(Dependencies.size()));
+    for (const auto &dependency : Dependencies)
     {
-        PreBuildCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        writer.WriteString(dependency.XMakefile);
+        writer.WriteString(dependency.Config);
     }
-    // Extract post_build_commands
-    JsonArray postBuildCommands = doc["post_build_commands"].as<JsonArray>();
-    for (JsonVariant command : postBuildCommands)
+
+    writer.WriteU32(static_cast<uint32_t>(CustomCommands.size()));
+    for (const auto &command : CustomCommands)
     {
-        PostBuildCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        writer.WriteString(command.Name);
+        writer.WriteString(command.Command);
+        writer.WriteStrings(command.Inputs);
+        writer.WriteStrings(command.Outputs);
+        writer.WriteU32(command.Trace ? 1 : 0);
     }
-    // Extract pre_run_commands
-    JsonArray preRunCommands = doc["pre_run_commands"].as<JsonArray>();
-    for (JsonVariant command : preRunCommands)
+
+    writer.WriteU32(static_cast<uint32_t>(Pools.size()));
+    for (const auto &pool : Pools)
     {
-        PreRunCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        writer.WriteString(pool.Name);
+        writer.WriteU32(pool.Depth);
+        writer.WriteStrings(pool.Files);
     }
-    // Extract post_run_commands
-    JsonArray postRunCommands = doc["post_run_commands"].as<JsonArray>();
-    for (JsonVariant command : postRunCommands)
+
+    writer.WriteU32(static_cast<uint32_t>(envVars.size()));
+    for (const auto &[name, value] : envVars)
     {
-        PostRunCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        writer.WriteString(name);
+        writer.WriteString(value);
     }
 
-    // Extract source paths
-    JsonArray sourcePaths = doc["source_paths"].as<JsonArray>();
-    for (JsonVariant path : sourcePaths)
+    writer.WriteU32(static_cast<uint32_t>(referencedEnvironment.size()));
+    for (const auto &[name, value] : referencedEnvironment)
     {
-        SourcePaths.push_back(ResolvePath(path.as<std::string>(), tmpPath));
+        writer.WriteString(name);
+        writer.WriteU32(value.has_value() ? 1 : 0);
+        writer.WriteString(value.value_or(""));
     }
+}
+
+bool XMakefileConfig::Deserialize(BinaryReader &reader)
+{
+    Name = reader.ReadString();
+    BuildType = reader.ReadString();
+    BuildDir = reader.ReadString();
+    OutputDir = reader.ReadString();
+    OutputFilename = reader.ReadString();
+    CompilerPath = reader.ReadString();
+    Compiler = reader.ReadString();
+    CCompilerFlags = reader.ReadString();
+    CXXCompilerFlags = reader.ReadString();
+    Linker = reader.ReadString();
+    LinkerFlags = reader.ReadString();
+    Archiver = reader.ReadString();
+    ArchiverFlags = reader.ReadString();
+    SourceListFile = reader.ReadString();
 
-    // Extract excluded source paths
-    JsonArray excludePaths = doc["exclude_paths"].as<JsonArray>();
-    for (JsonVariant path : excludePaths)
+    reader.ReadStrings(Defines);
+    reader.ReadStrings(IncludePaths);
+    reader.ReadStrings(LibraryPaths);
+    reader.ReadStrings(Libraries);
+    reader.ReadStrings(SourcePaths);
+    reader.ReadStrings(Sources);
+    reader.ReadStrings(ExcludePaths);
+    reader.ReadStrings(ExcludeFiles);
+    reader.ReadStrings(PreBuildCommands);
+    reader.ReadStrings(PostBuildCommands);
+    reader.ReadStrings(PreRunCommands);
+    reader.ReadStrings(PostRunCommands);
+    reader.ReadStrings(InstallCommands);
+    reader.ReadStrings(UninstallCommands);
+    reader.ReadStrings(CleanCommands);
+
+    Dependencies.clear();
+    uint32_t dependencyCount = reader.ReadU32();
+    for (uint32_t i = 0; i < dependencyCount && reader.IsValid(); i++)
     {
-        ExcludePaths.push_back(ResolvePath(path.as<std::string>(), tmpPath));
+        std::string xmakefile(reader.ReadString());
+        Dependencies.push_back({xmakefile, std::string(reader.ReadString())});
     }
-    // Extract excluded source files
-    JsonArray excludeFiles = doc["exclude_files"].as<JsonArray>();
-    for (JsonVariant file : excludeFiles)
+
+    CustomCommands.clear();
+    uint32_t customCommandCount = reader.ReadU32();
+    for (uint32_t i = 0; i < customCommandCount && reader.IsValid(); i++)
     {
-        ExcludeFiles.push_back(ResolvePath(file.as<std::string>(), tmpPath));
+        XMakefileCustomCommand command;
+        command.Name = reader.ReadString();
+        command.Command = reader.ReadString();
+        reader.ReadStrings(command.Inputs);
+        reader.ReadStrings(command.Outputs);
+        command.Trace = reader.ReadU32() != 0;
+        CustomCommands.push_back(std::move(command));
     }
 
-    // Extract install commands
-    JsonArray installCommands = doc["install_commands"].as<JsonArray>();
-    for (JsonVariant command : installCommands)
+    Pools.clear();
+    uint32_t poolCount = reader.ReadU32();
+    for (uint32_t i = 0; i < poolCount && reader.IsValid(); i++)
     {
-        InstallCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        XMakefilePool pool;
+        pool.Name = reader.ReadString();
+        pool.Depth = reader.ReadU32();
+        reader.ReadStrings(pool.Files);
+        Pools.push_back(std::move(pool));
     }
-    // Extract uninstall commands
-    JsonArray uninstallCommands = doc["uninstall_commands"].as<JsonArray>();
-    for (JsonVariant command : uninstallCommands)
+
+    envVars.clear();
+    uint32_t envVarCount = reader.ReadU32();
+    for (uint32_t i = 0; i < envVarCount && reader.IsValid(); i++)
     {
-        UninstallCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        std::string name(reader.ReadString());
+        envVars[name] = reader.ReadString();
     }
-    // Extract clean commands
-    JsonArray cleanCommands = doc["clean_commands"].as<JsonArray>();
-    for (JsonVariant command : cleanCommands)
+
+    referencedEnvironment.clear();
+    uint32_t referencedCount = reader.ReadU32();
+    for (uint32_t i = 0; i < referencedCount && reader.IsValid(); i++)
     {
-        CleanCommands.push_back(Resolve(command.as<std::string>(), tmpPath, envVars));
+        std::string name(reader.ReadString());
+        bool isSet = reader.ReadU32() != 0;
+        std::string value(reader.ReadString());
+        referencedEnvironment[name] = isSet ? std::optional<std::string>(value) : std::nullopt;
     }
+
+    return reader.IsValid();
 }
 
-void XMakefileConfig::PrintEnvironmentVariables()
+void XMakefileConfig::PrintEnvironmentVariables() const
 {
     for (const auto &pair : envVars)
     {
-        std::cout << pair.first.c_str() << "=" << pair.second.c_str() << std::endl;
+        Logger::Info("{}={}", pair.first, pair.second);
     }
 }
 
-std::string XMakefileConfig::ResolveEnvironmentVariables(const std::string &path, const std::map<std::string, std::string> &envVars)
+std::string XMakefileConfig::ResolveEnvironmentVariables(const std::string &path)
 {
     // Replace environment variables in the path
     std::string resolvedPath = path;
@@ -249,8 +450,10 @@ std::string XMakefileConfig::ResolveEnvironmentVariables(const std::string &path
         auto it = envVars.find(varName);
         if (it == envVars.end())
         {
-            // Check if the variable is in the environment variables
+            // Check if the variable is in the environment variables, remember the
+            // lookup so a cached resolution can be invalidated when it changes
             const char *envValue = getenv(varName.c_str());
+            referencedEnvironment[varName] = envValue ? std::optional<std::string>(envValue) : std::nullopt;
             if (envValue)
             {
                 // Replace the variable with its value
@@ -308,8 +511,8 @@ std::string XMakefileConfig::ResolveCommand(const std::string &command, const st
     return resolvedCommand;
 }
 
-std::string XMakefileConfig::Resolve(const std::string &command, const std::string &basePath, const std::map<std::string, std::string> &envVars)
+std::string XMakefileConfig::Resolve(const std::string &command, const std::string &basePath)
 {
     std::string resolved = ResolveCommand(command, basePath);
-    return ResolveEnvironmentVariables(resolved, envVars);
+    return ResolveEnvironmentVariables(resolved);
 }
\ No newline at end of file
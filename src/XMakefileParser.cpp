@@ -4,21 +4,53 @@
 
 #include "XMakefileParser.h"
 #include "Logger.h"
+#include "BinaryStream.h"
+#include "MappedFile.h"
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
+#include <glob.h>
+#include <sys/stat.h>
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static void WriteEnvironment(BinaryWriter &writer, const std::map<std::string, std::optional<std::string>> &environment);
+static bool EnvironmentChanged(BinaryReader &reader, const char *cacheName);
 
 //**************************************************************
 // Public functions
 //**************************************************************
 
+bool DiscoveryCache::Find(const std::string &key, std::vector<PathId> &files, std::vector<PathId> &scannedPaths)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return false;
+
+    files = it->second.files;
+    scannedPaths = it->second.scannedPaths;
+    return true;
+}
+
+void DiscoveryCache::Store(const std::string &key, const std::vector<PathId> &files, const std::vector<PathId> &scannedPaths)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[key];
+    entry.files = files;
+    entry.scannedPaths = scannedPaths;
+}
+
 XMakefileParser::XMakefileParser()
     : verbose(false),
       xmakefilePath(),
-      xmakefileContent(),
+      xmakefileHash(0),
       xmakefileName(),
       xmakefileDir(),
       buildStructureIndex(0),
@@ -27,11 +59,36 @@ XMakefileParser::XMakefileParser()
       libraryFiles(),
       buildStructures(),
       linkString(),
+      compileTemplates(),
+      canonicalOutputDir(),
+      objectFileCache(),
+      commandArena(),
+      discoveredFiles(),
+      discoveredDirectories(),
+      discoveryCache(),
+      snapshotPaths(),
+      planCacheable(false),
       lastModifiedTimes(),
-      jsonDoc(),
       xmakefile(),
-      currentConfig()
+      cachedResolvedConfigs(0),
+      currentConfig(EmptyConfig())
+{
+}
+
+const ConfigSnapshot &XMakefileParser::EmptyConfig()
 {
+    static const ConfigSnapshot emptyConfig = std::make_shared<const XMakefileConfig>();
+    return emptyConfig;
+}
+
+std::string XMakefileParser::GetXMakefileContent() const
+{
+    MappedFile file;
+    if (xmakefilePath.empty() || !file.Open(xmakefilePath))
+    {
+        return "";
+    }
+    return std::string(file.View());
 }
 
 bool XMakefileParser::Parse(const std::string &path)
@@ -41,42 +98,58 @@ bool XMakefileParser::Parse(const std::string &path)
         xmakefilePath = path;
         xmakefileName = path.substr(path.find_last_of("/\\") + 1);
         xmakefileDir = path.substr(0, path.find_last_of("/\\"));
-        xmakefileContent = "";
 
-        std::ifstream file(xmakefilePath);
-        if (!file.is_open())
+        // The file is parsed straight from the mapping, no copy of the content is kept
+        MappedFile file;
+        if (!file.Open(xmakefilePath))
         {
-            Logger::LogError("Could not open xmakefile: " + xmakefilePath + ". Place an xmakefile into this directory or use /path/to/xmakefile.json");
+            Logger::Error("Could not open xmakefile: {}. Place an xmakefile into this directory or use /path/to/xmakefile.json", xmakefilePath);
             return false;
         }
+        std::string_view content = file.View();
 
-        std::string line;
-        while (std::getline(file, line))
-        {
-            xmakefileContent += line;
-        }
+        xmakefileHash = HashBytes(content);
 
-        deserializeJson(jsonDoc, xmakefileContent);
-        if (jsonDoc.isNull())
+        currentConfig = EmptyConfig();
+        xmakefile.Clear();
+
+        if (LoadXMakefileCache())
         {
-            Logger::LogError("Failed to parse xmakefile content.");
-            return false;
+            Logger::Verbose("xmakefile loaded from cache.");
         }
+        else
+        {
+            // The document only lives until the raw configurations are extracted
+            JsonDocument jsonDoc;
+            DeserializationError error = deserializeJson(jsonDoc, content.data(), content.size());
+            if (error)
+            {
+                Logger::Error("Failed to parse xmakefile: {} at {}", error.c_str(), DescribeLocation(content, FindErrorOffset(content)));
+                return false;
+            }
+            if (jsonDoc.isNull())
+            {
+                Logger::Error("Failed to parse xmakefile content.");
+                return false;
+            }
 
-        xmakefile.FromJSON(jsonDoc, xmakefileDir);
-        file.close();
+            xmakefile.FromJSON(jsonDoc, xmakefileDir);
+            cachedResolvedConfigs = 0;
+        }
 
-        if (xmakefile.configs.empty())
+        if (xmakefile.Empty())
         {
-            Logger::LogError("No configurations found in the xmakefile.");
+            Logger::Error("No configurations found in the xmakefile.");
             return false;
         }
         else
         {
-            currentConfig = xmakefile.configs[0];
+            currentConfig = xmakefile.GetSnapshot(0);
+            PrepareCompileTemplates();
+            SaveXMakefileCache();
         }
 
-        Logger::LogVerbose("xmakefile parsed successfully.");
+        Logger::Verbose("xmakefile parsed successfully.");
 
 #ifdef DEBUG_MORE
         // print the parsed data for debugging
@@ -90,8 +163,9 @@ bool XMakefileParser::Parse(const std::string &path)
         std::cout << "License: " << xmakefile.xmakeFileLicense << std::endl;
         std::cout << "Configurations:" << std::endl;
 
-        for (const auto &config : xmakefile.configs)
+        for (size_t i = 0; i < xmakefile.ConfigCount(); ++i)
         {
+            const XMakefileConfig &config = xmakefile.GetConfig(i);
             std::cout << "  Name: " << config.Name << std::endl;
             std::cout << "  Build Type: " << config.BuildType << std::endl;
             std::cout << "  Build Dir: " << config.BuildDir << std::endl;
@@ -132,231 +206,228 @@ bool XMakefileParser::Parse(const std::string &path)
     }
     catch (const std::exception &e)
     {
-        Logger::LogError(std::string("Exception during parsing: ") + e.what());
+        Logger::Error("Exception during parsing: {}", e.what());
         return false;
     }
     catch (...)
     {
-        Logger::LogError("Unknown error occurred during parsing.");
+        Logger::Error("Unknown error occurred during parsing.");
         return false;
     }
 }
 
+size_t XMakefileParser::FindErrorOffset(std::string_view content)
+{
+    // ArduinoJson does not report where it stopped. A prefix that ends before the
+    // offending byte is merely incomplete while one that contains it fails,
+    // so bisect for the shortest failing prefix. Only runs on the error path.
+    auto fails = [&content](size_t length)
+    {
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(doc, content.data(), length);
+        return error && error != DeserializationError::IncompleteInput && error != DeserializationError::EmptyInput;
+    };
+
+    if (!fails(content.size()))
+    {
+        // The document is truncated, the error is at its end
+        return content.size();
+    }
+
+    size_t low = 0;
+    size_t high = content.size();
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (fails(middle))
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return low > 0 ? low - 1 : 0;
+}
+
+std::string XMakefileParser::DescribeLocation(std::string_view content, size_t offset)
+{
+    size_t line = 1;
+    size_t lineStart = 0;
+    for (size_t i = 0; i < offset && i < content.size(); i++)
+    {
+        if (content[i] == '\n')
+        {
+            line++;
+            lineStart = i + 1;
+        }
+    }
+    return "byte " + std::to_string(offset) + " (line " + std::to_string(line) + ", column " + std::to_string(offset - lineStart + 1) + ")";
+}
+
+void XMakefileParser::ParseFrom(const XMakefileParser &other)
+{
+    verbose = other.verbose;
+    xmakefilePath = other.xmakefilePath;
+    xmakefileHash = other.xmakefileHash;
+    xmakefileName = other.xmakefileName;
+    xmakefileDir = other.xmakefileDir;
+    xmakefile = other.xmakefile;
+    cachedResolvedConfigs = other.cachedResolvedConfigs;
+    currentConfig = other.currentConfig;
+    PrepareCompileTemplates();
+}
+
+std::vector<std::string> XMakefileParser::GetConfigNames() const
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < xmakefile.ConfigCount(); i++)
+    {
+        names.push_back(xmakefile.GetConfigName(i));
+    }
+    return names;
+}
+
 bool XMakefileParser::SetConfig(const std::string &configName)
 {
-    // Find the configuration by name
-    auto it = std::find_if(xmakefile.configs.begin(), xmakefile.configs.end(),
-                           [&configName](const XMakefileConfig &config)
-                           { return config.Name == configName; });
+    // Find the configuration by name, only this one gets resolved
+    ConfigSnapshot config = xmakefile.FindConfig(configName);
 
-    if (it != xmakefile.configs.end())
+    if (config != nullptr)
     {
-        currentConfig = *it;
-        Logger::LogVerbose("Configuration set to: " + configName);
+        currentConfig = std::move(config);
+        PrepareCompileTemplates();
+        SaveXMakefileCache();
+        Logger::Verbose("Configuration set to: {}", configName);
         return true;
     }
     else
     {
-        Logger::LogError("Configuration not found: " + configName);
+        Logger::Error("Configuration not found: {}", configName);
         return false;
     }
 }
 
-void XMakefileParser::CreateBuildList()
+bool XMakefileParser::CreateBuildList(const BuildStructCallback &onBuildStruct)
 {
     // create the build list from the current config
     buildStructureIndex = 0; // Reset the index for build strings
     buildStructures.clear(); // Clear previous build strings
     linkString.clear();      // Clear previous linker string
 
-    UpdateFileLists();
+    auto planStart = std::chrono::steady_clock::now();
 
-    std::vector<std::string> objectFiles;
+    commandArena.Clear();
 
-    // Create the build string for every source file
-    for (const auto &sourceFile : sourceFiles)
+    // Reuse the plan of the last run if neither the xmakefile nor the scanned directories changed
+    if (LoadBuildPlan())
     {
-        std::string buildString = (currentConfig.CompilerPath.empty() ? "" : currentConfig.CompilerPath + "/") + currentConfig.Compiler + " ";
-
-        // check file extension to add specific compiler flags
-        std::string ext = sourceFile.substr(sourceFile.find_last_of("."));
-        if (ext == ".c")
-        {
-            buildString += currentConfig.CCompilerFlags;
-        }
-        else if (ext == ".cpp" || ext == ".cc" || ext == ".cxx" || ext == ".m" || ext == ".mm")
-        {
-            buildString += currentConfig.CXXCompilerFlags;
-        }
-        else
-        {
-            Logger::LogWarning("Unknown file extension for file: " + sourceFile);
-            continue; // Skip unknown file types
-        }
-
-        // Add include paths
-        for (const auto &includePath : currentConfig.IncludePaths)
-        {
-            buildString += " -I" + includePath;
-        }
-
-        // Add defines
-        for (const auto &define : currentConfig.Defines)
-        {
-            if (define.starts_with("-D"))
-            {
-                buildString += " " + define;
-            }
-            else
-            {
-                buildString += " -D" + define;
-            }
-        }
-
-        // Add source file
-        buildString += " " + sourceFile;
-
-        std::string objectFile;
-
-        // replace path if object file with build dir
-        if (!currentConfig.OutputDir.empty())
-        {
-            std::filesystem::path sourceFilePath = sourceFile;
-            std::filesystem::path objectFilePath;
+        std::chrono::duration<double, std::milli> planTime = std::chrono::steady_clock::now() - planStart;
+        Logger::Verbose("Build plan for {} files loaded from cache in {} ms", buildStructures.size(), planTime.count());
 
-            // check if source path is relative or absolute
-            if (sourceFile[0] != '/' && sourceFile[1] != ':')
-            {
-                // relative path
-                objectFilePath = currentConfig.OutputDir / sourceFilePath;
-            }
-            else
-            {
-                // absolute path
-
-                // check both paths for same start path and replace source path up to this index
-                std::string sourcePath = sourceFile.substr(0, sourceFile.find_last_of("/\\"));
-                std::filesystem::path buildPath = std::filesystem::weakly_canonical(currentConfig.OutputDir);
-                std::string buildPathString = buildPath.string();
-                std::string upperPathString;
-                for (size_t i = 0; i < sourcePath.length() && i < buildPathString.length(); i++)
-                {
-                    if (sourcePath[i] != buildPathString[i])
-                    {
-                        upperPathString = sourcePath.substr(i) + "/" + sourceFilePath.filename().string();
-                        break;
-                    }
-                }
-
-                if (!upperPathString.empty())
-                {
-                    // get path from
-                    objectFilePath = buildPathString / std::filesystem::path(upperPathString);
-                }
-                else
-                {
-                    // use the same directory as the source file
-                    objectFilePath = currentConfig.OutputDir / sourceFilePath.filename();
-                }
-            }
-
-            std::string substring = objectFilePath.string().substr(0, objectFilePath.string().find_last_of('.'));
-            objectFile = substring + ".o";
-        }
-        else
+        if (onBuildStruct)
         {
-            // No build dir specified, use the same directory as the source file
-            objectFile = sourceFile.substr(0, sourceFile.find_last_of('.')) + ".o";
+            for (const auto &buildStruct : buildStructures)
+                onBuildStruct(buildStruct);
         }
+        return true;
+    }
 
-        // Add object file to the list
-        objectFiles.push_back(objectFile);
-
-        // Add output filename
-        buildString += " -c -o " + objectFile;
-
-        BuildStruct buildStruct;
-        buildStruct.sourceFile = sourceFile;
-        buildStruct.buildString = buildString;
-        buildStruct.objectFile = objectFile;
-
-        // Store the build string
-        buildStructures.push_back(buildStruct);
+    // Every source file becomes a build structure the moment it is found
+    if (!UpdateFileLists([this, &onBuildStruct](PathId sourceId)
+                         { AddBuildStruct(sourceId, onBuildStruct); }))
+    {
+        buildStructures.clear();
+        return false;
     }
 
     // Create the linker string based on the build type
-    if (currentConfig.BuildType == "Executable")
+    if (currentConfig->BuildType == "Executable")
     {
-        linkString = (currentConfig.CompilerPath.empty() ? "" : currentConfig.CompilerPath + "/") + currentConfig.Linker;
+        linkString = (currentConfig->CompilerPath.empty() ? "" : currentConfig->CompilerPath + "/") + currentConfig->Linker;
 
         // Add object files to the linker string
-        for (const auto &objectFile : objectFiles)
+        for (const auto &buildStruct : buildStructures)
         {
-            linkString += " " + objectFile;
+            linkString += " ";
+            linkString += buildStruct.objectFile;
         }
 
         // Add output filename
-        linkString += " -o " + currentConfig.OutputDir + "/" + currentConfig.OutputFilename;
+        linkString += " -o " + currentConfig->OutputDir + "/" + currentConfig->OutputFilename;
     }
-    else if (currentConfig.BuildType == "StaticLibrary")
+    else if (currentConfig->BuildType == "StaticLibrary")
     {
-        linkString = (currentConfig.CompilerPath.empty() ? "" : currentConfig.CompilerPath + "/") + currentConfig.Archiver;
+        linkString = (currentConfig->CompilerPath.empty() ? "" : currentConfig->CompilerPath + "/") + currentConfig->Archiver;
 
-        // Add archiver flags
-        linkString += " " + currentConfig.ArchiverFlags;
+        // Add archiver flags and the archive itself
+        linkString += " " + currentConfig->ArchiverFlags;
+        linkString += " " + currentConfig->OutputDir + "/" + currentConfig->OutputFilename;
 
         // Add object files to the static library
-        for (const auto &objectFile : objectFiles)
+        for (const auto &buildStruct : buildStructures)
         {
-            linkString += " " + objectFile;
+            linkString += " ";
+            linkString += buildStruct.objectFile;
         }
     }
-    else if (currentConfig.BuildType == "SharedLibrary")
+    else if (currentConfig->BuildType == "SharedLibrary")
     {
-        linkString = (currentConfig.CompilerPath.empty() ? "" : currentConfig.CompilerPath + "/") + currentConfig.Linker;
+        linkString = (currentConfig->CompilerPath.empty() ? "" : currentConfig->CompilerPath + "/") + currentConfig->Linker;
 
         // Add shared library flags
         linkString += " -shared";
 
         // Add object files to the linker string
-        for (const auto &objectFile : objectFiles)
+        for (const auto &buildStruct : buildStructures)
         {
-            linkString += " " + objectFile;
+            linkString += " ";
+            linkString += buildStruct.objectFile;
         }
 
         // Add output filename
-        linkString += " -o " + currentConfig.OutputDir + "/" + currentConfig.OutputFilename;
+        linkString += " -o " + currentConfig->OutputDir + "/" + currentConfig->OutputFilename;
     }
 
-    // Add library paths
-    for (const auto &libraryPath : currentConfig.LibraryPaths)
+    // The archiver takes nothing but object files, libraries are linked into the executable using the archive
+    if (currentConfig->BuildType != "StaticLibrary")
     {
-        linkString += " -L" + libraryPath;
-    }
+        // Add library paths
+        for (const auto &libraryPath : currentConfig->LibraryPaths)
+        {
+            linkString += " -L" + libraryPath;
+        }
 
-    // Add libraries
-    for (const auto &library : currentConfig.Libraries)
-    {
-        // check if library is absolute or relative
-        if (library[0] != '/' && library[1] != ':')
+        // Add libraries
+        for (const auto &library : currentConfig->Libraries)
         {
-            linkString += " -l" + library;
+            // check if library is absolute or relative
+            if (library[0] != '/' && library[1] != ':')
+            {
+                linkString += " -l" + library;
+            }
+            else
+            {
+                linkString += " " + library;
+            }
         }
-        else
+
+        // Add include paths
+        for (const auto &includePath : currentConfig->IncludePaths)
         {
-            linkString += " " + library;
+            linkString += " -I" + includePath;
         }
+
+        // Add linker flags
+        linkString += " " + currentConfig->LinkerFlags;
     }
 
-    // Add include paths
-    for (const auto &includePath : currentConfig.IncludePaths)
+    SaveBuildPlan();
+
+    auto planEnd = std::chrono::steady_clock::now();
+    if (verbose)
     {
-        linkString += " -I" + includePath;
+        std::chrono::duration<double, std::milli> planTime = planEnd - planStart;
+        Logger::Verbose("Build plan for {} files created in {} ms", buildStructures.size(), planTime.count());
     }
 
-    // Add linker flags
-    linkString += " " + currentConfig.LinkerFlags;
-
 #ifdef DEBUG_MORE
     std::cout << "Build strings:" << std::endl;
     for (const auto &buildString : buildStrings)
@@ -365,7 +436,14 @@ void XMakefileParser::CreateBuildList()
     }
     std::cout << "Linker string: " << linkString << std::endl;
 #endif
+    return true;
+}
+
+bool XMakefileParser::HeadersChanged()
+{
+    return CheckFileModifications(headerFiles, "Header");
 }
+
 void XMakefileParser::ResetBuildIndex()
 {
     buildStructureIndex = 0;
@@ -385,7 +463,7 @@ RebuildScheme XMakefileParser::CheckRebuild()
             std::cout << "Source files changed, rebuilding sources..." << std::endl;
         return RebuildScheme::Sources;
     }
-    else if (CheckFileModifications(currentConfig.Libraries, "Library"))
+    else if (CheckFileModifications(InternPaths(currentConfig->Libraries), "Library"))
     {
         if (verbose)
             std::cout << "Libraries changed, linking..." << std::endl;
@@ -399,7 +477,7 @@ RebuildScheme XMakefileParser::CheckRebuild()
 void XMakefileParser::LoadBuildTimes()
 {
     // Load the last build times from a file in the build directory
-    std::string buildTimeFile = currentConfig.OutputDir + "/build_times.txt";
+    std::string buildTimeFile = currentConfig->OutputDir + "/build_times.txt";
     std::ifstream file(buildTimeFile);
     if (!file.is_open())
     {
@@ -412,77 +490,332 @@ void XMakefileParser::LoadBuildTimes()
         size_t separator = line.find('|');
         if (separator != std::string::npos)
         {
-            std::string filename = line.substr(0, separator);
-            std::string timestamp = line.substr(separator + 1);
-            lastModifiedTimes[filename] = timestamp; // Store filename and timestamp
+            PathId fileId = PathTable::Instance().Intern(std::string_view(line).substr(0, separator));
+            lastModifiedTimes[fileId] = line.substr(separator + 1); // Store file and timestamp
         }
     }
     file.close();
 }
 void XMakefileParser::SaveBuildTimes()
 {
-    for (const std::string &file : sourceFiles)
-    {
-        if (file.empty())
-            continue;
-
-        std::filesystem::path path(file);
-        if (!std::filesystem::exists(path))
-            continue;
-
-        auto lastWriteTime = std::filesystem::last_write_time(path);
-        lastModifiedTimes[file] = FileTimestampToString(lastWriteTime);
-    }
-
-    for (const std::string &file : headerFiles)
-    {
-        if (file.empty())
-            continue;
-
-        std::filesystem::path path(file);
-        if (!std::filesystem::exists(path))
-            continue;
-
-        auto lastWriteTime = std::filesystem::last_write_time(path);
-        lastModifiedTimes[file] = FileTimestampToString(lastWriteTime);
-    }
+    UpdateBuildTimes(sourceFiles);
+    UpdateBuildTimes(headerFiles);
 
     // Save the last build times to a file in the build directory
-    std::string buildTimeFile = currentConfig.OutputDir + "/build_times.txt";
+    std::string buildTimeFile = currentConfig->OutputDir + "/build_times.txt";
     std::ofstream file(buildTimeFile);
     if (!file.is_open())
     {
-        Logger::LogError("Could not open build time file for writing: " + buildTimeFile);
+        Logger::Error("Could not open build time file for writing: {}", buildTimeFile);
         return;
     }
     for (const auto &entry : lastModifiedTimes)
     {
-        file << entry.first << "|" << entry.second << std::endl; // Write filename and timestamp
+        file << PathTable::Instance().Get(entry.first) << "|" << entry.second << "\n"; // Write filename and timestamp
     }
     file.close();
 
-    Logger::LogVerbose("Build times saved to: " + buildTimeFile);
+    Logger::Verbose("Build times saved to: {}", buildTimeFile);
 }
 
 //**************************************************************
 // Private functions
 //**************************************************************
 
-void XMakefileParser::UpdateFileLists()
+std::string XMakefileParser::GetXMakefileCacheFile() const
+{
+    return xmakefileDir + "/.xmake/" + xmakefileName + ".cache";
+}
+
+bool XMakefileParser::LoadXMakefileCache()
+{
+    MappedFile file;
+    if (!file.Open(GetXMakefileCacheFile()))
+        return false;
+
+    BinaryReader reader(file.View());
+
+    // Check the keys: format, xmakefile content and the directories paths were resolved against
+    if (reader.ReadString() != XMakefileCacheMagic || reader.ReadU32() != XMakefileCacheVersion ||
+        reader.ReadU64() != xmakefileHash || reader.ReadString() != xmakefileDir ||
+        reader.ReadString() != std::filesystem::current_path().string())
+    {
+        Logger::Verbose("xmakefile cache is outdated.");
+        return false;
+    }
+
+    // Check the environment variables the resolved configurations depend on
+    if (EnvironmentChanged(reader, "xmakefile"))
+        return false;
+
+    if (!reader.IsValid() || !xmakefile.Deserialize(reader) || !reader.AtEnd())
+    {
+        Logger::Warning("xmakefile cache is corrupt, recreating it.");
+        xmakefile.Clear();
+        return false;
+    }
+
+    cachedResolvedConfigs = xmakefile.ResolvedConfigCount();
+    return true;
+}
+
+void XMakefileParser::SaveXMakefileCache()
+{
+    // Only rewrite the cache if a configuration was resolved that it does not contain yet
+    size_t resolvedConfigs = xmakefile.ResolvedConfigCount();
+    if (resolvedConfigs <= cachedResolvedConfigs)
+        return;
+
+    BinaryWriter writer;
+    writer.WriteString(XMakefileCacheMagic);
+    writer.WriteU32(XMakefileCacheVersion);
+    writer.WriteU64(xmakefileHash);
+    writer.WriteString(xmakefileDir);
+    writer.WriteString(std::filesystem::current_path().string());
+
+    WriteEnvironment(writer, xmakefile.GetReferencedEnvironment());
+
+    xmakefile.Serialize(writer);
+
+    std::error_code error;
+    std::filesystem::create_directories(xmakefileDir + "/.xmake", error);
+    if (error || !writer.SaveToFile(GetXMakefileCacheFile()))
+    {
+        Logger::Verbose("Could not write xmakefile cache: {}", GetXMakefileCacheFile());
+        return;
+    }
+    cachedResolvedConfigs = resolvedConfigs;
+}
+
+std::string XMakefileParser::GetBuildPlanFile() const
+{
+    return currentConfig->OutputDir + "/build_plan.cache";
+}
+
+uint64_t XMakefileParser::ComputeSnapshotFingerprint(const std::vector<PathId> &paths)
+{
+    uint64_t fingerprint = HashBytes("");
+    for (PathId id : paths)
+    {
+        std::string_view path = PathTable::Instance().Get(id);
+
+        // Missing paths get a zero time, so creating them later changes the fingerprint
+        std::error_code error;
+        auto lastWriteTime = std::filesystem::last_write_time(std::filesystem::path(path), error);
+        int64_t time = error ? 0 : static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+
+        fingerprint = HashBytes(path, fingerprint);
+        fingerprint = HashBytes(std::string_view(reinterpret_cast<const char *>(&time), sizeof(time)), fingerprint);
+    }
+    return fingerprint;
+}
+
+bool XMakefileParser::LoadBuildPlan()
+{
+    MappedFile file;
+    if (!file.Open(GetBuildPlanFile()))
+        return false;
+
+    BinaryReader reader(file.View());
+
+    // Check the keys: format, xmakefile content, configuration and working directory
+    if (reader.ReadString() != BuildPlanMagic || reader.ReadU32() != BuildPlanVersion ||
+        reader.ReadU64() != xmakefileHash || reader.ReadString() != currentConfig->Name ||
+        reader.ReadString() != std::filesystem::current_path().string())
+    {
+        Logger::Verbose("Build plan cache is outdated.");
+        return false;
+    }
+
+    // Check the environment variables the configuration was resolved with
+    if (EnvironmentChanged(reader, "build plan"))
+        return false;
+
+    PathTable &pathTable = PathTable::Instance();
+
+    auto readPaths = [&reader, &pathTable](std::vector<PathId> &paths)
+    {
+        paths.clear();
+        uint32_t count = reader.ReadU32();
+        for (uint32_t i = 0; i < count && reader.IsValid(); i++)
+        {
+            paths.push_back(pathTable.Intern(reader.ReadString()));
+        }
+    };
+
+    // Check the directory snapshot
+    std::vector<PathId> cachedSnapshotPaths;
+    readPaths(cachedSnapshotPaths);
+    uint64_t fingerprint = reader.ReadU64();
+    if (!reader.IsValid() || fingerprint != ComputeSnapshotFingerprint(cachedSnapshotPaths))
+    {
+        Logger::Verbose("Directories changed since the build plan was cached.");
+        return false;
+    }
+
+    std::vector<PathId> cachedHeaderFiles;
+    std::vector<PathId> cachedSourceFiles;
+    std::vector<PathId> cachedLibraryFiles;
+    readPaths(cachedHeaderFiles);
+    readPaths(cachedSourceFiles);
+    readPaths(cachedLibraryFiles);
+
+    std::vector<BuildStruct> cachedBuildStructures;
+    uint32_t count = reader.ReadU32();
+    for (uint32_t i = 0; i < count && reader.IsValid(); i++)
+    {
+        BuildStruct buildStruct;
+        buildStruct.sourceId = pathTable.Intern(reader.ReadString());
+        buildStruct.sourceFile = pathTable.Get(buildStruct.sourceId);
+        buildStruct.objectId = pathTable.Intern(reader.ReadString());
+        buildStruct.objectFile = pathTable.Get(buildStruct.objectId);
+
+        // The commands are rebuilt from the templates, which only depend on the resolved
+        // configuration checked above
+        uint32_t language = reader.ReadU32();
+        if (language >= compileTemplates.size())
+        {
+            Logger::Warning("Build plan cache is corrupt, recreating it.");
+            commandArena.Clear();
+            return false;
+        }
+        buildStruct.buildString = commandArena.Concat({compileTemplates[language], " ", buildStruct.sourceFile, " -c -o ", buildStruct.objectFile});
+        cachedBuildStructures.push_back(buildStruct);
+    }
+    std::string_view cachedLinkString = reader.ReadString();
+
+    if (!reader.IsValid() || !reader.AtEnd())
+    {
+        Logger::Warning("Build plan cache is corrupt, recreating it.");
+        commandArena.Clear();
+        return false;
+    }
+
+    snapshotPaths = std::move(cachedSnapshotPaths);
+    headerFiles = std::move(cachedHeaderFiles);
+    sourceFiles = std::move(cachedSourceFiles);
+    libraryFiles = std::move(cachedLibraryFiles);
+    buildStructures = std::move(cachedBuildStructures);
+    linkString = cachedLinkString;
+    return true;
+}
+
+void XMakefileParser::SaveBuildPlan()
+{
+    if (!planCacheable || currentConfig->OutputDir.empty())
+        return;
+
+    PathTable &pathTable = PathTable::Instance();
+    BinaryWriter writer;
+
+    writer.WriteString(BuildPlanMagic);
+    writer.WriteU32(BuildPlanVersion);
+    writer.WriteU64(xmakefileHash);
+    writer.WriteString(currentConfig->Name);
+    writer.WriteString(std::filesystem::current_path().string());
+    WriteEnvironment(writer, currentConfig->GetReferencedEnvironment());
+
+    auto writePaths = [&writer, &pathTable](const std::vector<PathId> &paths)
+    {
+        writer.WriteU32(static_cast<uint32_t>(paths.size()));
+        for (PathId id : paths)
+        {
+            writer.WriteString(pathTable.Get(id));
+        }
+    };
+
+    std::error_code error;
+    std::filesystem::create_directories(currentConfig->OutputDir, error);
+
+    // The output directory may be inside a scanned directory, so take the
+    // fingerprint after creating it
+    writePaths(snapshotPaths);
+    writer.WriteU64(ComputeSnapshotFingerprint(snapshotPaths));
+
+    writePaths(headerFiles);
+    writePaths(sourceFiles);
+    writePaths(libraryFiles);
+
+    writer.WriteU32(static_cast<uint32_t>(buildStructures.size()));
+    for (const auto &buildStruct : buildStructures)
+    {
+        writer.WriteString(buildStruct.sourceFile);
+        writer.WriteString(buildStruct.objectFile);
+        writer.WriteU32(static_cast<uint32_t>(GetSourceLanguage(buildStruct.sourceFile)));
+    }
+    writer.WriteString(linkString);
+
+    if (!writer.SaveToFile(GetBuildPlanFile()))
+    {
+        Logger::Verbose("Could not write build plan cache: {}", GetBuildPlanFile());
+    }
+}
+
+bool XMakefileParser::UpdateFileLists(const FileFoundCallback &onSourceFound)
 {
+    snapshotPaths.clear();
+    planCacheable = true;
+
+    const std::vector<std::string> headerExtensions = {".h", ".hpp"};
+    const std::vector<std::string> sourceExtensions = {".cpp", ".c", ".cc", ".cxx", ".m", ".mm"};
+
     // Find all header files in include paths
-    UpdateLists(currentConfig.IncludePaths, {".h", ".hpp"}, headerFiles);
+    UpdateLists(currentConfig->IncludePaths, headerExtensions, headerFiles);
+    AddGeneratedFiles(headerExtensions, headerFiles, {});
 
-    // Find all source files in source paths
-    UpdateLists(currentConfig.SourcePaths, {".cpp", ".c", ".cc", ".cxx", ".m", ".mm"}, sourceFiles);
+    // Take the source files from the manifest if one is given, otherwise find them in source paths
+    if (!currentConfig->Sources.empty() || !currentConfig->SourceListFile.empty())
+    {
+        if (!UpdateListsFromManifest(sourceExtensions, sourceFiles, onSourceFound))
+            return false;
+    }
+    else
+    {
+        UpdateLists(currentConfig->SourcePaths, sourceExtensions, sourceFiles, onSourceFound);
+    }
+    AddGeneratedFiles(sourceExtensions, sourceFiles, onSourceFound);
 
     // Find all library files in library paths
-    UpdateLists(currentConfig.LibraryPaths, {".a", ".so", ".dll"}, libraryFiles);
+    UpdateLists(currentConfig->LibraryPaths, {".a", ".so", ".dll"}, libraryFiles);
+    return true;
 }
-void XMakefileParser::UpdateLists(const std::vector<std::string> &paths, const std::vector<std::string> &extensions, std::vector<std::string> &outputFiles)
+
+void XMakefileParser::UpdateLists(const std::vector<std::string> &paths, const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound)
 {
     outputFiles.clear(); // Clear previous files
 
+    // Another configuration may have scanned the same paths already
+    std::string cacheKey;
+    if (discoveryCache && !paths.empty())
+    {
+        for (const std::vector<std::string> *list : {&paths, &extensions, &currentConfig->ExcludePaths, &currentConfig->ExcludeFiles})
+        {
+            for (const auto &entry : *list)
+            {
+                cacheKey += entry;
+                cacheKey += '\n';
+            }
+            cacheKey += '\0';
+        }
+
+        std::vector<PathId> scannedPaths;
+        if (discoveryCache->Find(cacheKey, outputFiles, scannedPaths))
+        {
+            snapshotPaths.insert(snapshotPaths.end(), scannedPaths.begin(), scannedPaths.end());
+            if (onFileFound)
+            {
+                for (PathId file : outputFiles)
+                    onFileFound(file);
+            }
+            return;
+        }
+    }
+    size_t firstSnapshotPath = snapshotPaths.size();
+
+    // Every list is deduplicated on its own
+    discoveredFiles.clear();
+    discoveredDirectories.clear();
+
     for (const auto &includePath : paths)
     {
         // check if include path is relative or absolute
@@ -490,95 +823,432 @@ void XMakefileParser::UpdateLists(const std::vector<std::string> &paths, const s
         {
             // relative path, convert to absolute
             std::filesystem::path absPath = std::filesystem::current_path() / includePath;
-            FindFiles(absPath.string(), extensions, outputFiles);
+            FindFiles(absPath.lexically_normal().string(), extensions, outputFiles, onFileFound);
         }
         else
         {
             // absolute path
-            FindFiles(includePath, extensions, outputFiles);
+            FindFiles(std::filesystem::path(includePath).lexically_normal().string(), extensions, outputFiles, onFileFound);
         }
     }
+
+    if (!cacheKey.empty())
+    {
+        discoveryCache->Store(cacheKey, outputFiles, std::vector<PathId>(snapshotPaths.begin() + static_cast<std::ptrdiff_t>(firstSnapshotPath), snapshotPaths.end()));
+    }
 }
-void XMakefileParser::FindFiles(const std::string &path, const std::vector<std::string> &extensions, std::vector<std::string> &outputFiles)
+void XMakefileParser::FindFiles(const std::string &path, const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound)
 {
+    // Adding or removing entries changes the modification time of a directory
+    snapshotPaths.push_back(PathTable::Instance().Intern(path));
+
     if (!std::filesystem::exists(path) || !std::filesystem::is_directory(path))
     {
-        Logger::LogError("Path does not exist or is not a directory: " + path);
+        Logger::Error("Path does not exist or is not a directory: {}", path);
+        return;
+    }
+
+    // Skip directories which were already scanned. This happens for overlapping
+    // paths like "src" and "src/net" and also breaks symlink cycles.
+    FileId directoryId;
+    if (GetFileId(path, directoryId) && !discoveredDirectories.insert(directoryId).second)
+    {
+        if (verbose)
+            Logger::Warning("Directory already scanned, skipping overlap: {}", path);
         return;
     }
 
     for (const auto &entry : std::filesystem::directory_iterator(path))
     {
-        bool isExcluded = false;
+        if (IsExcludedPath(entry.path().string()))
+            continue;
 
-        for (const auto &excludePath : currentConfig.ExcludePaths)
+        if (entry.is_directory())
+        {
+            FindFiles(entry.path().string(), extensions, outputFiles, onFileFound);
+        }
+        else if (entry.is_regular_file())
         {
-            // check if exclude path has * at the beginning and the end
-            if (excludePath[0] == '*' && excludePath[excludePath.size() - 1] == '*')
+            std::string ext = entry.path().extension().string();
+            if (std::find(extensions.begin(), extensions.end(), ext) != extensions.end())
             {
-                // check if the path contains the exclude path
-                if (entry.path().string().find(excludePath.substr(1, excludePath.size() - 2)) != std::string::npos)
+                if (IsExcludedFile(entry.path()))
+                    continue;
+
+                // Skip files which were already found through another path
+                FileId fileId;
+                if (GetFileId(entry.path().string(), fileId) && !discoveredFiles.insert(fileId).second)
                 {
-                    isExcluded = true;
-                    break;
+                    if (verbose)
+                        Logger::Warning("File already found through another path, skipping: {}", entry.path().string());
+                    continue;
                 }
+
+                outputFiles.push_back(PathTable::Instance().Intern(entry.path().string()));
+                if (onFileFound)
+                    onFileFound(outputFiles.back());
             }
-            else if (excludePath[0] == '*')
+        }
+    }
+}
+
+bool XMakefileParser::UpdateListsFromManifest(const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound)
+{
+    outputFiles.clear(); // Clear previous files
+    discoveredFiles.clear();
+
+    std::vector<std::string> entries = currentConfig->Sources;
+
+    // Append the entries of the source list file, one path per line
+    if (!currentConfig->SourceListFile.empty())
+    {
+        snapshotPaths.push_back(PathTable::Instance().Intern(currentConfig->SourceListFile));
+
+        // Without its list the build would silently miss sources
+        std::ifstream file(currentConfig->SourceListFile);
+        if (!file.is_open())
+        {
+            Logger::Error("Could not open source list file: {}", currentConfig->SourceListFile);
+            return false;
+        }
+
+        std::string basePath = xmakefileDir.empty() ? "" : xmakefileDir + "/";
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // trim whitespace and skip empty lines and comments
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+            size_t last = line.find_last_not_of(" \t\r");
+            line = line.substr(first, last - first + 1);
+
+            entries.push_back(XMakefileConfig::ResolvePath(line, basePath));
+        }
+        if (file.bad())
+        {
+            Logger::Error("Could not read source list file: {}", currentConfig->SourceListFile);
+            return false;
+        }
+    }
+
+    for (const auto &entry : entries)
+    {
+        if (entry.empty())
+            continue;
+
+        // The directory of an entry decides whether the entry exists or which files a pattern matches
+        std::string entryDir = std::filesystem::path(entry).parent_path().string();
+        if (entryDir.find_first_of("*?[") != std::string::npos)
+            planCacheable = false; // Patterns in directories can not be tracked by the snapshot
+        else
+            snapshotPaths.push_back(PathTable::Instance().Intern(entryDir));
+
+        // Expand glob patterns, plain paths are taken as they are
+        std::vector<std::string> matches;
+        if (entry.find_first_of("*?[") != std::string::npos)
+        {
+            glob_t globResult{};
+            if (glob(entry.c_str(), 0, nullptr, &globResult) == 0)
             {
-                // check if the path ends with the exclude path
-                if (entry.path().string().ends_with(excludePath.substr(1)))
+                for (size_t i = 0; i < globResult.gl_pathc; i++)
                 {
-                    isExcluded = true;
-                    break;
+                    matches.push_back(globResult.gl_pathv[i]);
                 }
             }
-            else if (excludePath[excludePath.size() - 1] == '*')
+            else
             {
-                // check if the path starts with the exclude path
-                if (entry.path().string().starts_with(excludePath.substr(0, excludePath.size() - 1)))
-                {
-                    isExcluded = true;
-                    break;
-                }
+                Logger::Verbose("No files match source pattern: {}", entry);
+            }
+            globfree(&globResult);
+        }
+        else
+        {
+            matches.push_back(entry);
+        }
+
+        for (const auto &match : matches)
+        {
+            std::filesystem::path filePath(match);
+            std::string ext = filePath.extension().string();
+            if (std::find(extensions.begin(), extensions.end(), ext) == extensions.end())
+                continue;
+
+            if (IsExcludedPath(match) || IsExcludedFile(filePath))
+                continue;
+
+            FileId fileId;
+            if (!GetFileId(match, fileId))
+            {
+                Logger::Warning("Listed source file does not exist: {}", match);
+                continue;
             }
-            else if (entry.path().string().find(excludePath) != std::string::npos)
+            if (!discoveredFiles.insert(fileId).second)
             {
-                isExcluded = true;
-                break;
+                if (verbose)
+                    Logger::Warning("Source file listed more than once, skipping: {}", match);
+                continue;
             }
+
+            outputFiles.push_back(PathTable::Instance().Intern(filePath.lexically_normal().string()));
+            if (onFileFound)
+                onFileFound(outputFiles.back());
+        }
+    }
+    return true;
+}
+
+void XMakefileParser::AddGeneratedFiles(const std::vector<std::string> &extensions, std::vector<PathId> &outputFiles, const FileFoundCallback &onFileFound)
+{
+    // Files written by custom commands count wherever they are generated, unless they were found already
+    std::unordered_set<PathId> knownFiles(outputFiles.begin(), outputFiles.end());
+    for (const auto &command : currentConfig->CustomCommands)
+    {
+        for (const auto &output : command.Outputs)
+        {
+            std::filesystem::path outputPath = std::filesystem::path(output).lexically_normal();
+            if (std::find(extensions.begin(), extensions.end(), outputPath.extension().string()) == extensions.end())
+                continue;
+            if (IsExcludedPath(outputPath.string()) || IsExcludedFile(outputPath))
+                continue;
+
+            PathId outputId = PathTable::Instance().Intern(outputPath.string());
+            if (!knownFiles.insert(outputId).second)
+                continue;
+
+            outputFiles.push_back(outputId);
+            if (onFileFound)
+                onFileFound(outputId);
         }
+    }
+}
 
-        if (isExcluded)
+bool XMakefileParser::IsExcludedPath(const std::string &path) const
+{
+    for (const auto &excludePath : currentConfig->ExcludePaths)
+    {
+        if (excludePath.empty())
             continue;
 
-        if (entry.is_directory())
+        // check if exclude path has * at the beginning and the end
+        if (excludePath[0] == '*' && excludePath[excludePath.size() - 1] == '*')
         {
-            FindFiles(entry.path().string(), extensions, outputFiles);
+            // check if the path contains the exclude path
+            if (path.find(excludePath.substr(1, excludePath.size() - 2)) != std::string::npos)
+                return true;
         }
-        else if (entry.is_regular_file())
+        else if (excludePath[0] == '*')
         {
-            std::string ext = entry.path().extension().string();
-            if (std::find(extensions.begin(), extensions.end(), ext) != extensions.end())
+            // check if the path ends with the exclude path
+            if (path.ends_with(excludePath.substr(1)))
+                return true;
+        }
+        else if (excludePath[excludePath.size() - 1] == '*')
+        {
+            // check if the path starts with the exclude path
+            if (path.starts_with(excludePath.substr(0, excludePath.size() - 1)))
+                return true;
+        }
+        else if (path.find(excludePath) != std::string::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool XMakefileParser::IsExcludedFile(const std::filesystem::path &path) const
+{
+    for (const auto &excludeFile : currentConfig->ExcludeFiles)
+    {
+        if ((path.filename() == excludeFile) || (path.string() == excludeFile))
+            return true;
+    }
+    return false;
+}
+
+void XMakefileParser::AddBuildStruct(PathId sourceId, const BuildStructCallback &onBuildStruct)
+{
+    PathTable &pathTable = PathTable::Instance();
+    std::string_view sourceFile = pathTable.Get(sourceId);
+
+    SourceLanguage language = GetSourceLanguage(sourceFile);
+    if (language == SourceLanguage::Unknown)
+    {
+        Logger::Warning("Unknown file extension for file: {}", sourceFile);
+        return; // Skip unknown file types
+    }
+
+    // Create the build string from the prepared templates
+    BuildStruct buildStruct;
+    buildStruct.sourceId = sourceId;
+    buildStruct.sourceFile = sourceFile;
+    buildStruct.objectId = GetObjectFile(sourceId);
+    buildStruct.objectFile = pathTable.Get(buildStruct.objectId);
+    buildStruct.buildString = commandArena.Concat({compileTemplates[static_cast<size_t>(language)],
+                                                   " ", sourceFile, " -c -o ", buildStruct.objectFile});
+
+    buildStructures.push_back(buildStruct);
+    if (onBuildStruct)
+        onBuildStruct(buildStruct);
+}
+
+void XMakefileParser::PrepareCompileTemplates()
+{
+    // Everything except the source and object file is the same for all
+    // files of one language, so render it only once per configuration
+    std::string prefix = (currentConfig->CompilerPath.empty() ? "" : currentConfig->CompilerPath + "/") + currentConfig->Compiler + " ";
+
+    std::string common;
+
+    // Add include paths
+    for (const auto &includePath : currentConfig->IncludePaths)
+    {
+        common += " -I" + includePath;
+    }
+
+    // Add defines
+    for (const auto &define : currentConfig->Defines)
+    {
+        if (define.starts_with("-D"))
+        {
+            common += " " + define;
+        }
+        else
+        {
+            common += " -D" + define;
+        }
+    }
+
+    compileTemplates[static_cast<size_t>(SourceLanguage::C)] = prefix + currentConfig->CCompilerFlags + common;
+    compileTemplates[static_cast<size_t>(SourceLanguage::CXX)] = prefix + currentConfig->CXXCompilerFlags + common;
+
+    // The object file mapping depends on the output directory
+    canonicalOutputDir.clear();
+    objectFileCache.clear();
+}
+
+XMakefileParser::SourceLanguage XMakefileParser::GetSourceLanguage(std::string_view sourceFile)
+{
+    size_t dot = sourceFile.find_last_of('.');
+    if (dot == std::string_view::npos)
+        return SourceLanguage::Unknown;
+
+    std::string_view ext = sourceFile.substr(dot);
+    if (ext == ".c")
+        return SourceLanguage::C;
+    if (ext == ".cpp" || ext == ".cc" || ext == ".cxx" || ext == ".m" || ext == ".mm")
+        return SourceLanguage::CXX;
+    return SourceLanguage::Unknown;
+}
+
+PathId XMakefileParser::GetObjectFile(PathId sourceId)
+{
+    auto cached = objectFileCache.find(sourceId);
+    if (cached != objectFileCache.end())
+        return cached->second;
+
+    std::string_view sourceFile = PathTable::Instance().Get(sourceId);
+    std::string objectFile;
+
+    // replace path if object file with build dir
+    if (!currentConfig->OutputDir.empty())
+    {
+        std::filesystem::path sourceFilePath = sourceFile;
+        std::filesystem::path objectFilePath;
+
+        // check if source path is relative or absolute
+        if (sourceFile[0] != '/' && sourceFile[1] != ':')
+        {
+            // relative path
+            objectFilePath = currentConfig->OutputDir / sourceFilePath;
+        }
+        else
+        {
+            // absolute path
+
+            // the canonical build path is the same for all files
+            if (canonicalOutputDir.empty())
+                canonicalOutputDir = std::filesystem::weakly_canonical(currentConfig->OutputDir).string();
+
+            // check both paths for same start path and replace source path up to this index
+            std::string_view sourcePath = sourceFile.substr(0, sourceFile.find_last_of("/\\"));
+            std::string upperPathString;
+            for (size_t i = 0; i < sourcePath.length() && i < canonicalOutputDir.length(); i++)
             {
-                for (const auto &excludeFile : currentConfig.ExcludeFiles)
+                if (sourcePath[i] != canonicalOutputDir[i])
                 {
-                    if ((entry.path().filename() == excludeFile) || (entry.path().string() == excludeFile))
-                    {
-                        isExcluded = true;
-                        break;
-                    }
+                    upperPathString = std::string(sourcePath.substr(i)) + "/" + sourceFilePath.filename().string();
+                    break;
                 }
+            }
 
-                if (isExcluded)
-                    continue;
-
-                outputFiles.push_back(entry.path().string());
+            if (!upperPathString.empty())
+            {
+                // get path from
+                objectFilePath = canonicalOutputDir / std::filesystem::path(upperPathString);
+            }
+            else
+            {
+                // use the same directory as the source file
+                objectFilePath = currentConfig->OutputDir / sourceFilePath.filename();
             }
         }
+
+        std::string substring = objectFilePath.string().substr(0, objectFilePath.string().find_last_of('.'));
+        objectFile = substring + ".o";
+    }
+    else
+    {
+        // No build dir specified, use the same directory as the source file
+        objectFile = std::string(sourceFile.substr(0, sourceFile.find_last_of('.'))) + ".o";
+    }
+
+    PathId objectId = PathTable::Instance().Intern(objectFile);
+    objectFileCache.emplace(sourceId, objectId);
+    return objectId;
+}
+
+bool XMakefileParser::GetFileId(const std::string &path, FileId &fileId)
+{
+    struct stat fileStat{};
+    if (stat(path.c_str(), &fileStat) != 0)
+        return false;
+
+    // Some file systems (e.g. on Windows) do not provide inode numbers
+    if (fileStat.st_ino == 0)
+        return false;
+
+    fileId.device = fileStat.st_dev;
+    fileId.inode = fileStat.st_ino;
+    return true;
+}
+
+void XMakefileParser::UpdateBuildTimes(const std::vector<PathId> &files)
+{
+    for (PathId file : files)
+    {
+        std::filesystem::path path(PathTable::Instance().Get(file));
+        if (path.empty() || !std::filesystem::exists(path))
+            continue;
+
+        auto lastWriteTime = std::filesystem::last_write_time(path);
+        lastModifiedTimes[file] = FileTimestampToString(lastWriteTime);
+    }
+}
+
+std::vector<PathId> XMakefileParser::InternPaths(const std::vector<std::string> &paths)
+{
+    std::vector<PathId> ids;
+    ids.reserve(paths.size());
+    for (const auto &path : paths)
+    {
+        ids.push_back(PathTable::Instance().Intern(path));
     }
+    return ids;
 }
 
-bool XMakefileParser::CheckFileModifications(const std::vector<std::string> &files, const std::string &fileType)
+bool XMakefileParser::CheckFileModifications(const std::vector<PathId> &files, const std::string &fileType)
 {
     if (lastModifiedTimes.empty())
     {
@@ -587,29 +1257,29 @@ bool XMakefileParser::CheckFileModifications(const std::vector<std::string> &fil
     }
 
     // Check if files exist and their last modified times
-    for (const auto &file : files)
+    for (PathId file : files)
     {
-        std::filesystem::path filePath(file);
-        if (!std::filesystem::exists(filePath))
+        auto it = lastModifiedTimes.find(file);
+        if (it == lastModifiedTimes.end() || it->second.empty())
         {
             continue;
         }
 
-        // Check last modified time
-        auto lastWriteTime = std::filesystem::last_write_time(filePath);
-
-        const std::string &timestamp = lastModifiedTimes[filePath.string()];
-        if (timestamp.empty())
+        // Check last modified time, a single stat also tells whether the file exists
+        std::filesystem::path filePath(PathTable::Instance().Get(file));
+        std::error_code error;
+        auto lastWriteTime = std::filesystem::last_write_time(filePath, error);
+        if (error)
         {
             continue;
         }
 
-        auto lastBuildTime = StringToFileTimestamp(lastModifiedTimes[filePath.string()]);
+        auto lastBuildTime = StringToFileTimestamp(it->second);
 
         // Check if the last write time is different from the last build time
         if (lastWriteTime > lastBuildTime)
         {
-            Logger::LogVerbose(fileType + " file changed: " + file);
+            Logger::Verbose("{} file changed: {}", fileType, filePath.native());
             return true; // File has changed
         }
     }
@@ -627,3 +1297,37 @@ std::filesystem::file_time_type XMakefileParser::StringToFileTimestamp(const std
     auto seconds = std::stoll(timestamp);                                  // Convert string to long long
     return std::filesystem::file_time_type(std::chrono::seconds(seconds)); // Convert to file_time_type
 }
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+static void WriteEnvironment(BinaryWriter &writer, const std::map<std::string, std::optional<std::string>> &environment)
+{
+    writer.WriteU32(static_cast<uint32_t>(environment.size()));
+    for (const auto &[name, value] : environment)
+    {
+        writer.WriteString(name);
+        writer.WriteU32(value.has_value() ? 1 : 0);
+        writer.WriteString(value.value_or(""));
+    }
+}
+
+static bool EnvironmentChanged(BinaryReader &reader, const char *cacheName)
+{
+    uint32_t count = reader.ReadU32();
+    for (uint32_t i = 0; i < count && reader.IsValid(); i++)
+    {
+        std::string name(reader.ReadString());
+        bool wasSet = reader.ReadU32() != 0;
+        std::string_view value = reader.ReadString();
+
+        const char *currentValue = getenv(name.c_str());
+        if (reader.IsValid() && (wasSet != (currentValue != nullptr) || (wasSet && value != currentValue)))
+        {
+            Logger::Verbose("Environment variable {} changed since the {} was cached.", name, cacheName);
+            return true;
+        }
+    }
+    return false;
+}
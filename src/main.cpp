@@ -7,6 +7,7 @@
 #include "xmake.h"
 #include <filesystem>
 #include <Logger.h>
+#include <sys/resource.h>
 
 //**************************************************************
 // Main program
@@ -18,9 +19,20 @@ int main(int argc, char **argv)
     parser.SetUsage("xmake [options]");
     parser.RegisterOption("-h", "Show help message");
     parser.RegisterOption("--version", "Show version information");
-    parser.RegisterOption("-c", "Configuration to use (default: first one in xmakefile)", true);
+    parser.RegisterOption("-c", "Configuration to use (default: first one in xmakefile), several separated by commas", true);
+    parser.RegisterOption("--all-configs", "Build all configurations of the xmakefile");
     parser.RegisterOption("-v", "Enable verbose output");
     parser.RegisterOption("-j", "Number of jobs to run simultaneously", true);
+    parser.RegisterOption("--jobserver-style", "Jobserver exported to the commands of the build: pipe (default), fifo or none", true);
+    parser.RegisterOption("--host-jobs", "Number of jobs of all xmake processes of the host together", true);
+    parser.RegisterOption("--host-jobs-per-user", "Share of --host-jobs the processes of one user may take", true);
+    parser.RegisterOption("--host-jobs-dir", "Lock directory of --host-jobs (default: /run/xmake)", true);
+    parser.RegisterOption("--max-load", "Start no new jobs while the load average is above the given value", true);
+    parser.RegisterOption("--max-pressure", "Start no new jobs while the PSI pressure is above the given percentage, e.g. 20 or memory=10,io=40", true);
+    parser.RegisterOption("--min-free-memory", "Start no new jobs while less than the given MiB of memory are available", true);
+    parser.RegisterOption("--job-memory-limit", "Limit the memory of every job to the given MiB", true);
+    parser.RegisterOption("-k", "Keep going until the given number of jobs failed (0 = no limit)", true);
+    parser.RegisterOption("--log-file", "Write a copy of the output to the given file", true);
     parser.RegisterOption("--print_env", "Print environment variables");
     parser.RegisterOption("clean", "Clean all build files (clean_commands needs to be set in xmakefile)");
     parser.RegisterOption("run", "Run the output file after building");
@@ -43,29 +55,43 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    // Output goes through a background writer from here on, flushed at exit and on signals
+    if (!Logger::StartAsync(parser.IsOptionSet("--log-file") ? parser.GetOptionValue("--log-file") : ""))
+    {
+        return 1;
+    }
+
+    // Every running job holds three descriptors, so allow as many as the hard limit does
+    struct rlimit fileLimit;
+    if (getrlimit(RLIMIT_NOFILE, &fileLimit) == 0 && fileLimit.rlim_cur < fileLimit.rlim_max)
+    {
+        fileLimit.rlim_cur = fileLimit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &fileLimit);
+    }
+
     bool verbose = parser.IsOptionSet("-v");
     if (verbose)
     {
         Logger::SetVerbose(true);
-        Logger::LogInfo("Verbose mode enabled");
+        Logger::Info("Verbose mode enabled");
     }
 
     std::string xmakefilePath = parser.Find("xmakefile.json");
 
     if (!xmakefilePath.empty())
     {
-        Logger::LogVerbose("Using xmakefile: " + xmakefilePath);
+        Logger::Verbose("Using xmakefile: {}", xmakefilePath);
     }
     else
     {
         xmakefilePath = std::filesystem::current_path().string() + "/xmakefile.json";
-        Logger::LogVerbose("No xmakefile specified, using default.");
+        Logger::Verbose("No xmakefile specified, using default.");
     }
 
     XMake xmake(parser);
     if (!xmake.Init(xmakefilePath))
     {
-        Logger::LogError("Failed to initialize xmake.");
+        Logger::Error("Failed to initialize xmake.");
         return 1;
     }
 
@@ -109,7 +135,7 @@ int main(int argc, char **argv)
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
-    std::cout << "Build completed in " << elapsed.count() << " seconds." << std::endl;
+    Logger::Info("Build completed in {} seconds.", elapsed.count());
 
     return 0;
 }
\ No newline at end of file
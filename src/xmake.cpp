@@ -3,8 +3,22 @@
 //**************************************************************
 
 #include "xmake.h"
+#include "BuildScheduler.h"
 #include "SecurityHelper.h"
 #include <Logger.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+
+//**************************************************************
+// Local function prototypes
+//**************************************************************
+
+static void InstallCancelHandlers();
+static void RestoreCancelHandlers();
+static void CancelBuildOnSignal(int signal);
 
 //**************************************************************
 // Public functions
@@ -12,295 +26,361 @@
 
 XMake::XMake(const CmdLineParser &cmdLineParser)
     : parser(),
+      extraParsers(),
+      dependencyParsers(),
+      targetDependencies(),
+      buildOrder(),
       cmdLineParser(cmdLineParser),
-      selectedConfig(cmdLineParser.GetOptionValue("-c", "")),
+      selectedConfigs(),
       verbose(cmdLineParser.IsOptionSet("-v"))
 {
+    // -c takes a comma separated list of configurations
+    std::string configList = cmdLineParser.GetOptionValue("-c", "");
+    size_t start = 0;
+    while (start <= configList.size())
+    {
+        size_t end = configList.find(',', start);
+        if (end == std::string::npos)
+            end = configList.size();
+
+        std::string name = configList.substr(start, end - start);
+        size_t first = name.find_first_not_of(" \t");
+        if (first != std::string::npos)
+        {
+            name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+            if (std::find(selectedConfigs.begin(), selectedConfigs.end(), name) == selectedConfigs.end())
+                selectedConfigs.push_back(name);
+        }
+        start = end + 1;
+    }
 }
 
 bool XMake::Init(const std::string &makefileName)
 {
     parser.SetVerbose(verbose);
+    parser.SetDiscoveryCache(nullptr);
+    extraParsers.clear();
+    dependencyParsers.clear();
+    targetDependencies.clear();
+    buildOrder.clear();
 
     if (!parser.Parse(makefileName))
     {
         return false;
     }
 
-    if (!selectedConfig.empty())
+    std::vector<std::string> configNames = cmdLineParser.IsOptionSet("--all-configs") ? parser.GetConfigNames() : selectedConfigs;
+
+    if (!configNames.empty())
     {
-        if (!parser.SetConfig(selectedConfig))
-            return false;
+        // Resolve all of them here, the other parsers take them over with the parsed xmakefile
+        for (auto name = configNames.rbegin(); name != configNames.rend(); ++name)
+        {
+            if (!parser.SetConfig(*name))
+                return false;
+        }
     }
     else
     {
         // If no config is specified, use the first one
-        Logger::LogInfo("No configuration specified, using [" + parser.GetCurrentConfig().Name + "]");
+        Logger::Info("No configuration specified, using [{}]", parser.GetCurrentConfig()->Name);
     }
 
-    parser.LoadBuildTimes();
-
-    return true;
-}
-
-bool XMake::Build()
-{
-    parser.CreateBuildList();
-
-    // check if dependencies are up to date
-    if (parser.GetBuildStructures().empty())
+    for (size_t i = 1; i < configNames.size(); i++)
     {
-        Logger::LogError("No build structures found.");
-        return false;
+        auto configParser = std::make_unique<XMakefileParser>();
+        configParser->ParseFrom(parser);
+        if (!configParser->SetConfig(configNames[i]))
+            return false;
+        extraParsers.push_back(std::move(configParser));
     }
 
-    RebuildScheme rebuildScheme = parser.CheckRebuild();
-
-    if (rebuildScheme == RebuildScheme::None)
+    // Load the configurations of other xmakefiles the selected ones depend on
+    std::unordered_map<std::string, size_t> targetIndices;
+    std::vector<int> visitStates;
+    std::error_code error;
+    std::string canonicalPath = std::filesystem::weakly_canonical(makefileName, error).string();
+    for (XMakefileParser *configParser : GetParsers())
+    {
+        targetIndices[canonicalPath + "|" + configParser->GetCurrentConfig()->Name] = visitStates.size();
+        visitStates.push_back(0);
+        targetDependencies.emplace_back();
+    }
+    for (size_t i = 0; i < extraParsers.size() + 1; i++)
     {
-        std::cout << "No changes in files." << std::endl;
-        return true;
+        if (visitStates[i] == 0 && !AddDependencies(i, targetIndices, visitStates))
+            return false;
     }
 
-    // execute pre-build commands
-    XMakefileConfig config = parser.GetCurrentConfig();
-    if (config.PreBuildCommands.size() > 0)
+    std::vector<XMakefileParser *> parsers = GetParsers();
+    if (parsers.size() > 1)
     {
-        for (const auto &command : config.PreBuildCommands)
+        // Configurations usually scan the same source paths, they do it once
+        auto discoveryCache = std::make_shared<DiscoveryCache>();
+        for (XMakefileParser *configParser : parsers)
         {
-            Logger::LogVerbose("Pre-build command: " + command);
+            configParser->SetDiscoveryCache(discoveryCache);
+        }
 
-            if (!ExecuteCommand(command))
+        // Objects, plan caches and build times of a configuration live in its output directory
+        for (size_t i = 0; i < parsers.size(); i++)
+        {
+            for (size_t j = 0; j < i; j++)
             {
-                Logger::LogError("Pre-build command failed.");
-                return false;
+                if (parsers[i]->GetCurrentConfig()->OutputDir == parsers[j]->GetCurrentConfig()->OutputDir)
+                {
+                    Logger::Error("Configurations {} and {} use the same output directory: {}", parsers[j]->GetCurrentConfig()->Name,
+                                  parsers[i]->GetCurrentConfig()->Name, parsers[i]->GetCurrentConfig()->OutputDir);
+                    return false;
+                }
             }
         }
     }
 
-    // build all source files in parallel
+    for (XMakefileParser *configParser : GetParsers())
+    {
+        configParser->LoadBuildTimes();
+    }
 
-    std::vector<std::thread> threads;
-    std::atomic<int> numberOfBuilds = 0;
-    std::atomic<bool> interruptBuild = false;
+    return true;
+}
 
-    // Determine the number of threads to use for parallel builds
-    unsigned int numThreads = 0;
+bool XMake::Build()
+{
+    // Determine the number of jobs to run at the same time
+    unsigned int numJobs = 0;
     if (cmdLineParser.IsOptionSet("-j"))
     {
         std::string jValue = cmdLineParser.GetOptionValue("-j");
 
-        Logger::LogVerbose("Using -j option with value: " + jValue);
+        Logger::Verbose("Using -j option with value: {}", jValue);
 
         if (!jValue.empty())
         {
             try
             {
-                numThreads = std::stoi(jValue);
+                numJobs = std::stoi(jValue);
             }
             catch (const std::invalid_argument &)
             {
-                Logger::LogWarning("Invalid value for -j option. Using hardware concurrency.");
+                Logger::Warning("Invalid value for -j option. Using hardware concurrency.");
             }
         }
-        if (numThreads == 0)
+    }
+    if (numJobs == 0)
+    {
+        numJobs = std::thread::hardware_concurrency();
+    }
+    if (numJobs == 0) // Fallback if hardware_concurrency is not available
+    {
+        numJobs = 2; // Default to 2 jobs
+    }
+
+    // Number of failed jobs after which the build stops, 0 keeps going through all of them
+    unsigned int failureLimit = 1;
+    if (cmdLineParser.IsOptionSet("-k"))
+    {
+        try
         {
-            numThreads = std::thread::hardware_concurrency();
+            failureLimit = static_cast<unsigned int>(std::stoul(cmdLineParser.GetOptionValue("-k", "0")));
         }
-        if (numThreads == 0) // Fallback if hardware_concurrency is not available
+        catch (const std::exception &)
         {
-            numThreads = 2; // Default to 2 threads
+            Logger::Warning("Invalid value for -k option. Keeping going through all failures.");
+            failureLimit = 0;
         }
     }
-    else
+
+    BuildScheduler scheduler(verbose);
+    scheduler.SetFailureLimit(failureLimit);
+
+    // Under make the job slots come from its jobserver, -j only limits them
+    // further. Otherwise xmake serves a jobserver to the commands it starts,
+    // so a make called by a pre-build command or a compiler using
+    // -flto=jobserver shares the slots of -j instead of adding its own.
+    JobServer &jobServer = scheduler.GetJobServer();
+    const char *makeFlags = std::getenv("MAKEFLAGS");
+    std::optional<std::string> previousMakeFlags;
+    if (makeFlags != nullptr)
+        previousMakeFlags = makeFlags;
+
+    std::string jobServerAuth = JobServer::FindAuth(previousMakeFlags.value_or(""));
+    std::string jobServerStyle = cmdLineParser.IsOptionSet("--jobserver-style") ? cmdLineParser.GetOptionValue("--jobserver-style") : "pipe";
+    if (!jobServerAuth.empty())
     {
-        numThreads = 0;
+        if (jobServer.Connect(jobServerAuth))
+        {
+            Logger::Verbose("Using the jobserver of make: {}", jobServerAuth);
+            if (!cmdLineParser.IsOptionSet("-j"))
+                numJobs = std::numeric_limits<unsigned int>::max();
+        }
+        else
+        {
+            Logger::Warning("The jobserver of make is not available, using -j {}. Mark the make rule that runs xmake as recursive with '+'.", numJobs);
+        }
     }
-
-    if (rebuildScheme == RebuildScheme::Full || rebuildScheme == RebuildScheme::Sources)
+    else if (jobServerStyle != "none")
     {
-        for (const BuildStruct &buildStruct : parser.GetBuildStructures())
+        if (jobServerStyle != "fifo" && jobServerStyle != "pipe")
         {
-            if (interruptBuild)
-                break; // Stop building if interrupted
-
-            if (buildStruct.empty())
-                continue;
-
-            // get directory of the source file
-            std::string sourceDir = buildStruct.objectFile.substr(0, buildStruct.objectFile.find_last_of("/\\"));
-
-            // create the directory if it does not exist
-            if (!std::filesystem::exists(sourceDir))
-            {
-                std::filesystem::create_directories(sourceDir);
-            }
-
-            if (rebuildScheme == RebuildScheme::Sources)
-            {
-                // Check date of the source file and the object file
-                std::filesystem::path sourcePath(buildStruct.sourceFile);
-                std::filesystem::path objectPath(buildStruct.objectFile);
-
-                if (std::filesystem::exists(objectPath) && std::filesystem::last_write_time(sourcePath) <= std::filesystem::last_write_time(objectPath))
-                {
-                    Logger::LogVerbose("Skipping: " + buildStruct.sourceFile + " (up to date)");
-                    continue;
-                }
-            }
-
-            if (verbose)
-                std::cout << "Building: " << buildStruct.buildString << std::endl;
-            else
-                std::cout << "Building: " << buildStruct.objectFile << std::endl;
-
-            threads.emplace_back([this, buildStruct = buildStruct, &numberOfBuilds, rebuildScheme = rebuildScheme, &interruptBuild]() -> bool
-                                 {
-                if (interruptBuild)
-                    return false; // Stop building if interrupted
-
-                // Execute the build command
-                if (!ExecuteCommand(buildStruct.buildString))
-                {
-                    interruptBuild = true; // Set interrupt flag
-                    Logger::LogError(buildStruct.buildString + " failed.");
-                    return false;
-                }
-
-                numberOfBuilds++;
-
-                return true; });
-
-            // TODO This is not efficient, as it waits for all threads to finish before starting new ones
+            Logger::Warning("Invalid value for --jobserver-style option. Using pipe.");
+            jobServerStyle = "pipe";
+        }
 
-            // Limit the number of active threads to numThreads
-            if ((numThreads != 0) && (threads.size() >= numThreads))
-            {
-                for (auto &thread : threads)
-                {
-                    if (thread.joinable())
-                    {
-                        thread.join();
-                    }
-                }
-                threads.clear();
-            }
+        if (jobServer.Create(numJobs, jobServerStyle == "fifo" ? JobServer::Style::Fifo : JobServer::Style::Pipe))
+        {
+            std::string flags = jobServer.GetMakeFlags(numJobs);
+            setenv("MAKEFLAGS", previousMakeFlags ? (*previousMakeFlags + " " + flags).c_str() : flags.c_str(), 1);
+        }
+        else
+        {
+            Logger::Warning("Could not create a jobserver, commands started by the build use their own job limits.");
         }
     }
+    scheduler.SetJobLimit(numJobs);
 
-    // Wait for all remaining threads to finish
-    for (auto &thread : threads)
+    // Every job takes a slot of the budget shared by all xmake processes of the host
+    if (cmdLineParser.IsOptionSet("--host-jobs"))
     {
-        if (thread.joinable())
+        unsigned int hostJobs = 0;
+        unsigned int userJobs = 0;
+        try
         {
-            thread.join();
+            hostJobs = static_cast<unsigned int>(std::stoul(cmdLineParser.GetOptionValue("--host-jobs", "0")));
+            if (cmdLineParser.IsOptionSet("--host-jobs-per-user"))
+                userJobs = static_cast<unsigned int>(std::stoul(cmdLineParser.GetOptionValue("--host-jobs-per-user", "0")));
+        }
+        catch (const std::exception &)
+        {
+            Logger::Warning("Invalid value for --host-jobs or --host-jobs-per-user option. Using no host-wide limit.");
+            hostJobs = 0;
         }
-    }
-
-    if (interruptBuild)
-        return false;
 
-    // After building all source files, link them
-    std::string linkString = parser.GetLinkerString();
+        std::string directory = cmdLineParser.IsOptionSet("--host-jobs-dir") ? cmdLineParser.GetOptionValue("--host-jobs-dir") : HostJobSlots::GetDefaultDirectory();
+        if (hostJobs > 0 && !scheduler.GetHostJobSlots().Open(directory, hostJobs, userJobs))
+            Logger::Warning("Can not use {} for the host-wide job limit, using -j only.", directory);
+        else if (hostJobs > 0)
+            Logger::Verbose("Sharing {} job slots of the host in {}", hostJobs, directory);
+    }
 
-    if (numberOfBuilds == 0)
+    // New jobs wait while the host is overloaded, one job always runs so the build goes on
+    SystemLoadLimits loadLimits;
+    try
     {
-        std::cout << "All files are up to date" << std::endl;
-        return true;
+        if (cmdLineParser.IsOptionSet("--max-load"))
+            loadLimits.MaxLoad = std::stod(cmdLineParser.GetOptionValue("--max-load", "0"));
+        if (cmdLineParser.IsOptionSet("--min-free-memory"))
+            loadLimits.MinAvailableMemory = static_cast<uint64_t>(std::stoull(cmdLineParser.GetOptionValue("--min-free-memory", "0"))) << 20;
     }
-
-    if (verbose)
-        std::cout << "Linking: " << linkString << std::endl;
-    else
-        std::cout << "Linking: " << parser.GetOutputFilename() << std::endl;
-
-    // Execute the linker command
-    if (!ExecuteCommand(linkString))
+    catch (const std::exception &)
     {
-        Logger::LogError("Linking failed.");
-        return false;
+        Logger::Warning("Invalid value for --max-load or --min-free-memory option. Ignoring it.");
     }
+    if (cmdLineParser.IsOptionSet("--max-pressure") && !SystemLoad::ParsePressureLimits(cmdLineParser.GetOptionValue("--max-pressure"), loadLimits))
+    {
+        Logger::Warning("Invalid value for --max-pressure option. Ignoring it.");
+    }
+    scheduler.SetLoadLimits(loadLimits);
 
-    // execute post-build commands
-    if (config.PostBuildCommands.size() > 0)
+    // A job exceeding the memory limit fails instead of pushing the host into swap
+    if (cmdLineParser.IsOptionSet("--job-memory-limit"))
     {
-        for (const auto &command : config.PostBuildCommands)
+        try
         {
-            Logger::LogVerbose("Post-build command: " + command);
-
-            if (!ExecuteCommand(command))
-            {
-                Logger::LogError("Post-build command failed.");
-                return false;
-            }
+            scheduler.SetJobMemoryLimit(static_cast<uint64_t>(std::stoull(cmdLineParser.GetOptionValue("--job-memory-limit", "0"))) << 20);
+        }
+        catch (const std::exception &)
+        {
+            Logger::Warning("Invalid value for --job-memory-limit option. Ignoring it.");
         }
     }
 
-    std::cout << "Finished building target: " << parser.GetOutputFilename() << std::endl;
+    // Every selected configuration and every dependency is a target of its own
+    std::vector<XMakefileParser *> parsers = GetParsers();
+    for (size_t index = 0; index < parsers.size(); index++)
+    {
+        // Configurations of other xmakefiles are named after the directory of their xmakefile
+        std::string name = parsers[index]->GetCurrentConfig()->Name;
+        if (parsers[index]->GetXMakefileDir() != parser.GetXMakefileDir() || parsers[index]->GetXMakefileName() != parser.GetXMakefileName())
+            name = std::filesystem::path(parsers[index]->GetXMakefileDir()).filename().string() + "/" + name;
 
-    if (rebuildScheme == RebuildScheme::Full || rebuildScheme == RebuildScheme::Sources)
-        SaveBuildTimes();
+        scheduler.AddTarget(parsers[index], name, parsers.size() > 1 ? "[" + name + "] " : "", targetDependencies[index]);
+    }
 
-    return true;
+    // Ctrl-C and SIGTERM stop the running compilers, which are in process groups of their own
+    ProcessRunner::ResetCancellation();
+    InstallCancelHandlers();
+
+    bool succeeded = scheduler.Run(buildOrder);
+
+    RestoreCancelHandlers();
+
+    if (previousMakeFlags)
+        setenv("MAKEFLAGS", previousMakeFlags->c_str(), 1);
+    else
+        unsetenv("MAKEFLAGS");
+
+    return succeeded;
 }
 
 void XMake::Clean()
 {
-    std::cout << "Cleaning build files..." << std::endl;
+    Logger::Info("Cleaning build files...");
 
-    // run all the clean_commands
-    XMakefileConfig config = parser.GetCurrentConfig();
-    if (config.CleanCommands.size() > 0)
+    // run all the clean_commands of every selected configuration, dependencies are left alone
+    std::vector<XMakefileParser *> parsers = GetParsers();
+    for (size_t i = 0; i < extraParsers.size() + 1; i++)
     {
-        for (const auto &command : config.CleanCommands)
+        ConfigSnapshot config = parsers[i]->GetCurrentConfig();
+        for (const auto &command : config->CleanCommands)
         {
-            Logger::LogVerbose("Clean command: " + command);
+            Logger::Verbose("Clean command: {}", command);
 
             if (!ExecuteCommand(command))
             {
-                Logger::LogError("Clean command failed.");
+                Logger::Error("Clean command failed.");
                 return;
             }
         }
     }
 
-    std::cout << "Cleaned build files." << std::endl;
+    Logger::Info("Cleaned build files.");
 }
 
 void XMake::Run()
 {
-    XMakefileConfig config = parser.GetCurrentConfig();
-    if (config.PreRunCommands.size() > 0)
+    ConfigSnapshot config = parser.GetCurrentConfig();
+    if (config->PreRunCommands.size() > 0)
     {
-        for (const auto &command : config.PreRunCommands)
+        for (const auto &command : config->PreRunCommands)
         {
-            Logger::LogVerbose("Pre-run command: " + command);
+            Logger::Verbose("Pre-run command: {}", command);
 
             if (!ExecuteCommand(command))
             {
-                Logger::LogError("Pre-run command failed.");
+                Logger::Error("Pre-run command failed.");
                 return;
             }
         }
     }
 
     // Execute the output file
-    std::string runCommand = config.OutputDir + "/" + config.OutputFilename;
+    std::string runCommand = config->OutputDir + "/" + config->OutputFilename;
     if (!ExecuteCommand(runCommand))
     {
-        Logger::LogError("Failed to run the output file.");
+        Logger::Error("Failed to run the output file.");
         return;
     }
 
-    if (config.PostRunCommands.size() > 0)
+    if (config->PostRunCommands.size() > 0)
     {
-        for (const auto &command : config.PostRunCommands)
+        for (const auto &command : config->PostRunCommands)
         {
-            Logger::LogVerbose("Post-run command: " + command);
+            Logger::Verbose("Post-run command: {}", command);
 
             if (!ExecuteCommand(command))
             {
-                Logger::LogError("Post-run command failed.");
+                Logger::Error("Post-run command failed.");
                 return;
             }
         }
@@ -309,56 +389,167 @@ void XMake::Run()
 
 void XMake::Install()
 {
-    std::cout << "Installing..." << std::endl;
+    Logger::Info("Installing...");
 
-    XMakefileConfig config = parser.GetCurrentConfig();
+    ConfigSnapshot config = parser.GetCurrentConfig();
     // run all the install_commands
-    if (config.InstallCommands.size() > 0)
+    if (config->InstallCommands.size() > 0)
     {
-        for (const auto &command : config.InstallCommands)
+        for (const auto &command : config->InstallCommands)
         {
-            Logger::LogVerbose("Install command: " + command);
+            Logger::Verbose("Install command: {}", command);
 
             if (!ExecuteCommand(command))
             {
-                Logger::LogError("Install command failed. Need sudo?");
+                Logger::Error("Install command failed. Need sudo?");
                 return;
             }
         }
     }
 
-    std::cout << "Installed successfully." << std::endl;
+    Logger::Info("Installed successfully.");
 }
 
 void XMake::Uninstall()
 {
-    std::cout << "Uninstalling..." << std::endl;
+    Logger::Info("Uninstalling...");
 
-    XMakefileConfig config = parser.GetCurrentConfig();
+    ConfigSnapshot config = parser.GetCurrentConfig();
 
     // run all the uninstall_commands
-    if (config.UninstallCommands.size() > 0)
+    if (config->UninstallCommands.size() > 0)
     {
-        for (const auto &command : config.UninstallCommands)
+        for (const auto &command : config->UninstallCommands)
         {
-            Logger::LogVerbose("Uninstall command: " + command);
+            Logger::Verbose("Uninstall command: {}", command);
 
             if (!ExecuteCommand(command))
             {
-                Logger::LogError("Uninstall command failed.");
+                Logger::Error("Uninstall command failed.");
                 return;
             }
         }
     }
 
-    std::cout << "Uninstalled successfully." << std::endl;
+    Logger::Info("Uninstalled successfully.");
 }
 
 //**************************************************************
 // Private functions
 //**************************************************************
 
-void XMake::SaveBuildTimes()
+std::vector<XMakefileParser *> XMake::GetParsers()
+{
+    std::vector<XMakefileParser *> parsers{&parser};
+    for (auto &configParser : extraParsers)
+    {
+        parsers.push_back(configParser.get());
+    }
+    for (auto &configParser : dependencyParsers)
+    {
+        parsers.push_back(configParser.get());
+    }
+    return parsers;
+}
+
+bool XMake::AddDependencies(size_t index, std::unordered_map<std::string, size_t> &targetIndices, std::vector<int> &visitStates)
 {
-    parser.SaveBuildTimes();
-}
\ No newline at end of file
+    // Depth first, 1 marks the targets on the current path and 2 those already in the build order
+    visitStates[index] = 1;
+    ConfigSnapshot config = GetParsers()[index]->GetCurrentConfig();
+
+    for (const auto &dependency : config->Dependencies)
+    {
+        std::error_code error;
+        std::string path = std::filesystem::weakly_canonical(dependency.XMakefile, error).string();
+
+        auto dependencyParser = std::make_unique<XMakefileParser>();
+        dependencyParser->SetVerbose(verbose);
+        if (!dependencyParser->Parse(path))
+        {
+            Logger::Error("Could not load dependency of {}: {}", config->Name, dependency.XMakefile);
+            return false;
+        }
+
+        // Without a configuration the one with the same name is used, like Debug for Debug
+        std::string configName = dependency.Config;
+        if (configName.empty())
+        {
+            std::vector<std::string> names = dependencyParser->GetConfigNames();
+            configName = std::find(names.begin(), names.end(), config->Name) != names.end() ? config->Name : names.front();
+        }
+        if (!dependencyParser->SetConfig(configName))
+            return false;
+
+        // Targets reached through several paths are built once
+        std::string key = path + "|" + configName;
+        auto known = targetIndices.find(key);
+        size_t dependencyIndex;
+        if (known == targetIndices.end())
+        {
+            dependencyIndex = visitStates.size();
+            targetIndices[key] = dependencyIndex;
+            visitStates.push_back(0);
+            targetDependencies.emplace_back();
+            dependencyParsers.push_back(std::move(dependencyParser));
+        }
+        else
+        {
+            dependencyIndex = known->second;
+        }
+
+        if (visitStates[dependencyIndex] == 1)
+        {
+            Logger::Error("Dependency cycle: {} depends on {} in {}, which depends on it", config->Name, configName, path);
+            return false;
+        }
+        if (visitStates[dependencyIndex] == 0 && !AddDependencies(dependencyIndex, targetIndices, visitStates))
+            return false;
+
+        targetDependencies[index].push_back(dependencyIndex);
+    }
+
+    visitStates[index] = 2;
+    buildOrder.push_back(index);
+    return true;
+}
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+// Handlers that were active before the build, restored once the compilers are done
+static constexpr int CancelSignals[] = {SIGINT, SIGTERM};
+static struct sigaction previousCancelActions[std::size(CancelSignals)];
+
+static void InstallCancelHandlers()
+{
+    struct sigaction action = {};
+    action.sa_handler = CancelBuildOnSignal;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < std::size(CancelSignals); i++)
+    {
+        sigaction(CancelSignals[i], &action, &previousCancelActions[i]);
+    }
+}
+
+static void RestoreCancelHandlers()
+{
+    for (size_t i = 0; i < std::size(CancelSignals); i++)
+    {
+        sigaction(CancelSignals[i], &previousCancelActions[i], nullptr);
+    }
+}
+
+static void CancelBuildOnSignal(int signal)
+{
+    // The first signal cancels the build, a second one is handled as if the build was not running
+    ProcessRunner::CancelAll();
+
+    for (size_t i = 0; i < std::size(CancelSignals); i++)
+    {
+        if (CancelSignals[i] == signal)
+            sigaction(signal, &previousCancelActions[i], nullptr);
+    }
+}
+
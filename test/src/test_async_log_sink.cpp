@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "AsyncLogSink.h"
+#include "Logger.h"
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Splits the captured output into lines
+static std::vector<std::string> SplitLines(const std::string &text)
+{
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line))
+        lines.push_back(line);
+    return lines;
+}
+
+// Lines keep their order across the streams when both go to the same place
+TEST(AsyncLogSinkTest, StreamsKeepOrder)
+{
+    std::stringstream terminal;
+    {
+        AsyncLogSink sink(terminal, terminal, 64);
+        for (int i = 0; i < 1000; i++)
+            sink.Push("line " + std::to_string(i), i % 3 == 1);
+        sink.Stop();
+    }
+
+    std::vector<std::string> lines = SplitLines(terminal.str());
+    ASSERT_EQ(lines.size(), 1000u);
+    for (int i = 0; i < 1000; i++)
+        EXPECT_EQ(lines[static_cast<size_t>(i)], "line " + std::to_string(i));
+}
+
+// Lines of concurrent producers arrive complete and in per-thread order
+TEST(AsyncLogSinkTest, ConcurrentProducersKeepLinesWhole)
+{
+    std::stringstream out;
+    std::stringstream err;
+    constexpr int Threads = 8;
+    constexpr int LinesPerThread = 2000;
+
+    {
+        AsyncLogSink sink(out, err, 64);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < Threads; t++)
+        {
+            producers.emplace_back([&sink, t]()
+                                   {
+                for (int i = 0; i < LinesPerThread; i++)
+                    sink.Push("thread " + std::to_string(t) + " line " + std::to_string(i) + " payload", false); });
+        }
+        for (auto &producer : producers)
+            producer.join();
+        sink.Stop();
+    }
+
+    std::vector<std::string> lines = SplitLines(out.str());
+    ASSERT_EQ(lines.size(), static_cast<size_t>(Threads * LinesPerThread));
+
+    std::map<int, int> nextLine;
+    for (const auto &line : lines)
+    {
+        int thread = -1;
+        int index = -1;
+        char payload[16] = {};
+        ASSERT_EQ(sscanf(line.c_str(), "thread %d line %d %15s", &thread, &index, payload), 3) << line;
+        EXPECT_STREQ(payload, "payload");
+        EXPECT_EQ(index, nextLine[thread]++);
+    }
+    EXPECT_TRUE(err.str().empty());
+}
+
+// Flush returns only after earlier lines were written
+TEST(AsyncLogSinkTest, FlushWritesPendingLines)
+{
+    std::stringstream out;
+    std::stringstream err;
+    AsyncLogSink sink(out, err);
+
+    sink.Push("first", false);
+    sink.Push("problem", true);
+    sink.Flush();
+
+    EXPECT_EQ(out.str(), "first\n");
+    EXPECT_EQ(err.str(), "problem\n");
+}
+
+// The log file receives every line
+TEST(AsyncLogSinkTest, LogFileSink)
+{
+    std::string logPath = std::filesystem::temp_directory_path().string() + "/xmake_async_log_" +
+                          std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".txt";
+    std::stringstream out;
+    std::stringstream err;
+    {
+        AsyncLogSink sink(out, err, 16, logPath);
+        ASSERT_TRUE(sink.HasLogFile());
+        sink.Push("to stdout", false);
+        sink.Push("to stderr", true);
+    }
+
+    std::ifstream file(logPath);
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_EQ(content.str(), "to stdout\nto stderr\n");
+    std::filesystem::remove(logPath);
+}
+
+// Logger routes through the sink while it is active
+TEST(AsyncLogSinkTest, LoggerAsyncMode)
+{
+    std::stringstream out;
+    std::stringstream err;
+    std::streambuf *oldOut = std::cout.rdbuf(out.rdbuf());
+    std::streambuf *oldErr = std::cerr.rdbuf(err.rdbuf());
+
+    ASSERT_TRUE(Logger::StartAsync());
+    Logger::Info("Building: {}", "main.o");
+    Logger::LogWarning("careful");
+    Logger::Flush();
+    std::string flushedOut = out.str();
+    Logger::StopAsync();
+
+    std::cout.rdbuf(oldOut);
+    std::cerr.rdbuf(oldErr);
+
+    EXPECT_EQ(flushedOut, "Building: main.o\n");
+    EXPECT_EQ(err.str(), "[WARNING] careful\n");
+}
+
+// Lines queued when a terminating signal arrives are still written
+TEST(AsyncLogSinkTest, FlushedOnSignal)
+{
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        close(pipeFds[0]);
+        std::ofstream pipeOut("/dev/fd/" + std::to_string(pipeFds[1]));
+        std::cout.rdbuf(pipeOut.rdbuf());
+
+        Logger::StartAsync();
+        for (int i = 0; i < 1000; i++)
+            Logger::Info("line {}", i);
+        raise(SIGTERM);
+        _exit(0);
+    }
+
+    close(pipeFds[1]);
+    std::string output;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(pipeFds[0], buffer, sizeof(buffer))) > 0)
+        output.append(buffer, static_cast<size_t>(count));
+    close(pipeFds[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFSIGNALED(status));
+    EXPECT_EQ(WTERMSIG(status), SIGTERM);
+
+    std::vector<std::string> lines = SplitLines(output);
+    ASSERT_EQ(lines.size(), 1000u);
+    EXPECT_EQ(lines.back(), "line 999");
+}
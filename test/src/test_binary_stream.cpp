@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "BinaryStream.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+// Values written are read back in order
+TEST(BinaryStreamTest, RoundTrip)
+{
+    BinaryWriter writer;
+    writer.WriteU32(42);
+    writer.WriteU64(0x0123456789ABCDEFull);
+    writer.WriteString("hello");
+    writer.WriteString("");
+
+    BinaryReader reader(writer.GetBuffer());
+    EXPECT_EQ(reader.ReadU32(), 42);
+    EXPECT_EQ(reader.ReadU64(), 0x0123456789ABCDEFull);
+    EXPECT_EQ(reader.ReadString(), "hello");
+    EXPECT_EQ(reader.ReadString(), "");
+    EXPECT_TRUE(reader.IsValid());
+    EXPECT_TRUE(reader.AtEnd());
+}
+
+// Reading past the end marks the reader invalid
+TEST(BinaryStreamTest, TruncatedData)
+{
+    BinaryWriter writer;
+    writer.WriteString("a long string");
+
+    std::string truncated = writer.GetBuffer().substr(0, 6);
+    BinaryReader reader(truncated);
+
+    EXPECT_EQ(reader.ReadString(), "");
+    EXPECT_FALSE(reader.IsValid());
+    EXPECT_EQ(reader.ReadU32(), 0);
+    EXPECT_FALSE(reader.IsValid());
+}
+
+// Empty input is invalid
+TEST(BinaryStreamTest, EmptyData)
+{
+    BinaryReader reader("");
+
+    EXPECT_EQ(reader.ReadU64(), 0);
+    EXPECT_FALSE(reader.IsValid());
+}
+
+// Saving writes the complete buffer to the file
+TEST(BinaryStreamTest, SaveToFile)
+{
+    std::string path = std::filesystem::temp_directory_path().string() + "/xmake_binary_stream_" +
+                       std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+
+    BinaryWriter writer;
+    writer.WriteString("content");
+    ASSERT_TRUE(writer.SaveToFile(path));
+
+    std::ifstream file(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(data, writer.GetBuffer());
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    std::filesystem::remove(path);
+}
+
+// Saving into a missing directory fails
+TEST(BinaryStreamTest, SaveToFileMissingDirectory)
+{
+    BinaryWriter writer;
+    writer.WriteU32(1);
+
+    EXPECT_FALSE(writer.SaveToFile("/nonexistent_directory_xmake/file.bin"));
+}
+
+// Hashes differ for different input and can be chained
+TEST(BinaryStreamTest, HashBytes)
+{
+    EXPECT_EQ(HashBytes("abc"), HashBytes("abc"));
+    EXPECT_NE(HashBytes("abc"), HashBytes("abd"));
+    EXPECT_NE(HashBytes("b", HashBytes("a")), HashBytes("a", HashBytes("b")));
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "CommandTrace.h"
+#include "BinaryStream.h"
+#include "ProcessRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+class CommandTraceTest : public ::testing::Test
+{
+protected:
+    std::string testDir;
+    std::string traceFile;
+
+    CommandTraceTest() : testDir(), traceFile() {}
+
+    void SetUp() override
+    {
+        if (CommandTrace::GetTracerLibrary().empty())
+            GTEST_SKIP() << "libxmaketrace.so is not built";
+
+        testDir = std::filesystem::temp_directory_path().string() + "/xmake_command_trace_" +
+                  std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+        std::filesystem::create_directories(testDir);
+        testDir = std::filesystem::canonical(testDir).string();
+        traceFile = testDir + "/out/custom_commands.trace";
+        std::ofstream(testDir + "/input.txt") << "input\n";
+    }
+
+    void TearDown() override
+    {
+        if (!testDir.empty())
+            std::filesystem::remove_all(testDir);
+    }
+
+    // Runs the command traced, like the build does
+    bool run(CommandTrace &trace, const std::string &name, const std::string &command)
+    {
+        ProcessRunner runner;
+        int exitCode = -1;
+        runner.Start("cd " + testDir + " && " + trace.Begin(name, command), [&exitCode](ProcessResult &result)
+                     { exitCode = result.exitCode; });
+        runner.Wait();
+        trace.Finish(name, command, exitCode == 0);
+        return exitCode == 0;
+    }
+
+    // Rewrites the file after the start of the traced run
+    void touch(const std::string &path)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::ofstream(path) << "changed\n";
+    }
+
+    static bool contains(const std::vector<std::string> &paths, const std::string &path)
+    {
+        return std::find(paths.begin(), paths.end(), path) != paths.end();
+    }
+};
+
+// Reads, writes and probes of the command and its child processes are recorded
+TEST_F(CommandTraceTest, RecordsInputsAndOutputs)
+{
+    CommandTrace trace;
+    trace.Load(traceFile);
+    std::string command = "sh -c 'cat input.txt > output.txt; cp output.txt temp.txt; rm temp.txt'";
+    ASSERT_TRUE(run(trace, "copy", command));
+
+    const auto &inputs = trace.GetInputs("copy");
+    const auto &outputs = trace.GetOutputs("copy");
+    EXPECT_TRUE(contains(inputs, testDir + "/input.txt"));
+    EXPECT_TRUE(contains(outputs, testDir + "/output.txt"));
+    EXPECT_FALSE(contains(inputs, testDir + "/output.txt"));
+    EXPECT_FALSE(contains(outputs, testDir + "/temp.txt"));
+    EXPECT_FALSE(std::filesystem::exists(testDir + "/out/.trace_" + std::to_string(HashBytes("copy")) + ".log"));
+
+    EXPECT_FALSE(trace.IsStale("copy", command));
+    EXPECT_TRUE(trace.IsStale("copy", command + " "));
+    EXPECT_TRUE(trace.IsStale("other", command));
+}
+
+// A changed input, a removed output or a new file at a probed path make the command stale
+TEST_F(CommandTraceTest, StaleAfterChanges)
+{
+    CommandTrace trace;
+    trace.Load(traceFile);
+    std::string command = "sh -c 'test -e override.txt; cat input.txt > output.txt'";
+    ASSERT_TRUE(run(trace, "copy", command));
+    EXPECT_FALSE(trace.IsStale("copy", command));
+
+    touch(testDir + "/input.txt");
+    EXPECT_TRUE(trace.IsStale("copy", command));
+    ASSERT_TRUE(run(trace, "copy", command));
+    EXPECT_FALSE(trace.IsStale("copy", command));
+
+    std::filesystem::remove(testDir + "/output.txt");
+    EXPECT_TRUE(trace.IsStale("copy", command));
+    ASSERT_TRUE(run(trace, "copy", command));
+    EXPECT_FALSE(trace.IsStale("copy", command));
+
+    std::ofstream(testDir + "/override.txt") << "override\n";
+    EXPECT_TRUE(trace.IsStale("copy", command));
+}
+
+// A failed run leaves no record, so the command runs again
+TEST_F(CommandTraceTest, FailedRunIsStale)
+{
+    CommandTrace trace;
+    trace.Load(traceFile);
+    std::string command = "sh -c 'cat input.txt > output.txt'";
+    ASSERT_TRUE(run(trace, "copy", command));
+    EXPECT_FALSE(trace.IsStale("copy", command));
+
+    EXPECT_FALSE(run(trace, "copy", "sh -c 'cat missing.txt > output.txt'"));
+    EXPECT_TRUE(trace.IsStale("copy", command));
+    EXPECT_TRUE(trace.GetOutputs("copy").empty());
+}
+
+// Records survive saving and loading, a corrupt file loads no records
+TEST_F(CommandTraceTest, SaveAndLoad)
+{
+    std::string command = "sh -c 'cat input.txt > output.txt'";
+    {
+        CommandTrace trace;
+        trace.Load(traceFile);
+        ASSERT_TRUE(run(trace, "copy", command));
+        ASSERT_TRUE(trace.Save());
+    }
+
+    CommandTrace loaded;
+    loaded.Load(traceFile);
+    EXPECT_FALSE(loaded.IsStale("copy", command));
+    EXPECT_TRUE(contains(loaded.GetInputs("copy"), testDir + "/input.txt"));
+
+    std::filesystem::resize_file(traceFile, std::filesystem::file_size(traceFile) - 1);
+    CommandTrace truncated;
+    truncated.Load(traceFile);
+    EXPECT_TRUE(truncated.IsStale("copy", command));
+}
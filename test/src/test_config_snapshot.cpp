@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "XMakefileParser.h"
+#include "Logger.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+// Counts every allocation of the test binary, only differences are checked
+static std::atomic<size_t> allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    if (void *memory = std::malloc(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Test fixture for the shared configuration snapshot
+class ConfigSnapshotTest : public ::testing::Test
+{
+protected:
+    std::string testDir;
+    std::string xmakefilePath;
+    std::stringstream coutBuffer;
+    std::stringstream cerrBuffer;
+    std::streambuf *oldCoutBuffer;
+    std::streambuf *oldCerrBuffer;
+
+    ConfigSnapshotTest() : testDir(), xmakefilePath(), coutBuffer(), cerrBuffer(), oldCoutBuffer(nullptr), oldCerrBuffer(nullptr) {}
+
+    // Delete copy constructor and assignment operator (test fixtures should not be copied)
+    ConfigSnapshotTest(const ConfigSnapshotTest&) = delete;
+    ConfigSnapshotTest& operator=(const ConfigSnapshotTest&) = delete;
+
+    void SetUp() override
+    {
+        oldCoutBuffer = std::cout.rdbuf(coutBuffer.rdbuf());
+        oldCerrBuffer = std::cerr.rdbuf(cerrBuffer.rdbuf());
+        Logger::SetVerbose(false);
+
+        testDir = std::filesystem::temp_directory_path().string() + "/xmake_snapshot_test_" +
+                  std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+        std::filesystem::create_directories(testDir);
+        xmakefilePath = testDir + "/xmakefile.json";
+
+        std::ofstream file(xmakefilePath);
+        file << R"({
+            "configurations": [
+                {
+                    "name": "Debug",
+                    "build_type": "Executable",
+                    "build_dir": ".build",
+                    "output_filename": "app_debug",
+                    "compiler": "g++",
+                    "linker": "g++",
+                    "include_paths": ["include"],
+                    "source_paths": ["src"],
+                    "clean_commands": ["rm -rf ${build_dir}"]
+                },
+                {
+                    "name": "Release",
+                    "build_type": "Executable",
+                    "build_dir": ".build",
+                    "output_filename": "app_release",
+                    "compiler": "g++",
+                    "linker": "g++"
+                }
+            ]
+        })";
+    }
+
+    void TearDown() override
+    {
+        std::cout.rdbuf(oldCoutBuffer);
+        std::cerr.rdbuf(oldCerrBuffer);
+
+        if (std::filesystem::exists(testDir))
+        {
+            std::filesystem::remove_all(testDir);
+        }
+    }
+};
+
+// Handing out the current configuration does not copy it
+TEST_F(ConfigSnapshotTest, GetCurrentConfigDoesNotAllocate)
+{
+    XMakefileParser parser;
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+
+    size_t commands = 0;
+    size_t before = allocationCount.load();
+    for (int i = 0; i < 1000; i++)
+    {
+        ConfigSnapshot config = parser.GetCurrentConfig();
+        commands += config->CleanCommands.size();
+    }
+    size_t allocations = allocationCount.load() - before;
+
+    EXPECT_EQ(commands, 1000);
+    EXPECT_EQ(allocations, 0);
+}
+
+// All consumers share the same snapshot
+TEST_F(ConfigSnapshotTest, ConsumersShareSnapshot)
+{
+    XMakefileParser parser;
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+
+    ConfigSnapshot first = parser.GetCurrentConfig();
+    ConfigSnapshot second = parser.GetCurrentConfig();
+    EXPECT_EQ(first.get(), second.get());
+
+    // Switching back to a configuration reuses its snapshot
+    ASSERT_TRUE(parser.SetConfig("Release"));
+    EXPECT_NE(parser.GetCurrentConfig().get(), first.get());
+    ASSERT_TRUE(parser.SetConfig("Debug"));
+    EXPECT_EQ(parser.GetCurrentConfig().get(), first.get());
+}
+
+// A snapshot stays valid after the parser moved on
+TEST_F(ConfigSnapshotTest, SnapshotOutlivesReparse)
+{
+    XMakefileParser parser;
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+    ConfigSnapshot debug = parser.GetCurrentConfig();
+
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+    ASSERT_TRUE(parser.SetConfig("Release"));
+
+    EXPECT_EQ(debug->Name, "Debug");
+    EXPECT_EQ(debug->OutputFilename, "app_debug");
+    EXPECT_EQ(parser.GetCurrentConfig()->Name, "Release");
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "HostJobSlots.h"
+#include <chrono>
+#include <filesystem>
+
+class HostJobSlotsTest : public ::testing::Test
+{
+protected:
+    std::string testDir;
+
+    HostJobSlotsTest() : testDir() {}
+
+    void SetUp() override
+    {
+        testDir = std::filesystem::temp_directory_path().string() + "/xmake_host_job_slots_" +
+                  std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(testDir);
+    }
+};
+
+// The processes of a host share the slots, a slot given back can be taken by another one
+TEST_F(HostJobSlotsTest, SlotsAreSharedByAllInstances)
+{
+    HostJobSlots first;
+    HostJobSlots second;
+    ASSERT_TRUE(first.Open(testDir + "/locks", 2, 0));
+    ASSERT_TRUE(second.Open(testDir + "/locks", 2, 0));
+
+    EXPECT_TRUE(first.TryAcquire());
+    EXPECT_TRUE(second.TryAcquire());
+    EXPECT_FALSE(first.TryAcquire());
+    EXPECT_FALSE(second.TryAcquire());
+    EXPECT_EQ(first.GetHeldSlots(), 1u);
+
+    first.Release();
+    EXPECT_TRUE(second.TryAcquire());
+    EXPECT_EQ(second.GetHeldSlots(), 2u);
+    EXPECT_FALSE(first.TryAcquire());
+}
+
+// The share of a user limits its processes while host slots are still free
+TEST_F(HostJobSlotsTest, UserShareLimitsSlots)
+{
+    HostJobSlots first;
+    HostJobSlots second;
+    ASSERT_TRUE(first.Open(testDir, 4, 1));
+    ASSERT_TRUE(second.Open(testDir, 4, 1));
+
+    EXPECT_TRUE(first.TryAcquire());
+    EXPECT_FALSE(first.TryAcquire());
+    EXPECT_FALSE(second.TryAcquire());
+
+    first.Release();
+    EXPECT_TRUE(second.TryAcquire());
+}
+
+// Slots are given back when their holder goes away
+TEST_F(HostJobSlotsTest, DestructionReleasesSlots)
+{
+    HostJobSlots slots;
+    ASSERT_TRUE(slots.Open(testDir, 1, 0));
+    {
+        HostJobSlots holder;
+        ASSERT_TRUE(holder.Open(testDir, 1, 0));
+        ASSERT_TRUE(holder.TryAcquire());
+        EXPECT_FALSE(slots.TryAcquire());
+    }
+    EXPECT_TRUE(slots.TryAcquire());
+}
+
+// Without a usable directory or slots there is no host-wide limit
+TEST_F(HostJobSlotsTest, OpenFailsForUnusableDirectory)
+{
+    HostJobSlots slots;
+    EXPECT_FALSE(slots.Open("/proc/xmake_host_job_slots", 4, 0));
+    EXPECT_FALSE(slots.IsActive());
+    EXPECT_FALSE(slots.TryAcquire());
+    EXPECT_FALSE(slots.Open(testDir, 0, 0));
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "JobServer.h"
+#include <filesystem>
+
+// The last jobserver option wins, command line variables after "--" are ignored
+TEST(JobServerTest, FindAuth)
+{
+    EXPECT_EQ(JobServer::FindAuth(""), "");
+    EXPECT_EQ(JobServer::FindAuth("-k -j4"), "");
+    EXPECT_EQ(JobServer::FindAuth(" -j4 --jobserver-auth=fifo:/tmp/GMfifo1"), "fifo:/tmp/GMfifo1");
+    EXPECT_EQ(JobServer::FindAuth("-j4 --jobserver-fds=3,4"), "3,4");
+    EXPECT_EQ(JobServer::FindAuth("-j4 --jobserver-auth=3,4 -j2 --jobserver-auth=fifo:/tmp/GMfifo2"), "fifo:/tmp/GMfifo2");
+    EXPECT_EQ(JobServer::FindAuth("-j4 -- --jobserver-auth=3,4"), "");
+}
+
+// A jobserver for N jobs holds N - 1 tokens, the first job needs none
+TEST(JobServerTest, CreateHoldsTokensForAllButOneJob)
+{
+    for (JobServer::Style style : {JobServer::Style::Fifo, JobServer::Style::Pipe})
+    {
+        JobServer server;
+        ASSERT_TRUE(server.Create(3, style));
+        EXPECT_TRUE(server.IsActive());
+
+        EXPECT_TRUE(server.TryAcquire());
+        EXPECT_TRUE(server.TryAcquire());
+        EXPECT_FALSE(server.TryAcquire());
+        EXPECT_EQ(server.GetHeldTokens(), 2u);
+
+        server.Release();
+        EXPECT_EQ(server.GetHeldTokens(), 1u);
+        EXPECT_TRUE(server.TryAcquire());
+        EXPECT_FALSE(server.TryAcquire());
+    }
+}
+
+// A client shares the tokens of the server, tokens it holds are given back on destruction
+TEST(JobServerTest, ClientSharesTokens)
+{
+    for (JobServer::Style style : {JobServer::Style::Fifo, JobServer::Style::Pipe})
+    {
+        JobServer server;
+        ASSERT_TRUE(server.Create(3, style));
+        std::string auth = JobServer::FindAuth(server.GetMakeFlags(3));
+        ASSERT_FALSE(auth.empty());
+        {
+            JobServer client;
+            ASSERT_TRUE(client.Connect(auth));
+            EXPECT_TRUE(client.TryAcquire());
+            EXPECT_TRUE(server.TryAcquire());
+            EXPECT_FALSE(client.TryAcquire());
+        }
+
+        EXPECT_TRUE(server.TryAcquire());
+        EXPECT_FALSE(server.TryAcquire());
+    }
+}
+
+// Closed descriptors and missing fifos are no jobserver
+TEST(JobServerTest, ConnectFailsForUnavailableJobServer)
+{
+    JobServer client;
+    EXPECT_FALSE(client.Connect("fifo:/nonexistent/xmake_jobserver"));
+    EXPECT_FALSE(client.Connect("1000,1001"));
+    EXPECT_FALSE(client.Connect("invalid"));
+    EXPECT_FALSE(client.IsActive());
+    EXPECT_FALSE(client.TryAcquire());
+}
+
+// The fifo of a jobserver is removed with it
+TEST(JobServerTest, FifoIsRemovedOnDestruction)
+{
+    std::string path;
+    {
+        JobServer server;
+        ASSERT_TRUE(server.Create(2, JobServer::Style::Fifo));
+        std::string auth = JobServer::FindAuth(server.GetMakeFlags(2));
+        ASSERT_TRUE(auth.starts_with("fifo:"));
+        path = auth.substr(5);
+        EXPECT_TRUE(std::filesystem::exists(path));
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
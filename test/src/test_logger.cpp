@@ -2,6 +2,31 @@
 #include "Logger.h"
 #include <sstream>
 #include <iostream>
+#include <string_view>
+
+// Counts how often it is formatted, to check that disabled levels skip formatting
+struct FormatCounter
+{
+    static inline int count = 0;
+};
+
+std::ostream &operator<<(std::ostream &stream, const FormatCounter &)
+{
+    FormatCounter::count++;
+    return stream << "counted";
+}
+
+#if defined(__cpp_lib_format)
+template <>
+struct std::formatter<FormatCounter> : std::formatter<std::string_view>
+{
+    auto format(const FormatCounter &, std::format_context &context) const
+    {
+        FormatCounter::count++;
+        return std::formatter<std::string_view>::format("counted", context);
+    }
+};
+#endif
 
 // Test fixture for Logger tests
 class LoggerTest : public ::testing::Test
@@ -330,4 +355,55 @@ TEST_F(LoggerTest, DirectLogMethodAllLevels)
 
     EXPECT_EQ(getCoutOutput(), "Verbose\nInfo\n");
     EXPECT_EQ(getCerrOutput(), "[WARNING] Warning\n[ERROR] Error\n");
-}
\ No newline at end of file
+}
+
+// Test the std::format style API
+TEST_F(LoggerTest, VerboseFormatsMessage)
+{
+    Logger::SetVerbose(true);
+    Logger::Verbose("Skipping: {} ({} files)", std::string_view("main.cpp"), 3);
+    EXPECT_EQ(getCoutOutput(), "Skipping: main.cpp (3 files)\n");
+}
+
+TEST_F(LoggerTest, VerboseNotFormattedWhenDisabled)
+{
+    FormatCounter::count = 0;
+
+    Logger::SetVerbose(false);
+    Logger::Verbose("Value: {}", FormatCounter());
+    EXPECT_EQ(FormatCounter::count, 0);
+    EXPECT_EQ(getCoutOutput(), "");
+
+    Logger::SetVerbose(true);
+    Logger::Verbose("Value: {}", FormatCounter());
+    EXPECT_EQ(FormatCounter::count, 1);
+    EXPECT_EQ(getCoutOutput(), "Value: counted\n");
+}
+
+TEST_F(LoggerTest, FormattedLevels)
+{
+    Logger::Info("Info {}", 1);
+    Logger::Warning("Warning {}", 2);
+    Logger::Error("Error {}", std::string("three"));
+
+    EXPECT_EQ(getCoutOutput(), "Info 1\n");
+    EXPECT_EQ(getCerrOutput(), "[WARNING] Warning 2\n[ERROR] Error three\n");
+}
+
+TEST_F(LoggerTest, FormatEscapedBraces)
+{
+    EXPECT_EQ(Logger::Format("{{}} {} {{{}}}", 1, "two"), "{} 1 {two}");
+    EXPECT_EQ(Logger::Format("no arguments"), "no arguments");
+}
+
+// Verbose logging is compiled in unless NDEBUG or XMAKE_LOG_MIN_LEVEL says otherwise
+TEST_F(LoggerTest, MinLogLevel)
+{
+#ifdef NDEBUG
+    EXPECT_EQ(Logger::MinLogLevel, Logger::LogLevel::INFO);
+#else
+    EXPECT_EQ(Logger::MinLogLevel, Logger::LogLevel::VERBOSE);
+    Logger::SetVerbose(true);
+    EXPECT_TRUE(Logger::IsVerbose());
+#endif
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "PathTable.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+// Interning the same path twice returns the same id
+TEST(PathTableTest, InternSamePathReturnsSameId)
+{
+    PathTable table;
+
+    PathId first = table.Intern("/project/src/main.cpp");
+    PathId second = table.Intern(std::string("/project/src/main.cpp"));
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(table.Size(), 1);
+}
+
+// Different paths get different ids
+TEST(PathTableTest, InternDifferentPaths)
+{
+    PathTable table;
+
+    PathId first = table.Intern("/project/src/main.cpp");
+    PathId second = table.Intern("/project/src/helper.cpp");
+
+    EXPECT_NE(first, second);
+    EXPECT_EQ(table.Get(first), "/project/src/main.cpp");
+    EXPECT_EQ(table.Get(second), "/project/src/helper.cpp");
+}
+
+// Find does not add paths
+TEST(PathTableTest, FindUnknownPath)
+{
+    PathTable table;
+
+    EXPECT_EQ(table.Find("/unknown"), InvalidPathId);
+    EXPECT_EQ(table.Size(), 0);
+
+    PathId id = table.Intern("/known");
+    EXPECT_EQ(table.Find("/known"), id);
+}
+
+// Get with an invalid id returns an empty view
+TEST(PathTableTest, GetInvalidId)
+{
+    PathTable table;
+
+    EXPECT_TRUE(table.Get(InvalidPathId).empty());
+    EXPECT_TRUE(table.Get(42).empty());
+}
+
+// Empty paths can be interned
+TEST(PathTableTest, InternEmptyPath)
+{
+    PathTable table;
+
+    PathId id = table.Intern("");
+    EXPECT_EQ(table.Intern(""), id);
+    EXPECT_TRUE(table.Get(id).empty());
+}
+
+// Views stay valid while the arena grows
+TEST(PathTableTest, ViewsStayValidWhenArenaGrows)
+{
+    PathTable table;
+
+    PathId first = table.Intern("/project/first.cpp");
+    std::string_view firstView = table.Get(first);
+
+    for (int i = 0; i < 20000; i++)
+    {
+        table.Intern("/project/src/module_" + std::to_string(i) + "/file.cpp");
+    }
+
+    EXPECT_EQ(firstView, "/project/first.cpp");
+    EXPECT_EQ(table.Get(first).data(), firstView.data());
+}
+
+// Paths larger than an arena block are stored as well
+TEST(PathTableTest, VeryLongPath)
+{
+    PathTable table;
+
+    table.Intern("/short");
+    std::string longPath(100000, 'a');
+    PathId id = table.Intern(longPath);
+    PathId after = table.Intern("/after");
+
+    EXPECT_EQ(table.Get(id), longPath);
+    EXPECT_EQ(table.Get(after), "/after");
+}
+
+// Concurrent interning yields one id per path
+TEST(PathTableTest, ConcurrentIntern)
+{
+    PathTable table;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<PathId>> results(4);
+
+    for (size_t t = 0; t < results.size(); t++)
+    {
+        threads.emplace_back([&table, &results, t]()
+                             {
+            for (int i = 0; i < 1000; i++)
+            {
+                results[t].push_back(table.Intern("/path/" + std::to_string(i)));
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(table.Size(), 1000);
+    for (size_t t = 1; t < results.size(); t++)
+    {
+        EXPECT_EQ(results[t], results[0]);
+    }
+}
+
+// The process wide instance is shared
+TEST(PathTableTest, InstanceIsShared)
+{
+    PathId id = PathTable::Instance().Intern("/shared/path.cpp");
+    EXPECT_EQ(PathTable::Instance().Find("/shared/path.cpp"), id);
+}
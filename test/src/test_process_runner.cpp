@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include "ProcessRunner.h"
+#include "SecurityHelper.h"
+#include "Logger.h"
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Runs a single command on a runner of its own and waits for it
+static ProcessResult RunCommand(const std::string &command)
+{
+    ProcessRunner runner;
+    ProcessResult finished;
+    runner.Start(command, [&finished](ProcessResult &result)
+                 { finished = std::move(result); });
+    runner.Wait();
+    return finished;
+}
+
+// Output of both streams is captured
+TEST(ProcessRunnerTest, CapturesStdoutAndStderr)
+{
+    ProcessResult result = RunCommand("echo to-stdout; echo to-stderr 1>&2");
+
+    EXPECT_TRUE(result.started);
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_NE(result.output.find("to-stdout\n"), std::string::npos);
+    EXPECT_NE(result.output.find("to-stderr\n"), std::string::npos);
+}
+
+// A process left running in the background with the pipes open does not hold up the command
+TEST(ProcessRunnerTest, BackgroundProcessDoesNotBlockFinish)
+{
+    auto start = std::chrono::steady_clock::now();
+    ProcessResult result = RunCommand("sleep 30 & echo $!; echo done");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    std::istringstream output(result.output);
+    pid_t background = 0;
+    std::string done;
+    output >> background >> done;
+    if (background > 0)
+        kill(background, SIGKILL);
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_EQ(done, "done");
+}
+
+// Exit codes and signals are reported
+TEST(ProcessRunnerTest, ReportsExitCode)
+{
+    EXPECT_EQ(RunCommand("exit 3").exitCode, 3);
+    EXPECT_EQ(RunCommand("kill -TERM $$").exitCode, 128 + 15);
+    EXPECT_EQ(RunCommand("command_that_does_not_exist_xmake").exitCode, 127);
+}
+
+// Output larger than a pipe buffer on both streams does not block the command
+TEST(ProcessRunnerTest, LargeOutputOnBothStreams)
+{
+    ProcessResult result = RunCommand("head -c 1000000 /dev/zero; head -c 1000000 /dev/zero 1>&2");
+
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_EQ(result.output.size(), 2000000u);
+}
+
+// The command does not inherit the terminal as input
+TEST(ProcessRunnerTest, StdinIsEmpty)
+{
+    ProcessResult result = RunCommand("cat");
+
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_TRUE(result.output.empty());
+}
+
+// Parallel commands keep their output apart
+TEST(ProcessRunnerTest, ParallelCommandsKeepOutputApart)
+{
+    std::vector<ProcessResult> results(16);
+    ProcessRunner runner;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        runner.Start("for n in 1 2 3; do echo job" + std::to_string(i) + " $n; done", [&results, i](ProcessResult &result)
+                     { results[i] = std::move(result); });
+    }
+    runner.Wait();
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        std::string job = "job" + std::to_string(i);
+        EXPECT_EQ(results[i].output, job + " 1\n" + job + " 2\n" + job + " 3\n");
+    }
+}
+
+// The captured variant applies the same validation as ExecuteCommand
+TEST(ProcessRunnerTest, CapturedCommandIsValidated)
+{
+    std::stringstream err;
+    std::streambuf *oldErr = std::cerr.rdbuf(err.rdbuf());
+
+    ProcessRunner runner;
+    std::vector<ProcessResult> results;
+    auto onExit = [&results](ProcessResult &result)
+    { results.push_back(std::move(result)); };
+    EXPECT_FALSE(StartCommandCaptured(runner, "echo a; echo b", onExit));
+    EXPECT_TRUE(StartCommandCaptured(runner, "echo captured", onExit));
+    runner.Wait();
+
+    std::cerr.rdbuf(oldErr);
+    EXPECT_NE(err.str().find("Invalid character ';'"), std::string::npos);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].exitCode, 0);
+    EXPECT_EQ(results[0].output, "captured\n");
+}
+
+// Captured output is written as one block without a prefix
+TEST(ProcessRunnerTest, LogOutputWritesBlock)
+{
+    std::stringstream err;
+    std::streambuf *oldErr = std::cerr.rdbuf(err.rdbuf());
+
+    Logger::LogOutput("main.cpp:1: warning: first\nmain.cpp:2: warning: second\n");
+    Logger::LogOutput("");
+
+    std::cerr.rdbuf(oldErr);
+    EXPECT_EQ(err.str(), "main.cpp:1: warning: first\nmain.cpp:2: warning: second\n");
+}
+
+// Cancellation terminates the whole process group of a running command
+TEST(ProcessRunnerTest, CancelAllStopsRunningCommands)
+{
+    ProcessRunner::ResetCancellation();
+    auto start = std::chrono::steady_clock::now();
+
+    ProcessResult result;
+    std::thread runner([&result]()
+                       { result = RunCommand("sleep 30 & sleep 30; wait"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ProcessRunner::CancelAll();
+    runner.join();
+
+    EXPECT_TRUE(result.started);
+    EXPECT_TRUE(result.cancelled);
+    EXPECT_EQ(result.exitCode, 128 + 15);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    // Nothing starts until the cancellation is reset
+    ProcessResult skipped = RunCommand("echo skipped");
+    EXPECT_FALSE(skipped.started);
+    EXPECT_TRUE(skipped.cancelled);
+
+    ProcessRunner::ResetCancellation();
+    EXPECT_EQ(RunCommand("echo again").output, "again\n");
+}
+
+// A command that ignores SIGTERM is killed after the grace period
+TEST(ProcessRunnerTest, CancelKillsCommandIgnoringTerm)
+{
+    ProcessRunner::ResetCancellation();
+
+    ProcessResult result;
+    std::thread runner([&result]()
+                       { result = RunCommand("trap '' TERM; sleep 30"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ProcessRunner::CancelAll();
+    runner.join();
+    ProcessRunner::ResetCancellation();
+
+    EXPECT_TRUE(result.cancelled);
+    EXPECT_EQ(result.exitCode, 128 + 9);
+}
+
+// Counts the threads of this process
+static size_t CountThreads()
+{
+    size_t threads = 0;
+    for ([[maybe_unused]] const auto &entry : std::filesystem::directory_iterator("/proc/self/task"))
+        threads++;
+    return threads;
+}
+
+// Hundreds of commands run at the same time on a single reactor thread
+TEST(ProcessRunnerTest, ManyCommandsShareOneReactor)
+{
+    ProcessRunner::ResetCancellation();
+    constexpr int Commands = 256;
+
+    std::atomic<int> finished = 0;
+    std::atomic<int> failed = 0;
+    size_t threadsBefore = CountThreads();
+    size_t threadsWhileRunning = 0;
+    {
+        ProcessRunner runner;
+        for (int i = 0; i < Commands; i++)
+        {
+            runner.Start("sleep 0.2; echo " + std::to_string(i), [&finished, &failed, i](ProcessResult &result)
+                         {
+                if (result.exitCode != 0 || result.output != std::to_string(i) + "\n")
+                    failed++;
+                finished++; });
+        }
+        threadsWhileRunning = CountThreads();
+        runner.Wait();
+        EXPECT_EQ(finished.load(), Commands);
+    }
+
+    EXPECT_EQ(failed.load(), 0);
+    EXPECT_LE(threadsWhileRunning, threadsBefore + 1);
+}
+
+// The callback is called also when the command never started
+TEST(ProcessRunnerTest, CallbackForCancelledStart)
+{
+    ProcessRunner runner;
+    ProcessRunner::CancelAll();
+
+    bool called = false;
+    runner.Start("echo never", [&called](ProcessResult &result)
+                 { called = !result.started && result.cancelled; });
+    runner.Wait();
+    ProcessRunner::ResetCancellation();
+
+    EXPECT_TRUE(called);
+}
+
+// Commands run with the memory limit of their runner until it is removed
+TEST(ProcessRunnerTest, MemoryLimitAppliesToCommands)
+{
+    ProcessRunner runner;
+    runner.SetMemoryLimit(uint64_t(256) << 20);
+
+    std::string limit;
+    runner.Start("ulimit -v", [&limit](ProcessResult &result)
+                 { limit = result.output; });
+    runner.Wait();
+    EXPECT_EQ(limit, "262144\n");
+
+    runner.SetMemoryLimit(0);
+    runner.Start("ulimit -v", [&limit](ProcessResult &result)
+                 { limit = result.output; });
+    runner.Wait();
+    EXPECT_NE(limit, "262144\n");
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "StringArena.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Stored strings keep their content
+TEST(StringArenaTest, StoreKeepsContent)
+{
+    StringArena arena;
+
+    std::string_view stored = arena.Store("g++ -c main.cpp");
+
+    EXPECT_EQ(stored, "g++ -c main.cpp");
+}
+
+// Stored strings are null terminated
+TEST(StringArenaTest, StoreIsNullTerminated)
+{
+    StringArena arena;
+
+    std::string_view stored = arena.Store("abc");
+
+    EXPECT_EQ(stored.data()[stored.size()], '\0');
+    EXPECT_EQ(std::strlen(stored.data()), 3);
+}
+
+// Concat joins all parts
+TEST(StringArenaTest, ConcatJoinsParts)
+{
+    StringArena arena;
+
+    std::string_view joined = arena.Concat({"g++ -Wall", " ", "main.cpp", " -c -o ", "main.o"});
+
+    EXPECT_EQ(joined, "g++ -Wall main.cpp -c -o main.o");
+    EXPECT_EQ(joined.data()[joined.size()], '\0');
+}
+
+// Empty strings are supported
+TEST(StringArenaTest, EmptyString)
+{
+    StringArena arena;
+
+    EXPECT_TRUE(arena.Store("").empty());
+    EXPECT_TRUE(arena.Concat({}).empty());
+}
+
+// Views stay valid while new blocks are added
+TEST(StringArenaTest, ViewsStayValidWhenGrowing)
+{
+    StringArena arena;
+    std::vector<std::string_view> views;
+
+    for (int i = 0; i < 10000; i++)
+    {
+        views.push_back(arena.Store("/project/src/file_" + std::to_string(i) + ".cpp"));
+    }
+
+    for (int i = 0; i < 10000; i++)
+    {
+        EXPECT_EQ(views[static_cast<size_t>(i)], "/project/src/file_" + std::to_string(i) + ".cpp");
+    }
+}
+
+// Strings larger than a block are stored
+TEST(StringArenaTest, LargeString)
+{
+    StringArena arena;
+
+    std::string_view small = arena.Store("small");
+    std::string large(200000, 'x');
+    std::string_view largeView = arena.Store(large);
+    std::string_view after = arena.Store("after");
+
+    EXPECT_EQ(small, "small");
+    EXPECT_EQ(largeView, large);
+    EXPECT_EQ(after, "after");
+}
+
+// Clear releases the memory
+TEST(StringArenaTest, Clear)
+{
+    StringArena arena;
+
+    arena.Store("something");
+    EXPECT_GT(arena.MemoryUsage(), 0);
+
+    arena.Clear();
+    EXPECT_EQ(arena.MemoryUsage(), 0);
+
+    EXPECT_EQ(arena.Store("again"), "again");
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "SystemLoad.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+class SystemLoadTest : public ::testing::Test
+{
+protected:
+    std::string procDir;
+
+    SystemLoadTest() : procDir() {}
+
+    void SetUp() override
+    {
+        procDir = std::filesystem::temp_directory_path().string() + "/xmake_system_load_" +
+                  std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+        std::filesystem::create_directories(procDir + "/pressure");
+        write(1.5, 4096, 0.5, 0.0, 1.25);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(procDir);
+    }
+
+    // Writes the files of /proc read by SystemLoad
+    void write(double load, uint64_t availableMiB, double cpu, double memory, double io)
+    {
+        std::ofstream(procDir + "/loadavg") << load << " 1.00 0.50 2/345 6789\n";
+        std::ofstream(procDir + "/meminfo") << "MemTotal:       16384000 kB\n"
+                                            << "MemFree:         1024000 kB\n"
+                                            << "MemAvailable:   " << availableMiB * 1024 << " kB\n";
+        for (const auto &[name, value] : {std::pair{"cpu", cpu}, {"memory", memory}, {"io", io}})
+        {
+            std::ofstream(procDir + "/pressure/" + name) << "some avg10=" << value << " avg60=0.00 avg300=0.00 total=100\n"
+                                                         << "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+        }
+    }
+};
+
+// Without limits nothing is read and nothing is overloaded
+TEST_F(SystemLoadTest, InactiveWithoutLimits)
+{
+    SystemLoad load(SystemLoadLimits(), procDir);
+    EXPECT_FALSE(load.IsActive());
+    EXPECT_FALSE(load.IsOverloaded());
+}
+
+// Every limit holds back jobs once exceeded, and names the exceeded value
+TEST_F(SystemLoadTest, LimitsAreChecked)
+{
+    SystemLoadLimits limits;
+    limits.MaxLoad = 8;
+    limits.MinAvailableMemory = uint64_t(1024) << 20;
+    ASSERT_TRUE(SystemLoad::ParsePressureLimits("cpu=80,memory=10,io=40", limits));
+    SystemLoad load(limits, procDir);
+    EXPECT_TRUE(load.IsActive());
+    EXPECT_FALSE(load.Sample());
+    EXPECT_TRUE(load.GetReason().empty());
+
+    write(9, 4096, 0.5, 0.0, 1.25);
+    EXPECT_TRUE(load.Sample());
+    EXPECT_EQ(load.GetReason(), "load average 9 > 8");
+
+    write(1.5, 512, 0.5, 0.0, 1.25);
+    EXPECT_TRUE(load.Sample());
+    EXPECT_EQ(load.GetReason(), "available memory 512 MiB < 1024 MiB");
+
+    write(1.5, 4096, 0.5, 12.5, 1.25);
+    EXPECT_TRUE(load.Sample());
+    EXPECT_EQ(load.GetReason(), "memory pressure 12.5% > 10%");
+
+    write(1.5, 4096, 0.5, 0.0, 45);
+    EXPECT_TRUE(load.Sample());
+    EXPECT_EQ(load.GetReason(), "io pressure 45% > 40%");
+
+    write(1.5, 4096, 95, 0.0, 1.25);
+    EXPECT_TRUE(load.Sample());
+    EXPECT_EQ(load.GetReason(), "cpu pressure 95% > 80%");
+}
+
+// Values the kernel does not provide are not checked
+TEST_F(SystemLoadTest, MissingFilesAreIgnored)
+{
+    std::filesystem::remove_all(procDir + "/pressure");
+    SystemLoadLimits limits;
+    ASSERT_TRUE(SystemLoad::ParsePressureLimits("1", limits));
+    SystemLoad load(limits, procDir);
+    EXPECT_FALSE(load.Sample());
+}
+
+// The sample is kept for a while, reading /proc for every job start would be wasted
+TEST_F(SystemLoadTest, IsOverloadedReusesRecentSample)
+{
+    SystemLoadLimits limits;
+    limits.MaxLoad = 8;
+    SystemLoad load(limits, procDir);
+    EXPECT_FALSE(load.IsOverloaded());
+
+    write(9, 4096, 0.5, 0.0, 1.25);
+    EXPECT_FALSE(load.IsOverloaded());
+    EXPECT_TRUE(load.Sample());
+    EXPECT_TRUE(load.IsOverloaded());
+}
+
+// --max-pressure takes one percentage for all resources or one per resource
+TEST(SystemLoadParseTest, ParsePressureLimits)
+{
+    SystemLoadLimits limits;
+    ASSERT_TRUE(SystemLoad::ParsePressureLimits("25", limits));
+    EXPECT_DOUBLE_EQ(limits.MaxCpuPressure, 25);
+    EXPECT_DOUBLE_EQ(limits.MaxMemoryPressure, 25);
+    EXPECT_DOUBLE_EQ(limits.MaxIoPressure, 25);
+
+    ASSERT_TRUE(SystemLoad::ParsePressureLimits("memory=5.5,io=40", limits));
+    EXPECT_DOUBLE_EQ(limits.MaxCpuPressure, 25);
+    EXPECT_DOUBLE_EQ(limits.MaxMemoryPressure, 5.5);
+    EXPECT_DOUBLE_EQ(limits.MaxIoPressure, 40);
+
+    EXPECT_FALSE(SystemLoad::ParsePressureLimits("disk=5", limits));
+    EXPECT_FALSE(SystemLoad::ParsePressureLimits("memory=", limits));
+    EXPECT_FALSE(SystemLoad::ParsePressureLimits("ten", limits));
+    EXPECT_FALSE(SystemLoad::ParsePressureLimits("-1", limits));
+    EXPECT_DOUBLE_EQ(limits.MaxMemoryPressure, 5.5);
+}
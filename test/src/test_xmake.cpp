@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 #include "xmake.h"
+#include "CommandTrace.h"
+#include "HostJobSlots.h"
+#include "JobServer.h"
 #include "Logger.h"
 #include <CmdLineParser.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -154,8 +158,18 @@ protected:
         
         CmdLineParser parser("xmake", "test build tool", "1.0.0");
         parser.RegisterOption("-c", "Configuration", true);
+        parser.RegisterOption("--all-configs", "All configurations");
         parser.RegisterOption("-v", "Verbose");
         parser.RegisterOption("-j", "Jobs", true);
+        parser.RegisterOption("-k", "Keep going", true);
+        parser.RegisterOption("--jobserver-style", "Jobserver style", true);
+        parser.RegisterOption("--host-jobs", "Host jobs", true);
+        parser.RegisterOption("--host-jobs-per-user", "Host jobs per user", true);
+        parser.RegisterOption("--host-jobs-dir", "Host jobs directory", true);
+        parser.RegisterOption("--max-load", "Max load", true);
+        parser.RegisterOption("--max-pressure", "Max pressure", true);
+        parser.RegisterOption("--min-free-memory", "Min free memory", true);
+        parser.RegisterOption("--job-memory-limit", "Job memory limit", true);
         parser.RegisterOption("clean", "Clean");
         parser.RegisterOption("run", "Run");
         parser.RegisterOption("install", "Install");
@@ -272,6 +286,28 @@ TEST_F(XMakeTest, BuildWithNoSourceFiles)
     EXPECT_TRUE(errorOutput.find("No build structures found") != std::string::npos);
 }
 
+// Test Build fails if the source list file is missing, instead of building the listed sources only
+TEST_F(XMakeTest, BuildFailsWithoutSourceListFile)
+{
+    createBasicXMakefile();
+    std::ifstream in(xmakefilePath);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    size_t pos = content.find("\"source_paths\": [\"src\"],");
+    ASSERT_NE(pos, std::string::npos);
+    content.insert(pos, "\"sources\": [\"src/main.cpp\"], \"source_list_file\": \"sources.txt\", ");
+    std::ofstream(xmakefilePath) << content;
+    createSourceFile("main.cpp");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+
+    EXPECT_FALSE(xmake.Build());
+    EXPECT_TRUE(getCerrOutput().find("Could not open source list file") != std::string::npos);
+    EXPECT_FALSE(std::filesystem::exists(testDir + "/.build/Debug/src/main.o"));
+}
+
 // Test Build with single source file
 TEST_F(XMakeTest, BuildWithSingleSourceFile)
 {
@@ -286,11 +322,476 @@ TEST_F(XMakeTest, BuildWithSingleSourceFile)
     
     EXPECT_TRUE(result);
     std::string output = getCoutOutput();
-    // Pre-build and Post-build echo commands output directly, not captured by our buffer
-    // Just verify the important build messages are present
     EXPECT_TRUE(output.find("Building:") != std::string::npos);
     EXPECT_TRUE(output.find("Linking:") != std::string::npos);
     EXPECT_TRUE(output.find("Finished building target:") != std::string::npos);
+
+    // Pre- and post-build commands run on the runner, their output is captured like the one of the other jobs
+    std::string errorOutput = getCerrOutput();
+    EXPECT_NE(errorOutput.find("Pre-build\n"), std::string::npos);
+    EXPECT_NE(errorOutput.find("Post-build\n"), std::string::npos);
+}
+
+// Compiler output is printed in one piece and kept next to the object file
+TEST_F(XMakeTest, BuildCapturesCompilerOutput)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp", "int main() { int unusedVariable; return 0; }");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+
+    EXPECT_TRUE(xmake.Build());
+    EXPECT_NE(getCerrOutput().find("unusedVariable"), std::string::npos);
+
+    std::vector<std::filesystem::path> logs;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(testDir))
+    {
+        if (entry.path().filename() == "main.o.log")
+            logs.push_back(entry.path());
+    }
+    ASSERT_EQ(logs.size(), 1u);
+
+    std::ifstream log(logs[0]);
+    std::stringstream content;
+    content << log.rdbuf();
+    EXPECT_NE(content.str().find("unusedVariable"), std::string::npos);
+    EXPECT_EQ(content.str().find('\x1b'), std::string::npos);
+
+    // A clean rebuild removes the stale log
+    createSourceFile("main.cpp", "int main() { return 0; }");
+    std::filesystem::last_write_time(testDir + "/src/main.cpp", std::filesystem::file_time_type::clock::now() + std::chrono::seconds(2));
+    EXPECT_TRUE(xmake.Build());
+    EXPECT_FALSE(std::filesystem::exists(logs[0]));
+}
+
+// The diagnostics of a failing job come before the failure message
+TEST_F(XMakeTest, BuildFailurePrintsDiagnosticsFirst)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp", "int main() { return undeclaredName; }");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+
+    EXPECT_FALSE(xmake.Build());
+    std::string errorOutput = getCerrOutput();
+    size_t diagnostic = errorOutput.find("undeclaredName");
+    size_t failure = errorOutput.find("failed.");
+    ASSERT_NE(diagnostic, std::string::npos);
+    ASSERT_NE(failure, std::string::npos);
+    EXPECT_LT(diagnostic, failure);
+}
+
+// Returns one configuration of an xmakefile; libraries, dependencies, custom commands
+// and pools are JSON arrays, tool is the compiler and linker
+static std::string configurationJson(const std::string &name, const std::string &buildType, const std::string &outputFilename,
+                                     const std::string &libraries = "[]", const std::string &dependencies = "[]",
+                                     const std::string &customCommands = "[]", const std::string &tool = "g++",
+                                     const std::string &pools = "[]")
+{
+    return R"({
+                "name": ")" + name + R"(",
+                "build_type": ")" + buildType + R"(",
+                "build_dir": ".build",
+                "output_filename": ")" + outputFilename + R"(",
+                "compiler_path": "",
+                "compiler": ")" + tool + R"(",
+                "c_flags": "",
+                "cxx_flags": "-std=c++17",
+                "linker": ")" + tool + R"(",
+                "linker_flags": "",
+                "archiver": "ar",
+                "archiver_flags": "rcs",
+                "defines": [],
+                "include_paths": [],
+                "library_paths": [],
+                "libraries": )" + libraries + R"(,
+                "source_paths": ["src"],
+                "exclude_paths": [],
+                "exclude_files": [],
+                "pre_build_commands": [],
+                "post_build_commands": [],
+                "pre_run_commands": [],
+                "post_run_commands": [],
+                "install_commands": [],
+                "uninstall_commands": [],
+                "clean_commands": [],
+                "dependencies": )" + dependencies + R"(,
+                "custom_commands": )" + customCommands + R"(,
+                "pools": )" + pools + R"(
+            })";
+}
+
+// Writes an xmakefile with one configuration named Debug, see configurationJson()
+static void writeSingleConfigXMakefile(const std::string &path, const std::string &buildType, const std::string &outputFilename,
+                                       const std::string &libraries = "[]", const std::string &dependencies = "[]",
+                                       const std::string &customCommands = "[]", const std::string &tool = "g++",
+                                       const std::string &pools = "[]")
+{
+    std::ofstream(path) << R"({ "configurations": [)"
+                        << configurationJson("Debug", buildType, outputFilename, libraries, dependencies, customCommands, tool, pools) << "] }";
+}
+
+// Writes toolsDir/job.sh, which runs the tool given as its first argument. Jobs
+// for which the shell code selectLock sets $lock take that lock directory for a
+// while and append to <lock>.log, finding the lock taken marks <lock>.overlap.
+static void writeLockingJobTool(const std::string &toolsDir, const std::string &selectLock)
+{
+    std::filesystem::create_directories(toolsDir);
+    std::ofstream(toolsDir + "/job.sh") << "tool=\"$1\"\nshift\n"
+                                        << selectLock << "\n"
+                                        << "if [ -n \"$lock\" ]; then\n"
+                                        << "  mkdir \"" << toolsDir << "/$lock.lock\" 2>/dev/null || touch \"" << toolsDir << "/$lock.overlap\"\n"
+                                        << "  echo \"$*\" >> \"" << toolsDir << "/$lock.log\"\n"
+                                        << "  sleep 0.1\n"
+                                        << "  rmdir \"" << toolsDir << "/$lock.lock\" 2>/dev/null\n"
+                                        << "fi\n"
+                                        << "exec \"$tool\" \"$@\"\n";
+}
+
+// Counts the lines of a file, 0 if it does not exist
+static size_t countLines(const std::string &path)
+{
+    std::ifstream file(path);
+    size_t lines = 0;
+    for (std::string line; std::getline(file, line);)
+        lines++;
+    return lines;
+}
+
+// Writes an xmakefile using a stand-in compiler that fails on "bad" sources,
+// a bit later on "late" ones, and hangs on "slow" ones after writing a partial object file
+void createFakeCompilerXMakefile(const std::string &testDir, const std::string &xmakefilePath, const std::string &pools = "[]")
+{
+    std::string compiler = testDir + "/fakecc";
+    std::ofstream script(compiler);
+    script << "#!/bin/sh\n"
+              "out=\"\"; prev=\"\"\n"
+              "for a in \"$@\"; do [ \"$prev\" = \"-o\" ] && out=\"$a\"; prev=\"$a\"; done\n"
+              "case \"$*\" in\n"
+              "  *slow*) echo partial > \"$out\"; sleep 30 ;;\n"
+              "  *late*) sleep 0.3; echo \"error: broken source\" >&2; exit 1 ;;\n"
+              "  *bad*) echo \"error: broken source\" >&2; exit 1 ;;\n"
+              "esac\n"
+              "echo object > \"$out\"\n";
+    script.close();
+    std::filesystem::permissions(compiler, std::filesystem::perms::owner_all);
+
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "test_app", "[]", "[]", "[]", compiler, pools);
+}
+
+// Writes an xmakefile using a stand-in compiler that logs the compiled sources
+// to order.txt in the test directory and fails on "bad" ones
+static void createOrderLoggingXMakefile(const std::string &testDir, const std::string &xmakefilePath, const std::string &pools = "[]")
+{
+    createFakeCompilerXMakefile(testDir, xmakefilePath, pools);
+    std::ofstream(testDir + "/fakecc") << "#!/bin/sh\n"
+                                          "out=\"\"; prev=\"\"\n"
+                                          "for a in \"$@\"; do [ \"$prev\" = \"-o\" ] && out=\"$a\"; prev=\"$a\"; done\n"
+                                          "case \"$*\" in *\" -c \"*) for a in \"$@\"; do case \"$a\" in *.cpp) basename \"$a\" >> \""
+                                       << testDir << "/order.txt\" ;; esac; done ;; esac\n"
+                                          "sleep 0.05\n"
+                                          "case \"$*\" in *bad*) echo \"error: broken source\" >&2; exit 1 ;; esac\n"
+                                          "echo object > \"$out\"\n";
+}
+
+// Reads and removes order.txt
+static std::vector<std::string> readCompileOrder(const std::string &testDir)
+{
+    std::vector<std::string> order;
+    std::ifstream file(testDir + "/order.txt");
+    for (std::string line; std::getline(file, line);)
+        order.push_back(line);
+    std::filesystem::remove(testDir + "/order.txt");
+    return order;
+}
+
+// Jobs start longest first: by the wall time of the last build, or by source size without history
+TEST_F(XMakeTest, BuildStartsLongestJobsFirst)
+{
+    createOrderLoggingXMakefile(testDir, xmakefilePath);
+
+    const std::vector<std::string> names = {"a.cpp", "b.cpp", "c.cpp", "d.cpp", "e.cpp"};
+    for (size_t i = 0; i < names.size(); i++)
+        createSourceFile(names[i], "int f" + std::to_string(i) + "() { return 0; }\n" + std::string(1000 * (i + 1), ' ') + "\n");
+
+    CmdLineParser parser = createParser({"-j", "1"});
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        ASSERT_TRUE(xmake.Build());
+    }
+    // Without history the first job starts as soon as its file is found, the others once every file is queued
+    std::vector<std::string> bySize = readCompileOrder(testDir);
+    ASSERT_EQ(bySize.size(), names.size());
+    EXPECT_TRUE(std::is_sorted(bySize.begin() + 1, bySize.end(), std::greater<std::string>()));
+    EXPECT_NE(getCoutOutput().find("Critical path: "), std::string::npos);
+
+    // Replace the measured times, so the history contradicts the sizes
+    std::string jobTimesFile = testDir + "/.build/Debug/job_times.txt";
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(jobTimesFile);
+        for (std::string line; std::getline(file, line);)
+            lines.push_back(line);
+    }
+    ASSERT_EQ(lines.size(), names.size());
+    const std::map<std::string, int> times = {{"a.cpp", 500}, {"b.cpp", 100}, {"c.cpp", 400}, {"d.cpp", 200}, {"e.cpp", 300}};
+    {
+        std::ofstream file(jobTimesFile);
+        for (const std::string &line : lines)
+        {
+            std::string objectFile = line.substr(0, line.find('|'));
+            std::string source = std::filesystem::path(objectFile).stem().string() + ".cpp";
+            file << objectFile << "|" << times.at(source) << "|100|0\n";
+        }
+    }
+    // Missing object files make the sources stale without counting as edited
+    std::filesystem::remove_all(testDir + "/.build/Debug/src");
+
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        ASSERT_TRUE(xmake.Build());
+    }
+    std::vector<std::string> byHistory = readCompileOrder(testDir);
+    ASSERT_EQ(byHistory.size(), names.size());
+    EXPECT_TRUE(std::is_sorted(byHistory.begin(), byHistory.end(), [&times](const std::string &first, const std::string &second)
+                               { return times.at(first) > times.at(second); }));
+}
+
+// The history forgets removed sources, also those that failed
+TEST_F(XMakeTest, BuildDropsHistoryOfRemovedSources)
+{
+    createOrderLoggingXMakefile(testDir, xmakefilePath);
+    createSourceFile("bad.cpp", "int bad() { return 0; }\n");
+    createSourceFile("good.cpp", "int good() { return 0; }\n");
+
+    CmdLineParser parser = createParser({"-j", "1", "-k", "0"});
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        EXPECT_FALSE(xmake.Build());
+    }
+    std::filesystem::remove(testDir + "/src/bad.cpp");
+    std::filesystem::remove_all(testDir + "/.build/Debug/src");
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        ASSERT_TRUE(xmake.Build());
+    }
+    readCompileOrder(testDir);
+
+    std::ifstream file(testDir + "/.build/Debug/job_times.txt");
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("good"), std::string::npos);
+}
+
+// Urgency decides across pools, pool order only between equally urgent jobs
+TEST_F(XMakeTest, BuildStartsUrgentJobsAcrossPools)
+{
+    createOrderLoggingXMakefile(testDir, xmakefilePath, R"([{ "name": "heavy", "depth": 2, "files": ["heavy_*.cpp"] }])");
+
+    createSourceFile("bad.cpp", "int bad() { return 0; }\n");
+    createSourceFile("heavy_a.cpp", "int heavy_a() { return 0; }\n" + std::string(20000, ' ') + "\n");
+    createSourceFile("heavy_b.cpp", "int heavy_b() { return 0; }\n" + std::string(10000, ' ') + "\n");
+
+    CmdLineParser parser = createParser({"-j", "1", "-k", "0"});
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        EXPECT_FALSE(xmake.Build());
+    }
+    readCompileOrder(testDir);
+    std::filesystem::remove_all(testDir + "/.build/Debug/src");
+
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        EXPECT_FALSE(xmake.Build());
+    }
+    std::vector<std::string> order = readCompileOrder(testDir);
+    ASSERT_EQ(order.size(), 3u);
+    EXPECT_EQ(order[0], "bad.cpp");
+}
+
+// Collects the object files below the test directory
+static std::vector<std::string> findObjectFiles(const std::string &testDir)
+{
+    std::vector<std::string> objects;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(testDir))
+    {
+        if (entry.path().extension() == ".o")
+            objects.push_back(entry.path().filename().string());
+    }
+    std::sort(objects.begin(), objects.end());
+    return objects;
+}
+
+// Files that failed last time go first, then edited files, then the longest jobs
+TEST_F(XMakeTest, BuildStartsFailedAndEditedFilesFirst)
+{
+    createOrderLoggingXMakefile(testDir, xmakefilePath);
+    createSourceFile("bad.cpp", "int bad() { return 0; }\n");
+    createSourceFile("edited.cpp", "int edited() { return 0; }\n");
+    createSourceFile("large.cpp", "int large() { return 0; }\n" + std::string(30000, ' ') + "\n");
+    createSourceFile("medium.cpp", "int medium() { return 0; }\n" + std::string(20000, ' ') + "\n");
+    createSourceFile("small.cpp", "int small() { return 0; }\n" + std::string(10000, ' ') + "\n");
+
+    {
+        CmdLineParser parser = createParser({"-j", "1", "-k", "0"});
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        EXPECT_FALSE(xmake.Build());
+    }
+    readCompileOrder(testDir);
+
+    // edited.cpp is newer than its object file, the objects of the large ones are gone
+    std::filesystem::last_write_time(testDir + "/src/edited.cpp", std::filesystem::file_time_type::clock::now() + std::chrono::seconds(2));
+    std::vector<std::filesystem::path> objectFiles;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(testDir))
+    {
+        if (entry.path().extension() == ".o" && entry.path().stem() != "edited")
+            objectFiles.push_back(entry.path());
+    }
+    for (const auto &objectFile : objectFiles)
+        std::filesystem::remove(objectFile);
+
+    {
+        CmdLineParser parser = createParser({"-j", "1", "-k", "0"});
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        EXPECT_FALSE(xmake.Build());
+    }
+    // Both start as soon as they are found, which one is found first is open, as is the order of the others
+    std::vector<std::string> order = readCompileOrder(testDir);
+    ASSERT_EQ(order.size(), 5u);
+    std::vector<std::string> urgent(order.begin(), order.begin() + 2);
+    std::sort(urgent.begin(), urgent.end());
+    EXPECT_EQ(urgent, (std::vector<std::string>{"bad.cpp", "edited.cpp"}));
+}
+
+// On a tree with history an edited file starts while the other files are still being discovered
+TEST_F(XMakeTest, BuildStartsEditedFileDuringDiscovery)
+{
+    createOrderLoggingXMakefile(testDir, xmakefilePath);
+    std::string xmakefile;
+    {
+        std::ifstream file(xmakefilePath);
+        xmakefile.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::string sourcePaths = R"("source_paths": ["src"])";
+    xmakefile.replace(xmakefile.find(sourcePaths), sourcePaths.size(), R"("source_paths": ["src/first", "src/rest"])");
+    std::ofstream(xmakefilePath) << xmakefile;
+    std::filesystem::create_directories(testDir + "/src/first");
+    std::filesystem::create_directories(testDir + "/src/rest");
+    createSourceFile("first/edited.cpp", "int edited() { return 0; }\n");
+    createSourceFile("rest/f0.cpp", "int f0() { return 0; }\n");
+
+    CmdLineParser parser = createParser({"-v", "-j", "1"});
+    {
+        XMake xmake(parser);
+        ASSERT_TRUE(xmake.Init(xmakefilePath));
+        ASSERT_TRUE(xmake.Build());
+    }
+    readCompileOrder(testDir);
+
+    // Many more up-to-date files scanned after the edited one, their objects next to the one of f0
+    std::filesystem::path firstObject;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(testDir))
+    {
+        if (entry.path().filename() == "f0.o")
+            firstObject = entry.path();
+    }
+    ASSERT_FALSE(firstObject.empty());
+    for (int i = 1; i < 2000; i++)
+        createSourceFile("rest/f" + std::to_string(i) + ".cpp", "int f" + std::to_string(i) + "() { return 0; }\n");
+    for (int i = 1; i < 2000; i++)
+        std::ofstream(firstObject.parent_path() / ("f" + std::to_string(i) + ".o")) << "object\n";
+    std::filesystem::last_write_time(testDir + "/src/first/edited.cpp", std::filesystem::file_time_type::clock::now() + std::chrono::seconds(2));
+
+    // The verbose "Skipping:" lines tell how far discovery got
+    clearBuffers();
+    Logger::SetVerbose(true);
+    bool built = false;
+    {
+        XMake xmake(parser);
+        built = xmake.Init(xmakefilePath) && xmake.Build();
+    }
+    Logger::SetVerbose(false);
+    ASSERT_TRUE(built);
+    EXPECT_EQ(readCompileOrder(testDir), std::vector<std::string>{"edited.cpp"});
+
+    std::string output = getCoutOutput();
+    size_t building = output.find("Building: ");
+    size_t lastSkipped = output.rfind("Skipping: ");
+    ASSERT_NE(building, std::string::npos);
+    ASSERT_NE(lastSkipped, std::string::npos);
+    EXPECT_NE(output.find("edited.cpp", building), std::string::npos);
+    EXPECT_LT(building, lastSkipped);
+}
+
+// The first failure cancels the running jobs and removes their partial output
+TEST_F(XMakeTest, BuildFailureCancelsRunningJobs)
+{
+    createFakeCompilerXMakefile(testDir, xmakefilePath);
+    createSourceFile("late.cpp");
+    createSourceFile("slow.cpp");
+
+    CmdLineParser parser = createParser({"-j", "2"});
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(xmake.Build());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+
+    EXPECT_NE(getCerrOutput().find("error: broken source"), std::string::npos);
+    EXPECT_TRUE(findObjectFiles(testDir).empty());
+}
+
+// With -k the independent jobs keep running and all failures are reported
+TEST_F(XMakeTest, BuildKeepGoing)
+{
+    createFakeCompilerXMakefile(testDir, xmakefilePath);
+    createSourceFile("bad1.cpp");
+    createSourceFile("bad2.cpp");
+    createSourceFile("good.cpp");
+
+    CmdLineParser parser = createParser({"-k", "0"});
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+
+    EXPECT_FALSE(xmake.Build());
+
+    std::string errorOutput = getCerrOutput();
+    EXPECT_NE(errorOutput.find("bad1.cpp"), std::string::npos);
+    EXPECT_NE(errorOutput.find("bad2.cpp"), std::string::npos);
+    EXPECT_NE(errorOutput.find("2 job(s) failed."), std::string::npos);
+    EXPECT_EQ(getCoutOutput().find("Linking:"), std::string::npos);
+    EXPECT_EQ(findObjectFiles(testDir), std::vector<std::string>{"good.o"});
+}
+
+// -k N stops at the Nth failure
+TEST_F(XMakeTest, BuildKeepGoingStopsAtLimit)
+{
+    createFakeCompilerXMakefile(testDir, xmakefilePath);
+    createSourceFile("bad1.cpp");
+    createSourceFile("bad2.cpp");
+    createSourceFile("bad3.cpp");
+
+    CmdLineParser parser = createParser({"-k", "2", "-j", "1"});
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+
+    EXPECT_FALSE(xmake.Build());
+    EXPECT_NE(getCerrOutput().find("2 job(s) failed."), std::string::npos);
 }
 
 // Test Build with multiple source files
@@ -353,6 +854,483 @@ TEST_F(XMakeTest, BuildSkipsUnchangedFiles)
     EXPECT_TRUE(output.find("No changes in files") != std::string::npos);
 }
 
+// A deleted object file is rebuilt even if no source changed
+TEST_F(XMakeTest, BuildRecreatesMissingObject)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+    createSourceFile("util.cpp", "int util() { return 1; }");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+    ASSERT_TRUE(xmake.Build());
+
+    std::string utilObject;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(testDir))
+    {
+        if (entry.path().filename() == "util.o")
+            utilObject = entry.path().string();
+    }
+    ASSERT_FALSE(utilObject.empty());
+    std::filesystem::remove(utilObject);
+    clearBuffers();
+
+    xmake.Init(xmakefilePath);
+    EXPECT_TRUE(xmake.Build());
+    std::string output = getCoutOutput();
+    EXPECT_NE(output.find("Building: " + utilObject), std::string::npos);
+    EXPECT_EQ(output.find("main.o"), std::string::npos);
+    EXPECT_TRUE(std::filesystem::exists(utilObject));
+}
+
+// Pre-build commands only run if something has to be built
+TEST_F(XMakeTest, BuildRunsPreBuildOnlyWhenNeeded)
+{
+    createBasicXMakefile();
+    std::string xmakefile;
+    {
+        std::ifstream file(xmakefilePath);
+        std::stringstream content;
+        content << file.rdbuf();
+        xmakefile = content.str();
+    }
+    std::string marker = testDir + "/prebuild_marker";
+    xmakefile.replace(xmakefile.find("\"echo Pre-build\""), std::string("\"echo Pre-build\"").size(), "\"touch " + marker + "\"");
+    std::ofstream(xmakefilePath) << xmakefile;
+    createSourceFile("main.cpp");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    xmake.Init(xmakefilePath);
+    ASSERT_TRUE(xmake.Build());
+    EXPECT_TRUE(std::filesystem::exists(marker));
+
+    std::filesystem::remove(marker);
+    xmake.Init(xmakefilePath);
+    EXPECT_TRUE(xmake.Build());
+    EXPECT_FALSE(std::filesystem::exists(marker));
+}
+
+// Several configurations are built in one run with one summary
+TEST_F(XMakeTest, BuildMultipleConfigs)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+    createSourceFile("util.cpp", "int util() { return 1; }");
+
+    CmdLineParser parser = createParser({"-c", "Debug, Release"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    EXPECT_TRUE(xmake.Build());
+
+    std::string output = getCoutOutput();
+    EXPECT_NE(output.find("[Debug] Linking: test_app"), std::string::npos);
+    EXPECT_NE(output.find("[Release] Linking: test_app_release"), std::string::npos);
+    EXPECT_NE(output.find("Debug: 2 file(s) compiled, test_app linked"), std::string::npos);
+    EXPECT_NE(output.find("Release: 2 file(s) compiled, test_app_release linked"), std::string::npos);
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/test_app"));
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Release/test_app_release"));
+    clearBuffers();
+
+    // Both are up to date afterwards
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    EXPECT_TRUE(xmake.Build());
+    output = getCoutOutput();
+    EXPECT_EQ(output.find("Building:"), std::string::npos);
+    EXPECT_NE(output.find("Debug: up to date"), std::string::npos);
+    EXPECT_NE(output.find("Release: up to date"), std::string::npos);
+}
+
+// --all-configs selects every configuration of the xmakefile
+TEST_F(XMakeTest, BuildAllConfigs)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+
+    CmdLineParser parser = createParser({"--all-configs"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    EXPECT_TRUE(xmake.Build());
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/test_app"));
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Release/test_app_release"));
+}
+
+// A failing configuration does not hide the result of the others
+TEST_F(XMakeTest, BuildMultipleConfigsKeepGoing)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp", "int main() {\n#ifdef NDEBUG\n  return broken;\n#endif\n  return 0; }");
+
+    CmdLineParser parser = createParser({"-c", "Debug,Release", "-k", "0"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    EXPECT_FALSE(xmake.Build());
+
+    std::string output = getCoutOutput();
+    EXPECT_NE(output.find("Debug: 1 file(s) compiled, test_app linked"), std::string::npos);
+    EXPECT_NE(output.find("Release: failed"), std::string::npos);
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/test_app"));
+}
+
+// An unknown name in the list fails the initialization
+TEST_F(XMakeTest, InitWithUnknownConfigInList)
+{
+    createBasicXMakefile();
+
+    CmdLineParser parser = createParser({"-c", "Debug,Profile"});
+    XMake xmake(parser);
+    EXPECT_FALSE(xmake.Init(xmakefilePath));
+    EXPECT_NE(getCerrOutput().find("Configuration not found: Profile"), std::string::npos);
+}
+
+// A static library of another xmakefile is built first and linked into the executable
+TEST_F(XMakeTest, BuildWithDependency)
+{
+    std::string libraryDir = testDir + "/mathlib";
+    std::filesystem::create_directories(libraryDir + "/src");
+    writeSingleConfigXMakefile(libraryDir + "/xmakefile.json", "StaticLibrary", "libmath.a");
+    std::ofstream(libraryDir + "/src/math.cpp") << "int twice(int value) { return 2 * value; }\n";
+
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "calc", "[]", R"(["mathlib/xmakefile.json"])");
+    createSourceFile("main.cpp", "int twice(int value);\nint main() { return twice(21) == 42 ? 0 : 1; }\n");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+
+    std::string output = getCoutOutput();
+    EXPECT_LT(output.find("[mathlib/Debug] Linking: libmath.a"), output.find("[Debug] Linking: calc"));
+    EXPECT_NE(output.find("mathlib/Debug: 1 file(s) compiled, libmath.a linked"), std::string::npos);
+    ASSERT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/calc"));
+    EXPECT_EQ(system((testDir + "/.build/Debug/calc").c_str()), 0);
+
+    // A rebuilt library with the same content does not relink the executable
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(libraryDir + "/src/math.cpp", std::ios::app) << "// unchanged code\n";
+    clearBuffers();
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    output = getCoutOutput();
+    EXPECT_NE(output.find("[mathlib/Debug] Linking: libmath.a"), std::string::npos);
+    EXPECT_EQ(output.find("[Debug] Linking: calc"), std::string::npos);
+    EXPECT_NE(output.find("Debug: up to date"), std::string::npos);
+
+    // A changed library does
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(libraryDir + "/src/math.cpp") << "int twice(int value) { return value + value + 1; }\n";
+    clearBuffers();
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    output = getCoutOutput();
+    EXPECT_EQ(output.find("Building: " + testDir + "/.build/Debug"), std::string::npos);
+    EXPECT_NE(output.find("[Debug] Linking: calc"), std::string::npos);
+    EXPECT_NE(system((testDir + "/.build/Debug/calc").c_str()), 0);
+}
+
+// The executable is not linked against a library that failed to build
+TEST_F(XMakeTest, BuildWithFailingDependency)
+{
+    std::string libraryDir = testDir + "/mathlib";
+    std::filesystem::create_directories(libraryDir + "/src");
+    writeSingleConfigXMakefile(libraryDir + "/xmakefile.json", "StaticLibrary", "libmath.a");
+    std::ofstream(libraryDir + "/src/math.cpp") << "int twice(int value) { return broken; }\n";
+
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "calc", "[]", R"([{ "xmakefile": "mathlib/xmakefile.json", "config": "Debug" }])");
+    createSourceFile("main.cpp", "int twice(int value);\nint main() { return twice(21) == 42 ? 0 : 1; }\n");
+
+    CmdLineParser parser = createParser({"-k", "0"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    EXPECT_FALSE(xmake.Build());
+    EXPECT_NE(getCerrOutput().find("[Debug] Not linked, a dependency failed."), std::string::npos);
+    EXPECT_FALSE(std::filesystem::exists(testDir + "/.build/Debug/calc"));
+}
+
+// Dependency cycles are reported instead of followed
+TEST_F(XMakeTest, InitWithDependencyCycle)
+{
+    std::string otherDir = testDir + "/other";
+    std::filesystem::create_directories(otherDir + "/src");
+    writeSingleConfigXMakefile(otherDir + "/xmakefile.json", "StaticLibrary", "libother.a", "[]", R"(["../xmakefile.json"])");
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "calc", "[]", R"(["other/xmakefile.json"])");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    EXPECT_FALSE(xmake.Init(xmakefilePath));
+    EXPECT_NE(getCerrOutput().find("Dependency cycle"), std::string::npos);
+}
+
+// Generated sources are compiled, the generator only runs if its input changed
+TEST_F(XMakeTest, BuildRunsCustomCommandsWhenStale)
+{
+    std::string generatorDir = testDir + "/gen";
+    std::filesystem::create_directories(generatorDir);
+    std::ofstream(generatorDir + "/value.txt") << "int generated() { return 7; }\n";
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "app", "[]", "[]",
+                               R"([{ "name": "value", "command": "cp )" + generatorDir + "/value.txt " + generatorDir + R"(/out/value.cpp",
+                                     "inputs": ["gen/value.txt"], "outputs": ["gen/out/value.cpp"] }])");
+    createSourceFile("main.cpp", "int generated();\nint main() { return generated() == 7 ? 0 : 1; }\n");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    std::string output = getCoutOutput();
+    EXPECT_NE(output.find("Generating: value"), std::string::npos);
+    EXPECT_LT(output.find("Generating: value"), output.find("Building:"));
+    EXPECT_EQ(system((testDir + "/.build/Debug/app").c_str()), 0);
+
+    clearBuffers();
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    output = getCoutOutput();
+    EXPECT_EQ(output.find("Generating:"), std::string::npos);
+    EXPECT_NE(output.find("No changes in files."), std::string::npos);
+
+    // A changed input regenerates the source, which is compiled again
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(generatorDir + "/value.txt") << "int generated() { return 8; }\n";
+    clearBuffers();
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    output = getCoutOutput();
+    EXPECT_NE(output.find("Generating: value"), std::string::npos);
+    EXPECT_NE(output.find("value.o"), std::string::npos);
+    EXPECT_EQ(output.find("main.o"), std::string::npos);
+    EXPECT_NE(system((testDir + "/.build/Debug/app").c_str()), 0);
+}
+
+// Pools limit their jobs across all configurations, on top of -j
+TEST_F(XMakeTest, BuildHonorsPoolDepths)
+{
+    // Compiles of heavy_*.cpp and links take a lock directory, a taken lock marks an overlap
+    std::string toolsDir = testDir + "/tools";
+    writeLockingJobTool(toolsDir, "case \" $* \" in *\" -c \"*) case \"$*\" in *heavy_*) lock=heavy ;; *) lock= ;; esac ;; *) lock=link ;; esac");
+
+    std::string tool = "sh " + toolsDir + "/job.sh g++";
+    std::string pools = R"([
+                { "name": "heavy", "depth": 1, "files": ["heavy_*.cpp"] },
+                { "name": "link", "depth": 1 }
+            ])";
+    std::ofstream(xmakefilePath) << R"({ "configurations": [)"
+                                 << configurationJson("Debug", "Executable", "app", "[]", "[]", "[]", tool, pools) << ","
+                                 << configurationJson("Release", "Executable", "app", "[]", "[]", "[]", tool, pools) << "] }";
+
+    createSourceFile("main.cpp", "int heavy_a();\nint heavy_b();\nint main() { return heavy_a() + heavy_b(); }\n");
+    createSourceFile("heavy_a.cpp", "int heavy_a() { return 0; }\n");
+    createSourceFile("heavy_b.cpp", "int heavy_b() { return 0; }\n");
+    createSourceFile("light_a.cpp", "int light_a() { return 0; }\n");
+    createSourceFile("light_b.cpp", "int light_b() { return 0; }\n");
+
+    CmdLineParser parser = createParser({"-j", "8", "--all-configs"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/app"));
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Release/app"));
+
+    // Four heavy compiles one after the other, and the links of both configurations
+    EXPECT_EQ(countLines(toolsDir + "/heavy.log"), 4u);
+    EXPECT_EQ(countLines(toolsDir + "/link.log"), 2u);
+    EXPECT_FALSE(std::filesystem::exists(toolsDir + "/heavy.overlap"));
+    EXPECT_FALSE(std::filesystem::exists(toolsDir + "/link.overlap"));
+}
+
+// Commands of the build find the jobserver of xmake in MAKEFLAGS, which is restored afterwards
+TEST_F(XMakeTest, BuildExportsJobServerToCommands)
+{
+    std::string toolsDir = testDir + "/tools";
+    std::filesystem::create_directories(toolsDir);
+    std::ofstream(toolsDir + "/flags.sh") << "printf '%s' \"$MAKEFLAGS\" > \"" << toolsDir << "/makeflags.txt\"\n";
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "app", "[]", "[]",
+                               R"([{ "name": "flags", "command": "sh )" + toolsDir + R"(/flags.sh", "outputs": ["tools/makeflags.txt"] }])");
+    createSourceFile("main.cpp", "int main() { return 0; }\n");
+
+    unsetenv("MAKEFLAGS");
+    CmdLineParser parser = createParser({"-j", "3", "--jobserver-style", "fifo"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+
+    std::ifstream file(toolsDir + "/makeflags.txt");
+    std::string makeFlags((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_NE(makeFlags.find("-j3 --jobserver-auth=fifo:"), std::string::npos) << makeFlags;
+    EXPECT_EQ(std::getenv("MAKEFLAGS"), nullptr);
+}
+
+// Writes an executable with three source files whose compiles and link take a
+// lock directory, a job finding the lock taken marks job.overlap in toolsDir
+static void writeSerialJobsXMakefile(const std::string &path, const std::string &toolsDir)
+{
+    writeLockingJobTool(toolsDir, "lock=job");
+    writeSingleConfigXMakefile(path, "Executable", "app", "[]", "[]", "[]", "sh " + toolsDir + "/job.sh g++");
+
+    std::string sourceDir = std::filesystem::path(path).parent_path().string() + "/src";
+    std::filesystem::create_directories(sourceDir);
+    std::ofstream(sourceDir + "/main.cpp") << "int a();\nint b();\nint main() { return a() + b(); }\n";
+    std::ofstream(sourceDir + "/a.cpp") << "int a() { return 0; }\n";
+    std::ofstream(sourceDir + "/b.cpp") << "int b() { return 0; }\n";
+}
+
+// Under a jobserver without free tokens the jobs run one after the other, whatever -j would allow
+TEST_F(XMakeTest, BuildTakesJobSlotsFromMakeJobServer)
+{
+    std::string toolsDir = testDir + "/tools";
+    writeSerialJobsXMakefile(xmakefilePath, toolsDir);
+
+    JobServer make;
+    ASSERT_TRUE(make.Create(1, JobServer::Style::Pipe));
+    setenv("MAKEFLAGS", make.GetMakeFlags(1).c_str(), 1);
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    bool built = xmake.Build();
+    EXPECT_STREQ(std::getenv("MAKEFLAGS"), make.GetMakeFlags(1).c_str());
+    unsetenv("MAKEFLAGS");
+
+    ASSERT_TRUE(built);
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/app"));
+    EXPECT_FALSE(std::filesystem::exists(toolsDir + "/job.overlap"));
+    EXPECT_FALSE(make.TryAcquire());
+}
+
+// A host-wide limit of one job runs the jobs one after the other, whatever -j would allow
+TEST_F(XMakeTest, BuildHonorsHostJobLimit)
+{
+    std::string toolsDir = testDir + "/tools";
+    writeSerialJobsXMakefile(xmakefilePath, toolsDir);
+
+    CmdLineParser parser = createParser({"-j", "8", "--host-jobs", "1", "--host-jobs-dir", testDir + "/locks"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/app"));
+    EXPECT_FALSE(std::filesystem::exists(toolsDir + "/job.overlap"));
+
+    // The slot is free again for the next build
+    HostJobSlots slots;
+    ASSERT_TRUE(slots.Open(testDir + "/locks", 1, 0));
+    EXPECT_TRUE(slots.TryAcquire());
+}
+
+// An overloaded host still builds, one job at a time
+TEST_F(XMakeTest, BuildRunsOneJobAtATimeWhileOverloaded)
+{
+    std::string toolsDir = testDir + "/tools";
+    writeSerialJobsXMakefile(xmakefilePath, toolsDir);
+
+    // No host has that much memory available
+    CmdLineParser parser = createParser({"-j", "8", "--min-free-memory", "1000000000"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/app"));
+    EXPECT_FALSE(std::filesystem::exists(toolsDir + "/job.overlap"));
+}
+
+// Every job runs with the address space limit of --job-memory-limit
+TEST_F(XMakeTest, BuildLimitsJobMemory)
+{
+    std::string toolsDir = testDir + "/tools";
+    std::filesystem::create_directories(toolsDir);
+    std::ofstream(toolsDir + "/limit.sh") << "ulimit -v > \"" << toolsDir << "/limit.txt\"\n";
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "app", "[]", "[]",
+                               R"([{ "name": "limit", "command": "sh )" + toolsDir + R"(/limit.sh", "outputs": ["tools/limit.txt"] }])");
+    createSourceFile("main.cpp", "int main() { return 0; }\n");
+
+    CmdLineParser parser = createParser({"--job-memory-limit", "2048"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+
+    std::string limit;
+    std::ifstream(toolsDir + "/limit.txt") >> limit;
+    EXPECT_EQ(limit, "2097152");
+}
+
+// A traced custom command runs again when a file it read changes, without declaring it as input
+TEST_F(XMakeTest, BuildRunsTracedCustomCommandWhenReadFileChanges)
+{
+    if (CommandTrace::GetTracerLibrary().empty())
+        GTEST_SKIP() << "libxmaketrace.so is not built";
+
+    std::string generatorDir = testDir + "/gen";
+    std::filesystem::create_directories(generatorDir + "/out");
+    std::ofstream(generatorDir + "/value.txt") << "int generated() { return 7; }\n";
+    std::ofstream(generatorDir + "/generate.sh") << "cat \"$1/value.txt\" > \"$1/out/value.cpp\"\n";
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "app", "[]", "[]",
+                               R"([{ "name": "value", "command": "sh )" + generatorDir + "/generate.sh " + generatorDir + R"(",
+                                     "outputs": ["gen/out/value.cpp"], "trace": true }])");
+    createSourceFile("main.cpp", "int generated();\nint main() { return generated() == 7 ? 0 : 1; }\n");
+
+    CmdLineParser parser = createParser();
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    EXPECT_NE(getCoutOutput().find("Generating: value"), std::string::npos);
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/custom_commands.trace"));
+
+    clearBuffers();
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    EXPECT_EQ(getCoutOutput().find("Generating:"), std::string::npos);
+
+    // The file read by the script was traced as an input
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(generatorDir + "/value.txt") << "int generated() { return 8; }\n";
+    clearBuffers();
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+    ASSERT_TRUE(xmake.Build());
+    std::string output = getCoutOutput();
+    EXPECT_NE(output.find("Generating: value"), std::string::npos);
+    EXPECT_NE(output.find("value.o"), std::string::npos);
+    EXPECT_NE(system((testDir + "/.build/Debug/app").c_str()), 0);
+}
+
+// Independent custom commands run in parallel, a command reading their outputs runs after them
+TEST_F(XMakeTest, BuildRunsIndependentCustomCommandsInParallel)
+{
+    std::string generatorDir = testDir + "/gen";
+    std::filesystem::create_directories(generatorDir);
+    // Each of the two commands waits a while for the other one to start, and marks that it did
+    std::ofstream(generatorDir + "/slow.sh") << "touch \"$1.started\"\n"
+                                              "for i in $(seq 100); do [ -e \"$3.started\" ] && break; sleep 0.02; done\n"
+                                              "[ -e \"$3.started\" ] && touch \"$1.overlapped\"\n"
+                                              "echo \"$2\" > \"$1\"\n";
+    std::ofstream(generatorDir + "/join.sh") << "cat \"$2\" \"$3\" > \"$1\"\n";
+    std::string commands = R"([
+        { "name": "join", "command": "sh )" + generatorDir + "/join.sh " + generatorDir + "/joined.cpp " + generatorDir + "/a.cpp " + generatorDir + R"(/b.cpp",
+          "inputs": ["gen/a.cpp", "gen/b.cpp"], "outputs": ["gen/joined.cpp"] },
+        { "name": "a", "command": "sh )" + generatorDir + "/slow.sh " + generatorDir + "/a.cpp int_a " + generatorDir + R"(/b.cpp", "outputs": ["gen/a.cpp"] },
+        { "name": "b", "command": "sh )" + generatorDir + "/slow.sh " + generatorDir + "/b.cpp int_b " + generatorDir + R"(/a.cpp", "outputs": ["gen/b.cpp"] }
+    ])";
+    writeSingleConfigXMakefile(xmakefilePath, "Executable", "app", "[]", "[]", commands);
+    createSourceFile("main.cpp");
+
+    CmdLineParser parser = createParser({"-j", "4"});
+    XMake xmake(parser);
+    ASSERT_TRUE(xmake.Init(xmakefilePath));
+
+    EXPECT_FALSE(xmake.Build()); // The generated text is no valid code, only the order matters here
+
+    std::string output = getCoutOutput();
+    EXPECT_LT(output.find("Generating: b"), output.find("Generating: join"));
+    EXPECT_LT(output.find("Generating: a"), output.find("Generating: join"));
+    EXPECT_TRUE(std::filesystem::exists(generatorDir + "/a.cpp.overlapped"));
+    EXPECT_TRUE(std::filesystem::exists(generatorDir + "/b.cpp.overlapped"));
+
+    std::ifstream joined(generatorDir + "/joined.cpp");
+    std::stringstream content;
+    content << joined.rdbuf();
+    EXPECT_EQ(content.str(), "int_a\nint_b\n");
+}
+
 // Test Build with parallel jobs
 TEST_F(XMakeTest, BuildWithParallelJobs)
 {
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "XMakefile.h"
+#include "BinaryStream.h"
 #include <ArduinoJson.h>
 #include <filesystem>
 
@@ -143,7 +144,7 @@ TEST_F(XMakefileTest, DefaultConstructor)
 {
     XMakefile xmakefile;
     
-    EXPECT_TRUE(xmakefile.configs.empty());
+    EXPECT_TRUE(xmakefile.Empty());
 }
 
 // Test FromJSON with single configuration
@@ -154,9 +155,9 @@ TEST_F(XMakefileTest, FromJSONSingleConfig)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 1);
-    EXPECT_EQ(xmakefile.configs[0].Name, "Debug");
-    EXPECT_EQ(xmakefile.configs[0].BuildType, "Debug");
+    EXPECT_EQ(xmakefile.ConfigCount(), 1);
+    EXPECT_EQ(xmakefile.GetConfig(0).Name, "Debug");
+    EXPECT_EQ(xmakefile.GetConfig(0).BuildType, "Debug");
 }
 
 // Test FromJSON with multiple configurations
@@ -167,9 +168,9 @@ TEST_F(XMakefileTest, FromJSONMultipleConfigs)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 2);
-    EXPECT_EQ(xmakefile.configs[0].Name, "Debug");
-    EXPECT_EQ(xmakefile.configs[1].Name, "Release");
+    EXPECT_EQ(xmakefile.ConfigCount(), 2);
+    EXPECT_EQ(xmakefile.GetConfig(0).Name, "Debug");
+    EXPECT_EQ(xmakefile.GetConfig(1).Name, "Release");
 }
 
 // Test configuration details
@@ -181,16 +182,16 @@ TEST_F(XMakefileTest, ConfigurationDetails)
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
     // Check Debug configuration
-    EXPECT_EQ(xmakefile.configs[0].OutputFilename, "app_debug");
-    EXPECT_TRUE(xmakefile.configs[0].CXXCompilerFlags.find("-g") != std::string::npos);
-    EXPECT_EQ(xmakefile.configs[0].Defines.size(), 1);
-    EXPECT_EQ(xmakefile.configs[0].Defines[0], "DEBUG");
+    EXPECT_EQ(xmakefile.GetConfig(0).OutputFilename, "app_debug");
+    EXPECT_TRUE(xmakefile.GetConfig(0).CXXCompilerFlags.find("-g") != std::string::npos);
+    EXPECT_EQ(xmakefile.GetConfig(0).Defines.size(), 1);
+    EXPECT_EQ(xmakefile.GetConfig(0).Defines[0], "DEBUG");
     
     // Check Release configuration
-    EXPECT_EQ(xmakefile.configs[1].OutputFilename, "app_release");
-    EXPECT_TRUE(xmakefile.configs[1].CXXCompilerFlags.find("-O3") != std::string::npos);
-    EXPECT_EQ(xmakefile.configs[1].Defines.size(), 1);
-    EXPECT_EQ(xmakefile.configs[1].Defines[0], "NDEBUG");
+    EXPECT_EQ(xmakefile.GetConfig(1).OutputFilename, "app_release");
+    EXPECT_TRUE(xmakefile.GetConfig(1).CXXCompilerFlags.find("-O3") != std::string::npos);
+    EXPECT_EQ(xmakefile.GetConfig(1).Defines.size(), 1);
+    EXPECT_EQ(xmakefile.GetConfig(1).Defines[0], "NDEBUG");
 }
 
 // Test empty configurations array
@@ -202,10 +203,10 @@ TEST_F(XMakefileTest, EmptyConfigurationsArray)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_TRUE(xmakefile.configs.empty());
+    EXPECT_TRUE(xmakefile.Empty());
 }
 
-// Test accessing configs vector
+// Test accessing configurations by index
 TEST_F(XMakefileTest, AccessConfigsVector)
 {
     XMakefile xmakefile;
@@ -213,10 +214,10 @@ TEST_F(XMakefileTest, AccessConfigsVector)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_FALSE(xmakefile.configs.empty());
-    EXPECT_EQ(xmakefile.configs.size(), 1);
+    EXPECT_FALSE(xmakefile.Empty());
+    EXPECT_EQ(xmakefile.ConfigCount(), 1);
     
-    XMakefileConfig& config = xmakefile.configs[0];
+    const XMakefileConfig& config = xmakefile.GetConfig(0);
     EXPECT_EQ(config.Name, "Debug");
 }
 
@@ -263,10 +264,10 @@ TEST_F(XMakefileTest, ThreeConfigurations)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 3);
-    EXPECT_EQ(xmakefile.configs[0].Name, "Debug");
-    EXPECT_EQ(xmakefile.configs[1].Name, "Release");
-    EXPECT_EQ(xmakefile.configs[2].Name, "Test");
+    EXPECT_EQ(xmakefile.ConfigCount(), 3);
+    EXPECT_EQ(xmakefile.GetConfig(0).Name, "Debug");
+    EXPECT_EQ(xmakefile.GetConfig(1).Name, "Release");
+    EXPECT_EQ(xmakefile.GetConfig(2).Name, "Test");
 }
 
 // Test configuration with all features
@@ -338,8 +339,8 @@ TEST_F(XMakefileTest, ConfigurationWithAllFeatures)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 1);
-    XMakefileConfig& cfg = xmakefile.configs[0];
+    EXPECT_EQ(xmakefile.ConfigCount(), 1);
+    const XMakefileConfig& cfg = xmakefile.GetConfig(0);
     
     EXPECT_EQ(cfg.Name, "FullFeature");
     EXPECT_EQ(cfg.Defines.size(), 2);
@@ -401,11 +402,11 @@ TEST_F(XMakefileTest, DifferentBuildTypes)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 4);
-    EXPECT_EQ(xmakefile.configs[0].BuildType, "Debug");
-    EXPECT_EQ(xmakefile.configs[1].BuildType, "Release");
-    EXPECT_EQ(xmakefile.configs[2].BuildType, "RelWithDebInfo");
-    EXPECT_EQ(xmakefile.configs[3].BuildType, "MinSizeRel");
+    EXPECT_EQ(xmakefile.ConfigCount(), 4);
+    EXPECT_EQ(xmakefile.GetConfig(0).BuildType, "Debug");
+    EXPECT_EQ(xmakefile.GetConfig(1).BuildType, "Release");
+    EXPECT_EQ(xmakefile.GetConfig(2).BuildType, "RelWithDebInfo");
+    EXPECT_EQ(xmakefile.GetConfig(3).BuildType, "MinSizeRel");
 }
 
 // Test configuration with different compilers
@@ -451,10 +452,10 @@ TEST_F(XMakefileTest, DifferentCompilers)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 3);
-    EXPECT_EQ(xmakefile.configs[0].Compiler, "g++");
-    EXPECT_EQ(xmakefile.configs[1].Compiler, "clang++");
-    EXPECT_EQ(xmakefile.configs[2].Compiler, "c++");
+    EXPECT_EQ(xmakefile.ConfigCount(), 3);
+    EXPECT_EQ(xmakefile.GetConfig(0).Compiler, "g++");
+    EXPECT_EQ(xmakefile.GetConfig(1).Compiler, "clang++");
+    EXPECT_EQ(xmakefile.GetConfig(2).Compiler, "c++");
 }
 
 // Test base path propagation to configs
@@ -468,9 +469,9 @@ TEST_F(XMakefileTest, BasePathPropagation)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    EXPECT_EQ(xmakefile.configs.size(), 1);
-    EXPECT_EQ(xmakefile.configs[0].IncludePaths.size(), 1);
-    EXPECT_TRUE(xmakefile.configs[0].IncludePaths[0].find(testDir) != std::string::npos);
+    EXPECT_EQ(xmakefile.ConfigCount(), 1);
+    EXPECT_EQ(xmakefile.GetConfig(0).IncludePaths.size(), 1);
+    EXPECT_TRUE(xmakefile.GetConfig(0).IncludePaths[0].find(testDir) != std::string::npos);
 }
 
 // Test configuration copying
@@ -481,11 +482,11 @@ TEST_F(XMakefileTest, ConfigurationCopying)
     
     xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
     
-    // Copy the configs vector
-    std::vector<XMakefileConfig> configsCopy = xmakefile.configs;
+    // Copy a resolved configuration
+    XMakefileConfig configCopy = xmakefile.GetConfig(0);
     
-    EXPECT_EQ(configsCopy.size(), 1);
-    EXPECT_EQ(configsCopy[0].Name, "Debug");
+    EXPECT_EQ(configCopy.Name, "Debug");
+    EXPECT_EQ(configCopy.IncludePaths, xmakefile.GetConfig(0).IncludePaths);
 }
 
 // Test empty XMakefile after construction
@@ -493,8 +494,8 @@ TEST_F(XMakefileTest, EmptyAfterConstruction)
 {
     XMakefile xmakefile;
     
-    EXPECT_EQ(xmakefile.configs.size(), 0);
-    EXPECT_TRUE(xmakefile.configs.empty());
+    EXPECT_EQ(xmakefile.ConfigCount(), 0);
+    EXPECT_TRUE(xmakefile.Empty());
 }
 
 // Test multiple FromJSON calls (should append or replace?)
@@ -504,12 +505,67 @@ TEST_F(XMakefileTest, MultipleFromJSONCalls)
     JsonDocument doc1 = createSingleConfigJson();
     
     xmakefile.FromJSON(doc1.as<JsonVariant>(), testDir);
-    EXPECT_EQ(xmakefile.configs.size(), 1);
+    EXPECT_EQ(xmakefile.ConfigCount(), 1);
     
     // Second call
     JsonDocument doc2 = createMultiConfigJson();
     xmakefile.FromJSON(doc2.as<JsonVariant>(), testDir);
     
     // Configs should be appended (3 total: 1 from first + 2 from second)
-    EXPECT_EQ(xmakefile.configs.size(), 3);
+    EXPECT_EQ(xmakefile.ConfigCount(), 3);
+}
+
+// Test that configurations are only resolved when requested
+TEST_F(XMakefileTest, ConfigurationsResolvedOnDemand)
+{
+    XMakefile xmakefile;
+    JsonDocument doc = createMultiConfigJson();
+
+    xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
+
+    EXPECT_EQ(xmakefile.ConfigCount(), 2);
+    EXPECT_EQ(xmakefile.ResolvedConfigCount(), 0);
+    EXPECT_EQ(xmakefile.GetConfigName(1), "Release");
+    EXPECT_EQ(xmakefile.ResolvedConfigCount(), 0);
+
+    ConfigSnapshot release = xmakefile.FindConfig("Release");
+    ASSERT_NE(release, nullptr);
+    EXPECT_EQ(release->OutputFilename, "app_release");
+    EXPECT_EQ(xmakefile.ResolvedConfigCount(), 1);
+
+    // The resolved configuration is cached
+    EXPECT_EQ(&xmakefile.GetConfig(1), release.get());
+    EXPECT_EQ(xmakefile.ResolvedConfigCount(), 1);
+
+    EXPECT_EQ(xmakefile.FindConfig("Missing"), nullptr);
+}
+
+// Test serialization keeps raw and resolved configurations
+TEST_F(XMakefileTest, SerializeRoundTrip)
+{
+    XMakefile xmakefile;
+    JsonDocument doc = createMultiConfigJson();
+    xmakefile.FromJSON(doc.as<JsonVariant>(), testDir);
+    const XMakefileConfig &release = xmakefile.GetConfig(1);
+
+    BinaryWriter writer;
+    xmakefile.Serialize(writer);
+
+    XMakefile restored;
+    BinaryReader reader(writer.GetBuffer());
+    ASSERT_TRUE(restored.Deserialize(reader));
+    EXPECT_TRUE(reader.AtEnd());
+
+    EXPECT_EQ(restored.ConfigCount(), 2);
+    EXPECT_EQ(restored.ResolvedConfigCount(), 1);
+    EXPECT_EQ(restored.GetConfig(1).OutputDir, release.OutputDir);
+    EXPECT_EQ(restored.GetConfig(1).Defines, release.Defines);
+    EXPECT_EQ(restored.GetConfig(0).Name, "Debug");
+    EXPECT_EQ(restored.ResolvedConfigCount(), 2);
+
+    // A truncated buffer is rejected
+    XMakefile truncated;
+    BinaryReader truncatedReader(std::string_view(writer.GetBuffer()).substr(0, writer.GetBuffer().size() / 2));
+    EXPECT_FALSE(truncated.Deserialize(truncatedReader));
+    EXPECT_TRUE(truncated.Empty());
 }
@@ -537,3 +537,62 @@ TEST_F(XMakefileConfigTest, PrintEnvironmentVariables)
     
     EXPECT_TRUE(output.find("name=") != std::string::npos);
 }
+
+// Test sources manifest fields
+TEST_F(XMakefileConfigTest, SourcesManifest)
+{
+    JsonDocument doc = createBasicConfigJson();
+    JsonArray sources = doc["sources"].to<JsonArray>();
+    sources.add("src/main.cpp");
+    sources.add("gen/*.cpp");
+    doc["source_list_file"] = "build/sources.txt";
+
+    XMakefileConfig config;
+    config.FromJSON(doc.as<JsonVariant>(), "/project");
+
+    ASSERT_EQ(config.Sources.size(), 2);
+    EXPECT_EQ(config.Sources[0], "/project/src/main.cpp");
+    EXPECT_EQ(config.Sources[1], "/project/gen/*.cpp");
+    EXPECT_EQ(config.SourceListFile, "/project/build/sources.txt");
+}
+
+// Test sources manifest is empty when not given
+TEST_F(XMakefileConfigTest, SourcesManifestMissing)
+{
+    JsonDocument doc = createBasicConfigJson();
+
+    XMakefileConfig config;
+    config.FromJSON(doc.as<JsonVariant>(), "/project");
+
+    EXPECT_TRUE(config.Sources.empty());
+    EXPECT_TRUE(config.SourceListFile.empty());
+}
+
+// Test pools, patterns with a directory are resolved, the depth is at least one
+TEST_F(XMakefileConfigTest, Pools)
+{
+    JsonDocument doc = createBasicConfigJson();
+    JsonArray pools = doc["pools"].to<JsonArray>();
+    JsonObject heavy = pools.add<JsonObject>();
+    heavy["name"] = "heavy";
+    heavy["depth"] = 4;
+    JsonArray files = heavy["files"].to<JsonArray>();
+    files.add("giant_*.cpp");
+    files.add("src/big/*.cpp");
+    JsonObject link = pools.add<JsonObject>();
+    link["name"] = "link";
+    link["depth"] = 0;
+
+    XMakefileConfig config;
+    config.FromJSON(doc.as<JsonVariant>(), "/project");
+
+    ASSERT_EQ(config.Pools.size(), 2);
+    EXPECT_EQ(config.Pools[0].Name, "heavy");
+    EXPECT_EQ(config.Pools[0].Depth, 4u);
+    ASSERT_EQ(config.Pools[0].Files.size(), 2);
+    EXPECT_EQ(config.Pools[0].Files[0], "giant_*.cpp");
+    EXPECT_EQ(config.Pools[0].Files[1], "/project/src/big/*.cpp");
+    EXPECT_EQ(config.Pools[1].Name, "link");
+    EXPECT_EQ(config.Pools[1].Depth, 1u);
+    EXPECT_TRUE(config.Pools[1].Files.empty());
+}
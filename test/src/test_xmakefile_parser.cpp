@@ -226,6 +226,44 @@ TEST_F(XMakefileParserTest, ParseInvalidJSON)
     EXPECT_FALSE(result);
 }
 
+// Test JSON errors are reported with their location
+TEST_F(XMakefileParserTest, ParseErrorReportsLocation)
+{
+    std::ofstream file(xmakefilePath);
+    file << "{\n  \"configurations\": [\n    { \"name\": \"Debug\" ]\n}";
+    file.close();
+
+    XMakefileParser parser;
+    EXPECT_FALSE(parser.Parse(xmakefilePath));
+
+    std::string output = cerrBuffer.str() + coutBuffer.str();
+    EXPECT_NE(output.find("byte 46 (line 3, column 23)"), std::string::npos) << output;
+}
+
+// Test a truncated xmakefile is reported at its end
+TEST_F(XMakefileParserTest, ParseErrorTruncatedXMakefile)
+{
+    std::ofstream file(xmakefilePath);
+    file << "{\n  \"configurations\": [";
+    file.close();
+
+    XMakefileParser parser;
+    EXPECT_FALSE(parser.Parse(xmakefilePath));
+
+    std::string output = cerrBuffer.str() + coutBuffer.str();
+    EXPECT_NE(output.find("(line 2, column 22)"), std::string::npos) << output;
+}
+
+// Test an empty xmakefile is rejected
+TEST_F(XMakefileParserTest, ParseEmptyFile)
+{
+    std::ofstream file(xmakefilePath);
+    file.close();
+
+    XMakefileParser parser;
+    EXPECT_FALSE(parser.Parse(xmakefilePath));
+}
+
 // Test Parse with empty configurations
 TEST_F(XMakefileParserTest, ParseEmptyConfigurations)
 {
@@ -252,6 +290,20 @@ TEST_F(XMakefileParserTest, SetConfigValid)
     EXPECT_EQ(parser.GetOutputFilename(), "app_release");
 }
 
+// Test that parsing again replaces the configurations of the previous parse
+TEST_F(XMakefileParserTest, ReparseReplacesConfigurations)
+{
+    createMultiConfigXMakefile();
+    XMakefileParser parser;
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+    ASSERT_TRUE(parser.SetConfig("Release"));
+
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+    EXPECT_EQ(parser.GetCurrentConfig()->Name, "Debug");
+    EXPECT_TRUE(parser.SetConfig("Release"));
+    EXPECT_EQ(parser.GetOutputFilename(), "app_release");
+}
+
 // Test SetConfig with invalid configuration
 TEST_F(XMakefileParserTest, SetConfigInvalid)
 {
@@ -303,9 +355,9 @@ TEST_F(XMakefileParserTest, GetCurrentConfig)
     XMakefileParser parser;
     parser.Parse(xmakefilePath);
     
-    XMakefileConfig config = parser.GetCurrentConfig();
-    EXPECT_EQ(config.Name, "Debug");
-    EXPECT_EQ(config.BuildType, "Executable");
+    ConfigSnapshot config = parser.GetCurrentConfig();
+    EXPECT_EQ(config->Name, "Debug");
+    EXPECT_EQ(config->BuildType, "Executable");
 }
 
 // Test SetVerbose
@@ -431,6 +483,110 @@ TEST_F(XMakefileParserTest, CreateBuildListObjectFiles)
     EXPECT_TRUE(buildStructures[0].buildString.find("-c -o") != std::string::npos);
 }
 
+// Build structures are reported while the source paths are still being scanned
+TEST_F(XMakefileParserTest, CreateBuildListStreamsBuildStructures)
+{
+    createBasicXMakefile();
+    createSourceFile("a.cpp");
+    createSourceFile("b.cpp");
+    createSourceFile("c.c");
+
+    for (int run = 0; run < 2; run++) // The second run reports the cached plan
+    {
+        XMakefileParser parser;
+        parser.Parse(xmakefilePath);
+
+        std::vector<std::string> reported;
+        std::vector<size_t> knownWhenReported;
+        parser.CreateBuildList([&](const BuildStruct &buildStruct)
+                               {
+            reported.emplace_back(buildStruct.sourceFile);
+            knownWhenReported.push_back(parser.GetBuildStructures().size()); });
+
+        const std::vector<BuildStruct> &buildStructures = parser.GetBuildStructures();
+        ASSERT_EQ(reported.size(), 3u);
+        for (size_t i = 0; i < reported.size(); i++)
+        {
+            EXPECT_EQ(reported[i], buildStructures[i].sourceFile);
+        }
+
+        if (run == 0)
+        {
+            EXPECT_EQ(knownWhenReported, (std::vector<size_t>{1, 2, 3}));
+        }
+    }
+}
+
+// Parsers sharing a discovery cache scan the same source paths once
+TEST_F(XMakefileParserTest, DiscoveryCacheSharedBetweenConfigs)
+{
+    createMultiConfigXMakefile();
+    createSourceFile("a.cpp");
+    createSourceFile("b.cpp");
+
+    auto discoveryCache = std::make_shared<DiscoveryCache>();
+    XMakefileParser debugParser;
+    ASSERT_TRUE(debugParser.Parse(xmakefilePath));
+    ASSERT_TRUE(debugParser.SetConfig("Debug"));
+    debugParser.SetDiscoveryCache(discoveryCache);
+    debugParser.CreateBuildList();
+    ASSERT_EQ(debugParser.GetBuildStructures().size(), 2u);
+
+    // Only a new scan would find this file
+    createSourceFile("c.cpp");
+
+    XMakefileParser releaseParser;
+    releaseParser.ParseFrom(debugParser);
+    EXPECT_EQ(releaseParser.GetConfigNames(), (std::vector<std::string>{"Debug", "Release"}));
+    ASSERT_TRUE(releaseParser.SetConfig("Release"));
+    releaseParser.SetDiscoveryCache(discoveryCache);
+    releaseParser.CreateBuildList();
+
+    const std::vector<BuildStruct> &buildStructures = releaseParser.GetBuildStructures();
+    ASSERT_EQ(buildStructures.size(), 2u);
+    EXPECT_NE(buildStructures[0].objectFile.find("Release"), std::string::npos);
+    EXPECT_NE(buildStructures[0].buildString.find("-O3"), std::string::npos);
+
+    // Without the cache the new file is found
+    XMakefileParser uncachedParser;
+    uncachedParser.ParseFrom(debugParser);
+    ASSERT_TRUE(uncachedParser.SetConfig("Release"));
+    std::filesystem::remove_all(testDir + "/.build");
+    uncachedParser.CreateBuildList();
+    EXPECT_EQ(uncachedParser.GetBuildStructures().size(), 3u);
+}
+
+// Sources generated by custom commands are compiled even outside the source paths, but only once
+TEST_F(XMakefileParserTest, CreateBuildListIncludesGeneratedSources)
+{
+    createBasicXMakefile();
+    std::string xmakefile;
+    {
+        std::ifstream file(xmakefilePath);
+        std::stringstream content;
+        content << file.rdbuf();
+        xmakefile = content.str();
+    }
+    std::string commands = R"("custom_commands": [{ "name": "gen", "command": "true", "outputs": ["gen/generated.cpp", "src/also_found.cpp", "gen/generated.txt"] }],)";
+    xmakefile.insert(xmakefile.find("\"name\": \"Debug\","), commands);
+    std::ofstream(xmakefilePath) << xmakefile;
+
+    createSourceFile("main.cpp");
+    createSourceFile("also_found.cpp");
+    std::filesystem::create_directories(testDir + "/gen");
+    std::ofstream(testDir + "/gen/generated.cpp") << "int generated() { return 1; }";
+
+    XMakefileParser parser;
+    ASSERT_TRUE(parser.Parse(xmakefilePath));
+    parser.CreateBuildList();
+
+    std::vector<std::string> sources;
+    for (const auto &buildStruct : parser.GetBuildStructures())
+        sources.emplace_back(std::filesystem::path(buildStruct.sourceFile).filename().string());
+    std::sort(sources.begin(), sources.end());
+    EXPECT_EQ(sources, (std::vector<std::string>{"also_found.cpp", "generated.cpp", "main.cpp"}));
+}
+
 // Test GetLinkerString for executable
 TEST_F(XMakefileParserTest, GetLinkerStringExecutable)
 {
@@ -494,6 +650,7 @@ TEST_F(XMakefileParserTest, GetLinkerStringStaticLibrary)
     std::string linkerString = parser.GetLinkerString();
     EXPECT_TRUE(linkerString.find("ar") != std::string::npos);
     EXPECT_TRUE(linkerString.find("rcs") != std::string::npos);
+    EXPECT_TRUE(linkerString.find("rcs " + testDir + "/.build/Debug/libtest.a ") != std::string::npos);
 }
 
 // Test GetLinkerString for shared library
@@ -986,3 +1143,448 @@ TEST_F(XMakefileParserTest, SwitchingConfigurations)
     parser.SetConfig("Release");
     EXPECT_EQ(parser.GetOutputFilename(), "app_release");
 }
+
+// Helper to write a minimal xmakefile with custom source paths
+static void writeSourcePathsXMakefile(const std::string &path, const std::string &sourcePaths, const std::string &extraFields = "")
+{
+    std::ofstream file(path);
+    file << R"({
+        "configurations": [{
+            "name": "Debug",
+            "build_type": "Executable",
+            "build_dir": ".build",
+            "output_filename": "app",
+            "compiler_path": "",
+            "compiler": "g++",
+            "c_flags": "",
+            "cxx_flags": "",
+            "linker": "g++",
+            "linker_flags": "",
+            "archiver": "ar",
+            "archiver_flags": "rcs",
+            "defines": [],
+            "include_paths": [],
+            "library_paths": [],
+            "libraries": [],
+            "source_paths": )" + sourcePaths + R"(,)" + extraFields + R"(
+            "exclude_paths": [],
+            "exclude_files": [],
+            "pre_build_commands": [],
+            "post_build_commands": [],
+            "pre_run_commands": [],
+            "post_run_commands": [],
+            "install_commands": [],
+            "uninstall_commands": [],
+            "clean_commands": []
+        }]
+    })";
+    file.close();
+}
+
+// Test overlapping source paths report every file only once
+TEST_F(XMakefileParserTest, OverlappingSourcePathsDeduplicated)
+{
+    writeSourcePathsXMakefile(xmakefilePath, R"(["src", "src/net"])");
+
+    std::filesystem::create_directories(testDir + "/src/net");
+    createSourceFile("main.cpp");
+    createSourceFile("net/socket.cpp");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    const std::vector<BuildStruct>& buildStructures = parser.GetBuildStructures();
+    EXPECT_EQ(buildStructures.size(), 2);
+}
+
+// Test overlapping source paths warn in verbose mode
+TEST_F(XMakefileParserTest, OverlappingSourcePathsWarnInVerboseMode)
+{
+    writeSourcePathsXMakefile(xmakefilePath, R"(["src/net", "src"])");
+
+    std::filesystem::create_directories(testDir + "/src/net");
+    createSourceFile("net/socket.cpp");
+
+    XMakefileParser parser;
+    parser.SetVerbose(true);
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    EXPECT_EQ(parser.GetBuildStructures().size(), 1);
+    EXPECT_TRUE(cerrBuffer.str().find("[WARNING]") != std::string::npos);
+}
+
+// Test symlinked source directories do not produce duplicate objects
+TEST_F(XMakefileParserTest, SymlinkedSourceDirectoryDeduplicated)
+{
+    writeSourcePathsXMakefile(xmakefilePath, R"(["src"])");
+
+    std::filesystem::create_directories(testDir + "/src/real");
+    createSourceFile("real/helper.cpp");
+    std::filesystem::create_directory_symlink(testDir + "/src/real", testDir + "/src/alias");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    const std::vector<BuildStruct>& buildStructures = parser.GetBuildStructures();
+    EXPECT_EQ(buildStructures.size(), 1);
+}
+
+// Test symlink cycles terminate
+TEST_F(XMakefileParserTest, SymlinkCycleTerminates)
+{
+    writeSourcePathsXMakefile(xmakefilePath, R"(["src"])");
+
+    std::filesystem::create_directories(testDir + "/src/sub");
+    createSourceFile("sub/file.cpp");
+    std::filesystem::create_directory_symlink(testDir + "/src", testDir + "/src/sub/loop");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    const std::vector<BuildStruct>& buildStructures = parser.GetBuildStructures();
+    EXPECT_EQ(buildStructures.size(), 1);
+}
+
+// Test explicit sources replace scanning of source paths
+TEST_F(XMakefileParserTest, SourcesManifestSkipsScanning)
+{
+    writeSourcePathsXMakefile(xmakefilePath, R"(["src"])", R"("sources": ["src/main.cpp"],)");
+
+    createSourceFile("main.cpp");
+    createSourceFile("unlisted.cpp");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    const std::vector<BuildStruct>& buildStructures = parser.GetBuildStructures();
+    ASSERT_EQ(buildStructures.size(), 1);
+    EXPECT_TRUE(buildStructures[0].sourceFile.find("main.cpp") != std::string::npos);
+}
+
+// Test glob patterns in sources
+TEST_F(XMakefileParserTest, SourcesManifestWithGlob)
+{
+    writeSourcePathsXMakefile(xmakefilePath, "[]", R"("sources": ["src/*.cpp", "src/main.cpp"],)");
+
+    createSourceFile("main.cpp");
+    createSourceFile("helper.cpp");
+    createSourceFile("notes.txt");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    // main.cpp is matched twice but only built once
+    EXPECT_EQ(parser.GetBuildStructures().size(), 2);
+}
+
+// Test source list file
+TEST_F(XMakefileParserTest, SourceListFile)
+{
+    writeSourcePathsXMakefile(xmakefilePath, "[]", R"("source_list_file": "sources.txt",)");
+
+    createSourceFile("main.cpp");
+    createSourceFile("helper.c");
+    createSourceFile("unlisted.cpp");
+
+    std::ofstream listFile(testDir + "/sources.txt");
+    listFile << "# generated\n"
+             << "src/main.cpp\n"
+             << "\n"
+             << "  src/helper.c  \n"
+             << "src/missing.cpp\n";
+    listFile.close();
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    const std::vector<BuildStruct>& buildStructures = parser.GetBuildStructures();
+    EXPECT_EQ(buildStructures.size(), 2);
+    for (const auto& build : buildStructures) {
+        EXPECT_TRUE(build.sourceFile.find("unlisted.cpp") == std::string::npos);
+    }
+    EXPECT_TRUE(cerrBuffer.str().find("missing.cpp") != std::string::npos);
+}
+
+// Test a missing source list file fails the build list instead of building the other sources only
+TEST_F(XMakefileParserTest, MissingSourceListFileFails)
+{
+    writeSourcePathsXMakefile(xmakefilePath, "[]", R"("sources": ["src/main.cpp"], "source_list_file": "sources.txt",)");
+    createSourceFile("main.cpp");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    EXPECT_FALSE(parser.CreateBuildList());
+    EXPECT_TRUE(parser.GetBuildStructures().empty());
+    EXPECT_TRUE(cerrBuffer.str().find("sources.txt") != std::string::npos);
+    EXPECT_FALSE(std::filesystem::exists(testDir + "/.build/Debug/build_plan.cache"));
+
+    std::ofstream(testDir + "/sources.txt") << "src/main.cpp\n";
+    EXPECT_TRUE(parser.CreateBuildList());
+    EXPECT_EQ(parser.GetBuildStructures().size(), 1);
+}
+
+// Test the build string keeps the expected layout
+TEST_F(XMakefileParserTest, BuildStringLayout)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+    createSourceFile("helper.c");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    for (const auto& build : parser.GetBuildStructures()) {
+        std::string expectedFlags = build.sourceFile.ends_with(".c") ? "-Wall -g" : "-Wall -g -std=c++17";
+        std::string expected = "g++ " + expectedFlags + " -I" + testDir + "/include -DDEBUG " +
+                               std::string(build.sourceFile) + " -c -o " + std::string(build.objectFile);
+        EXPECT_EQ(build.buildString, expected);
+    }
+}
+
+// Test templates follow configuration changes
+TEST_F(XMakefileParserTest, BuildStringFollowsConfigSwitch)
+{
+    createMultiConfigXMakefile();
+    createSourceFile("main.cpp");
+
+    XMakefileParser parser;
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+    ASSERT_EQ(parser.GetBuildStructures().size(), 1);
+    EXPECT_TRUE(parser.GetBuildStructures()[0].buildString.find("-DDEBUG") != std::string::npos);
+
+    parser.SetConfig("Release");
+    parser.CreateBuildList();
+    ASSERT_EQ(parser.GetBuildStructures().size(), 1);
+    EXPECT_TRUE(parser.GetBuildStructures()[0].buildString.find("-DNDEBUG") != std::string::npos);
+    EXPECT_TRUE(parser.GetBuildStructures()[0].buildString.find("-O3") != std::string::npos);
+}
+
+// Test plan generation time is reported in verbose mode
+TEST_F(XMakefileParserTest, PlanTimeReportedInVerboseMode)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+    Logger::SetVerbose(true);
+
+    XMakefileParser parser;
+    parser.SetVerbose(true);
+    parser.Parse(xmakefilePath);
+    parser.CreateBuildList();
+
+    EXPECT_TRUE(coutBuffer.str().find("Build plan for 1 files created in") != std::string::npos);
+    Logger::SetVerbose(false);
+}
+
+// Test a second run reuses the cached build plan
+TEST_F(XMakefileParserTest, BuildPlanLoadedFromCache)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+    createSourceFile("helper.cpp");
+
+    XMakefileParser first;
+    first.Parse(xmakefilePath);
+    first.CreateBuildList();
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.build/Debug/build_plan.cache"));
+
+    Logger::SetVerbose(true);
+    XMakefileParser second;
+    second.Parse(xmakefilePath);
+    second.CreateBuildList();
+    Logger::SetVerbose(false);
+
+    EXPECT_TRUE(coutBuffer.str().find("loaded from cache") != std::string::npos);
+    ASSERT_EQ(second.GetBuildStructures().size(), 2);
+    EXPECT_EQ(second.GetLinkerString(), first.GetLinkerString());
+    for (size_t i = 0; i < 2; i++)
+    {
+        EXPECT_EQ(second.GetBuildStructures()[i].buildString, first.GetBuildStructures()[i].buildString);
+        EXPECT_EQ(second.GetBuildStructures()[i].objectFile, first.GetBuildStructures()[i].objectFile);
+    }
+}
+
+// Test adding a source file invalidates the cached plan
+TEST_F(XMakefileParserTest, BuildPlanInvalidatedByNewFile)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+
+    XMakefileParser first;
+    first.Parse(xmakefilePath);
+    first.CreateBuildList();
+    ASSERT_EQ(first.GetBuildStructures().size(), 1);
+
+    std::filesystem::create_directories(testDir + "/src/sub");
+    createSourceFile("sub/added.cpp");
+
+    XMakefileParser second;
+    second.Parse(xmakefilePath);
+    second.CreateBuildList();
+    EXPECT_EQ(second.GetBuildStructures().size(), 2);
+}
+
+// Test changing the xmakefile invalidates the cached plan
+TEST_F(XMakefileParserTest, BuildPlanInvalidatedByXMakefileChange)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+
+    XMakefileParser first;
+    first.Parse(xmakefilePath);
+    first.CreateBuildList();
+
+    std::string content = first.GetXMakefileContent();
+    size_t pos = content.find("\"DEBUG\"");
+    ASSERT_NE(pos, std::string::npos);
+    content.replace(pos, 7, "\"CHANGED\"");
+    std::ofstream file(xmakefilePath);
+    file << content;
+    file.close();
+
+    XMakefileParser second;
+    second.Parse(xmakefilePath);
+    second.CreateBuildList();
+    ASSERT_EQ(second.GetBuildStructures().size(), 1);
+    EXPECT_TRUE(second.GetBuildStructures()[0].buildString.find("-DCHANGED") != std::string::npos);
+}
+
+// Test a corrupt plan cache is ignored
+TEST_F(XMakefileParserTest, BuildPlanCorruptCacheIgnored)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+
+    XMakefileParser first;
+    first.Parse(xmakefilePath);
+    first.CreateBuildList();
+
+    std::string cacheFile = testDir + "/.build/Debug/build_plan.cache";
+    std::filesystem::resize_file(cacheFile, std::filesystem::file_size(cacheFile) / 2);
+
+    XMakefileParser second;
+    second.Parse(xmakefilePath);
+    second.CreateBuildList();
+    EXPECT_EQ(second.GetBuildStructures().size(), 1);
+}
+
+// Test a changed environment variable referenced by the configuration invalidates the cached plan
+TEST_F(XMakefileParserTest, BuildPlanInvalidatedByEnvironment)
+{
+    createBasicXMakefile();
+    createSourceFile("main.cpp");
+    std::string content;
+    {
+        std::ifstream in(xmakefilePath);
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    size_t pos = content.find("\"post_build_commands\": []");
+    ASSERT_NE(pos, std::string::npos);
+    content.replace(pos, 25, "\"post_build_commands\": [\"echo ${XMAKE_PLAN_TEST_VALUE}\"]");
+    std::ofstream(xmakefilePath) << content;
+
+    auto planLoaded = [this]()
+    {
+        coutBuffer.str("");
+        Logger::SetVerbose(true);
+        XMakefileParser parser;
+        parser.Parse(xmakefilePath);
+        parser.CreateBuildList();
+        Logger::SetVerbose(false);
+        return coutBuffer.str().find("loaded from cache") != std::string::npos;
+    };
+
+    setenv("XMAKE_PLAN_TEST_VALUE", "first", 1);
+    EXPECT_FALSE(planLoaded());
+    EXPECT_TRUE(planLoaded());
+
+    setenv("XMAKE_PLAN_TEST_VALUE", "second", 1);
+    EXPECT_FALSE(planLoaded());
+    EXPECT_TRUE(planLoaded());
+
+    unsetenv("XMAKE_PLAN_TEST_VALUE");
+    EXPECT_FALSE(planLoaded());
+}
+
+// Test a second parse loads the resolved configurations from the xmakefile cache
+TEST_F(XMakefileParserTest, XMakefileCacheUsedOnSecondParse)
+{
+    createMultiConfigXMakefile();
+
+    XMakefileParser first;
+    ASSERT_TRUE(first.Parse(xmakefilePath));
+    ASSERT_TRUE(first.SetConfig("Release"));
+    EXPECT_TRUE(std::filesystem::exists(testDir + "/.xmake/xmakefile.json.cache"));
+
+    Logger::SetVerbose(true);
+    XMakefileParser second;
+    ASSERT_TRUE(second.Parse(xmakefilePath));
+    EXPECT_TRUE(coutBuffer.str().find("xmakefile loaded from cache.") != std::string::npos);
+    Logger::SetVerbose(false);
+
+    EXPECT_EQ(second.GetCurrentConfig()->Name, "Debug");
+    EXPECT_EQ(second.GetCurrentConfig()->IncludePaths, first.GetCurrentConfig()->IncludePaths);
+    ASSERT_TRUE(second.SetConfig("Release"));
+    EXPECT_EQ(second.GetOutputFilename(), "app_release");
+}
+
+// Test a changed environment variable invalidates the xmakefile cache
+TEST_F(XMakefileParserTest, XMakefileCacheInvalidatedByEnvironment)
+{
+    std::ofstream file(xmakefilePath);
+    file << R"({
+        "configurations": [{
+            "name": "Debug",
+            "build_type": "Executable",
+            "build_dir": ".build",
+            "output_filename": "app",
+            "compiler": "g++",
+            "linker": "g++",
+            "post_build_commands": ["echo ${XMAKE_CACHE_TEST_VALUE}"]
+        }]
+    })";
+    file.close();
+
+    setenv("XMAKE_CACHE_TEST_VALUE", "first", 1);
+    XMakefileParser first;
+    ASSERT_TRUE(first.Parse(xmakefilePath));
+    ASSERT_EQ(first.GetCurrentConfig()->PostBuildCommands.size(), 1);
+    EXPECT_NE(first.GetCurrentConfig()->PostBuildCommands[0].find("first"), std::string::npos);
+
+    setenv("XMAKE_CACHE_TEST_VALUE", "second", 1);
+    XMakefileParser second;
+    ASSERT_TRUE(second.Parse(xmakefilePath));
+    ASSERT_EQ(second.GetCurrentConfig()->PostBuildCommands.size(), 1);
+    EXPECT_NE(second.GetCurrentConfig()->PostBuildCommands[0].find("second"), std::string::npos);
+
+    unsetenv("XMAKE_CACHE_TEST_VALUE");
+    XMakefileParser third;
+    ASSERT_TRUE(third.Parse(xmakefilePath));
+    EXPECT_EQ(third.GetCurrentConfig()->PostBuildCommands[0].find("second"), std::string::npos);
+}
+
+// Test a corrupt xmakefile cache falls back to the JSON
+TEST_F(XMakefileParserTest, XMakefileCacheCorruptIgnored)
+{
+    createBasicXMakefile();
+
+    XMakefileParser first;
+    ASSERT_TRUE(first.Parse(xmakefilePath));
+
+    std::string cacheFile = testDir + "/.xmake/xmakefile.json.cache";
+    ASSERT_TRUE(std::filesystem::exists(cacheFile));
+    std::filesystem::resize_file(cacheFile, std::filesystem::file_size(cacheFile) / 2);
+
+    XMakefileParser second;
+    ASSERT_TRUE(second.Parse(xmakefilePath));
+    EXPECT_EQ(second.GetCurrentConfig()->Name, first.GetCurrentConfig()->Name);
+    EXPECT_EQ(second.GetOutputFilename(), first.GetOutputFilename());
+}
@@ -0,0 +1,461 @@
+//**************************************************************
+// File access tracer for custom commands
+//
+// Loaded through LD_PRELOAD into a traced command and every process it
+// starts. The file functions of the C library are wrapped: each call is
+// passed on unchanged and the path it touched is appended to the file named
+// by XMAKE_TRACE_FILE, one line per access:
+//
+//   R /absolute/path   read, opened, or probed with stat or access
+//   W /absolute/path   opened for writing, created, or renamed to
+//   D /absolute/path   removed, or renamed away
+//
+// Paths are written as the command passed them, made absolute against the
+// working directory or the directory file descriptor, and not normalized.
+// Every line is written with a single write() to a file opened with
+// O_APPEND, so lines of concurrent processes and threads do not mix.
+//**************************************************************
+
+#undef _FORTIFY_SOURCE
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+//**************************************************************
+// Includes
+//**************************************************************
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//**************************************************************
+// Local variables
+//**************************************************************
+
+static int traceFd = -1;
+static __thread int recording = 0; // Set while a line is recorded, the tracer's own calls are not traced
+
+//**************************************************************
+// Local functions
+//**************************************************************
+
+// Looks up the wrapped function on first use, assigned through a void
+// pointer as POSIX suggests for dlsym()
+#define REAL(name, failure)                                 \
+    static __typeof__(name) *real_##name = NULL;            \
+    if (real_##name == NULL)                                \
+        *(void **)(&real_##name) = dlsym(RTLD_NEXT, #name); \
+    if (real_##name == NULL)                                \
+    {                                                       \
+        errno = ENOSYS;                                     \
+        return failure;                                     \
+    }
+
+__attribute__((constructor)) static void OpenTraceFile(void)
+{
+    const char *file = getenv("XMAKE_TRACE_FILE");
+    if (file == NULL || file[0] == '\0')
+        return;
+
+    // The raw system call, open() would be traced itself
+    traceFd = (int)syscall(SYS_openat, AT_FDCWD, file, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+static void Record(char kind, int dirFd, const char *path)
+{
+    if (traceFd < 0 || path == NULL || path[0] == '\0' || recording)
+        return;
+
+    recording = 1;
+    int savedErrno = errno;
+
+    char line[2 * PATH_MAX + 4];
+    size_t length = 0;
+    line[length++] = kind;
+    line[length++] = ' ';
+
+    if (path[0] != '/')
+    {
+        // Relative to the working directory or to the directory descriptor
+        char base[PATH_MAX];
+        ssize_t baseLength = -1;
+        if (dirFd == AT_FDCWD)
+        {
+            if (getcwd(base, sizeof(base)) != NULL)
+                baseLength = (ssize_t)strlen(base);
+        }
+        else
+        {
+            char link[64];
+            snprintf(link, sizeof(link), "/proc/self/fd/%d", dirFd);
+            baseLength = readlink(link, base, sizeof(base));
+        }
+
+        if (baseLength <= 0)
+        {
+            errno = savedErrno;
+            recording = 0;
+            return;
+        }
+        memcpy(line + length, base, (size_t)baseLength);
+        length += (size_t)baseLength;
+        line[length++] = '/';
+    }
+
+    size_t pathLength = strlen(path);
+    if (length + pathLength + 1 <= sizeof(line))
+    {
+        memcpy(line + length, path, pathLength);
+        length += pathLength;
+        line[length++] = '\n';
+        syscall(SYS_write, traceFd, line, length);
+    }
+
+    errno = savedErrno;
+    recording = 0;
+}
+
+static char OpenKind(int flags)
+{
+    return (flags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC)) != 0 ? 'W' : 'R';
+}
+
+static char FopenKind(const char *mode)
+{
+    return mode != NULL && (strchr(mode, 'w') != NULL || strchr(mode, 'a') != NULL || strchr(mode, '+') != NULL) ? 'W' : 'R';
+}
+
+static mode_t ModeArgument(int flags, va_list args)
+{
+    return (flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE ? (mode_t)va_arg(args, unsigned int) : 0;
+}
+
+// An O_TMPFILE open names the directory of an anonymous file, not a file
+static void RecordOpen(int dirFd, const char *path, int flags)
+{
+    if ((flags & O_TMPFILE) != O_TMPFILE)
+        Record(OpenKind(flags), dirFd, path);
+}
+
+//**************************************************************
+// Opening files
+//**************************************************************
+
+int open(const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = ModeArgument(flags, args);
+    va_end(args);
+
+    REAL(open, -1);
+    int result = real_open(path, flags, mode);
+    RecordOpen(AT_FDCWD, path, flags);
+    return result;
+}
+
+int open64(const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = ModeArgument(flags, args);
+    va_end(args);
+
+    REAL(open64, -1);
+    int result = real_open64(path, flags, mode);
+    RecordOpen(AT_FDCWD, path, flags);
+    return result;
+}
+
+int openat(int dirFd, const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = ModeArgument(flags, args);
+    va_end(args);
+
+    REAL(openat, -1);
+    int result = real_openat(dirFd, path, flags, mode);
+    RecordOpen(dirFd, path, flags);
+    return result;
+}
+
+int openat64(int dirFd, const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = ModeArgument(flags, args);
+    va_end(args);
+
+    REAL(openat64, -1);
+    int result = real_openat64(dirFd, path, flags, mode);
+    RecordOpen(dirFd, path, flags);
+    return result;
+}
+
+// Called instead of open() by programs built with _FORTIFY_SOURCE
+int __open_2(const char *path, int flags);
+int __open_2(const char *path, int flags)
+{
+    REAL(__open_2, -1);
+    int result = real___open_2(path, flags);
+    RecordOpen(AT_FDCWD, path, flags);
+    return result;
+}
+
+int __open64_2(const char *path, int flags);
+int __open64_2(const char *path, int flags)
+{
+    REAL(__open64_2, -1);
+    int result = real___open64_2(path, flags);
+    RecordOpen(AT_FDCWD, path, flags);
+    return result;
+}
+
+int __openat_2(int dirFd, const char *path, int flags);
+int __openat_2(int dirFd, const char *path, int flags)
+{
+    REAL(__openat_2, -1);
+    int result = real___openat_2(dirFd, path, flags);
+    RecordOpen(dirFd, path, flags);
+    return result;
+}
+
+int __openat64_2(int dirFd, const char *path, int flags);
+int __openat64_2(int dirFd, const char *path, int flags)
+{
+    REAL(__openat64_2, -1);
+    int result = real___openat64_2(dirFd, path, flags);
+    RecordOpen(dirFd, path, flags);
+    return result;
+}
+
+int creat(const char *path, mode_t mode)
+{
+    REAL(creat, -1);
+    int result = real_creat(path, mode);
+    Record('W', AT_FDCWD, path);
+    return result;
+}
+
+int creat64(const char *path, mode_t mode)
+{
+    REAL(creat64, -1);
+    int result = real_creat64(path, mode);
+    Record('W', AT_FDCWD, path);
+    return result;
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+    REAL(fopen, NULL);
+    FILE *result = real_fopen(path, mode);
+    Record(FopenKind(mode), AT_FDCWD, path);
+    return result;
+}
+
+FILE *fopen64(const char *path, const char *mode)
+{
+    REAL(fopen64, NULL);
+    FILE *result = real_fopen64(path, mode);
+    Record(FopenKind(mode), AT_FDCWD, path);
+    return result;
+}
+
+FILE *freopen(const char *path, const char *mode, FILE *stream)
+{
+    REAL(freopen, NULL);
+    FILE *result = real_freopen(path, mode, stream);
+    Record(FopenKind(mode), AT_FDCWD, path);
+    return result;
+}
+
+//**************************************************************
+// Probing files
+//**************************************************************
+
+int stat(const char *path, struct stat *buffer)
+{
+    REAL(stat, -1);
+    int result = real_stat(path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int stat64(const char *path, struct stat64 *buffer)
+{
+    REAL(stat64, -1);
+    int result = real_stat64(path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int lstat(const char *path, struct stat *buffer)
+{
+    REAL(lstat, -1);
+    int result = real_lstat(path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int lstat64(const char *path, struct stat64 *buffer)
+{
+    REAL(lstat64, -1);
+    int result = real_lstat64(path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int fstatat(int dirFd, const char *path, struct stat *buffer, int flags)
+{
+    REAL(fstatat, -1);
+    int result = real_fstatat(dirFd, path, buffer, flags);
+    if ((flags & AT_EMPTY_PATH) == 0 || path[0] != '\0')
+        Record('R', dirFd, path);
+    return result;
+}
+
+int fstatat64(int dirFd, const char *path, struct stat64 *buffer, int flags)
+{
+    REAL(fstatat64, -1);
+    int result = real_fstatat64(dirFd, path, buffer, flags);
+    if ((flags & AT_EMPTY_PATH) == 0 || path[0] != '\0')
+        Record('R', dirFd, path);
+    return result;
+}
+
+int statx(int dirFd, const char *path, int flags, unsigned int mask, struct statx *buffer)
+{
+    REAL(statx, -1);
+    int result = real_statx(dirFd, path, flags, mask, buffer);
+    if ((flags & AT_EMPTY_PATH) == 0 || path[0] != '\0')
+        Record('R', dirFd, path);
+    return result;
+}
+
+// The stat functions of C libraries older than glibc 2.33
+int __xstat(int version, const char *path, struct stat *buffer);
+int __xstat(int version, const char *path, struct stat *buffer)
+{
+    REAL(__xstat, -1);
+    int result = real___xstat(version, path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int __xstat64(int version, const char *path, struct stat64 *buffer);
+int __xstat64(int version, const char *path, struct stat64 *buffer)
+{
+    REAL(__xstat64, -1);
+    int result = real___xstat64(version, path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int __lxstat(int version, const char *path, struct stat *buffer);
+int __lxstat(int version, const char *path, struct stat *buffer)
+{
+    REAL(__lxstat, -1);
+    int result = real___lxstat(version, path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int __lxstat64(int version, const char *path, struct stat64 *buffer);
+int __lxstat64(int version, const char *path, struct stat64 *buffer)
+{
+    REAL(__lxstat64, -1);
+    int result = real___lxstat64(version, path, buffer);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int __fxstatat(int version, int dirFd, const char *path, struct stat *buffer, int flags);
+int __fxstatat(int version, int dirFd, const char *path, struct stat *buffer, int flags)
+{
+    REAL(__fxstatat, -1);
+    int result = real___fxstatat(version, dirFd, path, buffer, flags);
+    Record('R', dirFd, path);
+    return result;
+}
+
+int __fxstatat64(int version, int dirFd, const char *path, struct stat64 *buffer, int flags);
+int __fxstatat64(int version, int dirFd, const char *path, struct stat64 *buffer, int flags)
+{
+    REAL(__fxstatat64, -1);
+    int result = real___fxstatat64(version, dirFd, path, buffer, flags);
+    Record('R', dirFd, path);
+    return result;
+}
+
+int access(const char *path, int mode)
+{
+    REAL(access, -1);
+    int result = real_access(path, mode);
+    Record('R', AT_FDCWD, path);
+    return result;
+}
+
+int faccessat(int dirFd, const char *path, int mode, int flags)
+{
+    REAL(faccessat, -1);
+    int result = real_faccessat(dirFd, path, mode, flags);
+    Record('R', dirFd, path);
+    return result;
+}
+
+//**************************************************************
+// Renaming and removing files
+//**************************************************************
+
+int rename(const char *oldPath, const char *newPath)
+{
+    REAL(rename, -1);
+    int result = real_rename(oldPath, newPath);
+    Record('D', AT_FDCWD, oldPath);
+    Record('W', AT_FDCWD, newPath);
+    return result;
+}
+
+int renameat(int oldDirFd, const char *oldPath, int newDirFd, const char *newPath)
+{
+    REAL(renameat, -1);
+    int result = real_renameat(oldDirFd, oldPath, newDirFd, newPath);
+    Record('D', oldDirFd, oldPath);
+    Record('W', newDirFd, newPath);
+    return result;
+}
+
+int renameat2(int oldDirFd, const char *oldPath, int newDirFd, const char *newPath, unsigned int flags)
+{
+    REAL(renameat2, -1);
+    int result = real_renameat2(oldDirFd, oldPath, newDirFd, newPath, flags);
+    Record('D', oldDirFd, oldPath);
+    Record('W', newDirFd, newPath);
+    return result;
+}
+
+int unlink(const char *path)
+{
+    REAL(unlink, -1);
+    int result = real_unlink(path);
+    Record('D', AT_FDCWD, path);
+    return result;
+}
+
+int unlinkat(int dirFd, const char *path, int flags)
+{
+    REAL(unlinkat, -1);
+    int result = real_unlinkat(dirFd, path, flags);
+    Record('D', dirFd, path);
+    return result;
+}